@@ -0,0 +1,242 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcmp(), memcpy() */
+#include <stdlib.h>     /* for malloc(), free() */
+#include <stdio.h>      /* for fopen() */
+
+#ifndef _WIN32
+#include <fcntl.h>      /* for open() */
+#include <unistd.h>     /* for close() */
+#include <sys/mman.h>   /* for mmap() */
+#include <sys/stat.h>   /* for fstat() */
+#endif
+
+#include "Archive.h"
+#include "Buffer.h"
+#include "Object.h"
+#include "Object_struct.h"
+
+static const char magic[4] = { 'O', 'O', 'C', 'A' };
+
+/******************************************************************************
+ * WRITING
+*******************************************************************************/
+
+/**
+ * @brief Append an archive holding the given objects to out. On failure out is
+ *        left as it was.
+ *
+ * @return int 0 on success, -1 if one of the objects cannot be serialized
+ */
+int write_archive(struct Buffer * out, void * const * objects, size_t n)
+{
+    assert(out && (objects || !n));
+
+    /* number the classes in order of first appearance; archives rarely hold more
+    than a few classes, so a linear search that remembers the last hit will do */
+    const struct Class ** classes = malloc((n ? n : 1) * sizeof(*classes));
+    uint32_t * index = malloc((n ? n : 1) * sizeof(*index));
+    assert(classes && index);
+
+    uint32_t count = 0, last = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        const struct Class * class = class_of(objects[i]);
+        if (count == 0 || classes[last] != class)
+        {
+            for (last = 0; last < count && classes[last] != class; last++)
+                ;
+            if (last == count)
+                classes[count++] = class;
+        }
+        index[i] = last;
+    }
+
+    size_t start = out->length;
+    buffer_put(out, magic, sizeof(magic));
+    buffer_put_u16(out, ARCHIVE_VERSION);
+    buffer_put_u16(out, 0);
+    buffer_put_u32(out, count);
+    for (uint32_t c = 0; c < count; c++)
+    {
+        size_t length = strlen(classes[c]->name);
+        assert(length <= UINT16_MAX);
+        buffer_put_u16(out, (uint16_t) length);
+        buffer_put(out, classes[c]->name, length);
+    }
+
+    int result = 0;
+    buffer_put_u64(out, n);
+    for (size_t i = 0; i < n && !result; i++)
+    {
+        buffer_put_u32(out, index[i]);
+        result = serialize(objects[i], out);
+    }
+    if (result)
+        out->length = start;
+
+    free(index);
+    free(classes);
+    return result;
+}
+
+/******************************************************************************
+ * READING
+*******************************************************************************/
+
+static const struct Class ** read_classes(struct Reader * in, uint32_t * count)
+{
+    char magic_in[sizeof(magic)];
+    uint16_t version, reserved;
+
+    if (reader_get(in, magic_in, sizeof(magic_in)) || memcmp(magic_in, magic, sizeof(magic))
+        || reader_get_u16(in, &version) || version != ARCHIVE_VERSION
+        || reader_get_u16(in, &reserved) || reader_get_u32(in, count)
+        || *count > (size_t) (in->end - in->cursor) / 2)
+        return NULL;
+
+    const struct Class ** classes = malloc((*count ? *count : 1) * sizeof(*classes));
+    assert(classes);
+
+    uint32_t c;
+    for (c = 0; c < *count; c++)
+        if (!(classes[c] = class_read(in, "archive")))
+            break;
+    if (c == *count)
+        return classes;
+
+    free(classes);
+    return NULL;
+}
+
+/**
+ * @brief Rebuild the objects stored in an archive, in one pass over the data.
+ *        Each object is allocated without running its ctor and then filled in by
+ *        its class's deserialize().
+ *
+ * @param data the archive bytes
+ * @param length the number of bytes
+ * @param count receives the number of objects
+ * @return void** a malloc()ed array of new objects, or NULL if the archive is
+ *         malformed or names a class that does not exist
+ */
+void ** read_archive(const void * data, size_t length, size_t * count)
+{
+    struct Reader in = { data, (const unsigned char *) data + length, 0 };
+    uint32_t class_count;
+    uint64_t n;
+    assert(data && count);
+
+    const struct Class ** classes = read_classes(&in, &class_count);
+    /* every object takes at least its 4-byte class index */
+    if (!classes || reader_get_u64(&in, &n) || n > (uint64_t) (in.end - in.cursor) / 4)
+    {
+        free(classes);
+        return NULL;
+    }
+
+    void ** objects = malloc((n ? n : 1) * sizeof(*objects));
+    assert(objects);
+
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        uint32_t c;
+        if (reader_get_u32(&in, &c) || c >= class_count)
+            break;
+
+        void * object = allocate(classes[c]);
+        if (!deserialize(object, &in))
+        {
+            deallocate(object);
+            break;
+        }
+        objects[i] = object;
+    }
+    free(classes);
+
+    if (i < n)
+    {
+        while (i-- > 0)
+            delete(objects[i]);
+        free(objects);
+        return NULL;
+    }
+    *count = n;
+    return objects;
+}
+
+/******************************************************************************
+ * FILES
+*******************************************************************************/
+
+/**
+ * @brief Write the objects to a new archive file at path.
+ *
+ * @return int 0 on success, -1 on failure
+ */
+int save_objects(const char * path, void * const * objects, size_t n)
+{
+    struct Buffer out = { 0 };
+
+    if (write_archive(&out, objects, n))
+    {
+        buffer_free(&out);
+        return -1;
+    }
+
+    FILE * file = fopen(path, "wb");
+    int result = file && fwrite(out.data, 1, out.length, file) == out.length ? 0 : -1;
+    if (file && fclose(file))
+        result = -1;
+
+    buffer_free(&out);
+    return result;
+}
+
+/**
+ * @brief Read back an archive file written by save_objects(). The file is mapped
+ *        into memory rather than read through a buffer.
+ *
+ * @return void** a malloc()ed array of new objects, see read_archive()
+ */
+void ** load_objects(const char * path, size_t * count)
+{
+    void ** objects = NULL;
+
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    struct stat status;
+
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void * data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+#ifdef MADV_SEQUENTIAL
+            madvise(data, status.st_size, MADV_SEQUENTIAL);
+#endif
+            objects = read_archive(data, status.st_size, count);
+            munmap(data, status.st_size);
+        }
+    }
+    close(fd);
+#else
+    /* no mmap() here: read the whole file instead */
+    FILE * file = fopen(path, "rb");
+    long size;
+
+    if (!file)
+        return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+    {
+        void * data = malloc(size);
+        if (data && fread(data, 1, size, file) == (size_t) size)
+            objects = read_archive(data, size, count);
+        free(data);
+    }
+    fclose(file);
+#endif
+    return objects;
+}
@@ -0,0 +1,30 @@
+#ifndef __ARCHIVE__H__SL
+#define __ARCHIVE__H__SL
+
+#include <stddef.h>
+
+struct Buffer;
+
+/******************************************************************************
+ * OBJECT ARCHIVES
+ * A compact, versioned binary container for arrays of objects. Each class name
+ * is stored once in the header; every object is then a class index followed by
+ * whatever the class's serialize() wrote. All integers are little-endian.
+ *
+ *   "OOCA"  u16 version  u16 reserved
+ *   u32 class count, then for each class: u16 name length, name bytes
+ *   u64 object count, then for each object: u32 class index, fields
+ *
+ * Classes are looked up with class_named() on loading, so every class in the
+ * archive must have been initialized before it is read back.
+*******************************************************************************/
+
+#define ARCHIVE_VERSION 1
+
+int write_archive(struct Buffer * out, void * const * objects, size_t n);
+void ** read_archive(const void * data, size_t length, size_t * count);
+
+int save_objects(const char * path, void * const * objects, size_t n);
+void ** load_objects(const char * path, size_t * count);
+
+#endif  /* !__ARCHIVE__H__SL */
@@ -0,0 +1,218 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memset() */
+#include <stdlib.h>     /* for malloc(), free() */
+
+#include "Arena.h"
+#include "Arena_struct.h"
+#include "Buffer.h"
+
+#define ARENA_ALIGN         16
+#define ARENA_CHUNK_SIZE    (64 * 1024)
+
+#define align(n)  (((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+#define data(chunk)  ((char *) (chunk) + align(sizeof(struct Chunk)))
+
+/******************************************************************************
+ * STATIC METHODS
+*******************************************************************************/
+
+/**
+ * @brief Move the bump pointer to a chunk with at least size bytes. The chunk after
+ *        the current one is reused if it is large enough (it was kept by an earlier
+ *        arena_reset()), otherwise a fresh chunk is linked in front of it.
+ */
+static void grow(struct Arena * self, size_t size)
+{
+    struct Chunk * chunk = self->current ? self->current->next : self->head;
+
+    if (!chunk || chunk->size < size)
+    {
+        size_t chunk_size = size > self->chunk_size ? size : self->chunk_size;
+        struct Chunk * fresh = malloc(align(sizeof(struct Chunk)) + chunk_size);
+        assert(fresh);
+
+        fresh->size = chunk_size;
+        fresh->next = chunk;
+        if (self->current)
+            self->current->next = fresh;
+        else
+            self->head = fresh;
+        chunk = fresh;
+    }
+    self->current = chunk;
+    self->next = data(chunk);
+    self->end = self->next + chunk->size;
+}
+
+static void * bump(struct Arena * self, size_t size)
+{
+    size = align(size);
+    if (size > (size_t) (self->end - self->next))
+        grow(self, size);
+
+    void * block = self->next;
+    self->next += size;
+
+    return block;
+}
+
+/**
+ * @brief Run the dtor of every object that asked for it, newest first.
+ */
+static void finalize(struct Arena * self)
+{
+    for (struct Finalizer * finalizer = self->finalizers; finalizer; finalizer = finalizer->next)
+        dtor(finalizer->object);
+    self->finalizers = NULL;
+}
+
+/******************************************************************************
+ * MEMORY MANAGEMENT FUNCTIONS
+*******************************************************************************/
+
+/**
+ * @brief Same as new() but the object is bump-allocated from the arena. Nothing is
+ *        recorded for objects whose class still uses the dtor inherited from Object,
+ *        so throwing them away at arena_reset() costs nothing per object.
+ *
+ * @param _arena the arena to allocate from
+ * @param _class the class of the new object, followed by the arguments for its ctor
+ * @return void* the constructed object
+ */
+void * new_in(void * _arena, const void * _class, ...)
+{
+    struct Arena * arena = _arena;
+    const struct Class * class = _class;
+    assert(arena && class && class->size);
+
+    struct Object * object = memset(bump(arena, class->size), 0, class->size);
+    object->class = class;
+
+    va_list arg_list;
+    va_start(arg_list, _class);
+    object = ctor(object, &arg_list);
+    va_end(arg_list);
+
+    if (class->dtor != ((const struct Class *) Object)->dtor)
+    {
+        struct Finalizer * finalizer = bump(arena, sizeof(struct Finalizer));
+        finalizer->object = object;
+        finalizer->next = arena->finalizers;
+        arena->finalizers = finalizer;
+    }
+    return object;
+}
+
+/**
+ * @brief Destroy every object created in the arena since the last reset. The chunks
+ *        are kept for reuse.
+ */
+void arena_reset(void * _self)
+{
+    struct Arena * self = _self;
+    assert(self);
+
+    finalize(self);
+    self->current = self->head;
+    self->next = self->head ? data(self->head) : NULL;
+    self->end = self->head ? self->next + self->head->size : NULL;
+}
+
+/**
+ * @brief Destroy every object in the arena, then the arena itself.
+ */
+void arena_destroy(void * self)
+{
+    delete(self);
+}
+
+/******************************************************************************
+ * ARENA CLASS METHODS
+*******************************************************************************/
+
+static void * Arena_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct Arena * self = super_ctor(Arena, _self, arglist_ptr);
+
+    self->chunk_size = va_arg(*arglist_ptr, size_t);
+    if (!self->chunk_size)
+        self->chunk_size = ARENA_CHUNK_SIZE;
+
+    return self;
+}
+
+static void * Arena_dtor(void * _self)
+{
+    struct Arena * self = _self;
+
+    finalize(self);
+    while (self->head)
+    {
+        struct Chunk * chunk = self->head;
+        self->head = chunk->next;
+        free(chunk);
+    }
+    return super_dtor(Arena, self);
+}
+
+/* Only the configuration is written: the objects in an arena are transient by
+design and are not carried over. */
+static int Arena_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Arena * self = _self;
+
+    if (super_serialize(Arena, self, out))
+        return -1;
+    buffer_put_u64(out, self->chunk_size);
+
+    return 0;
+}
+
+static void * Arena_deserialize(void * _self, struct Reader * in)
+{
+    struct Arena * self = super_deserialize(Arena, _self, in);
+    uint64_t chunk_size;
+
+    if (!self || reader_get_u64(in, &chunk_size) || !chunk_size)
+        return NULL;
+    self->chunk_size = chunk_size;
+
+    return self;
+}
+
+/* A copy of an arena is a new, empty arena with the same chunk size: the objects
+in it belong to the original. */
+static void * Arena_copy(const void * _self)
+{
+    const struct Arena * self = _self;
+
+    return new(class_of(self), self->chunk_size);
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Arena;
+
+static atomic_int arena_once;
+
+static void buildArena(void)
+{
+    Arena = new(
+        Class,
+        "Arena",
+        Object,
+        sizeof(struct Arena),
+        ctor, Arena_ctor,
+        dtor, Arena_dtor,
+        serialize, Arena_serialize,
+        deserialize, Arena_deserialize,
+        copy, Arena_copy,
+        NULL);
+}
+
+void initArena(void)
+{
+    class_once(&arena_once, buildArena);
+}
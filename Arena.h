@@ -0,0 +1,18 @@
+#ifndef __ARENA__H__SL
+#define __ARENA__H__SL
+
+#include "Object.h"
+
+/* new(Arena, (size_t) chunk_size) creates an arena, 0 picks the default chunk size */
+extern const void * Arena;
+
+/* Objects created with new_in() live until the arena is reset or destroyed and
+must not be passed to delete(). */
+void * new_in(void * arena, const void * class, ...);
+void arena_reset(void * arena);
+void arena_destroy(void * arena);
+
+/* initArena is used to set up the class descriptor for the Arena class */
+void initArena(void);
+
+#endif  /* !__ARENA__H__SL */
@@ -0,0 +1,37 @@
+#ifndef __ARENA_STRUCT__H__SL
+#define __ARENA_STRUCT__H__SL
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * Arena structure
+*******************************************************************************/
+/* Memory is handed out from a list of chunks by bumping a pointer. Chunks are
+kept across arena_reset() so that a frame's worth of objects can be rebuilt
+without going back to malloc(). */
+struct Chunk
+{
+    struct Chunk * next;
+    size_t size;
+};
+
+/* Objects whose dtor is not the inherited Object dtor get one of these so that
+arena_reset() knows to call it. Everything else is simply forgotten. */
+struct Finalizer
+{
+    struct Finalizer * next;
+    void * object;
+};
+
+struct Arena
+{
+    const struct Object _;
+    size_t chunk_size;
+    struct Chunk * head;
+    struct Chunk * current;
+    char * next;
+    char * end;
+    struct Finalizer * finalizers;
+};
+
+#endif  /* !__ARENA_STRUCT__H__SL */
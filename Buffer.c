@@ -0,0 +1,336 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcpy(), strlen() */
+#include <limits.h>     /* for IOV_MAX */
+#include <stdlib.h>     /* for realloc(), free() */
+#include <errno.h>      /* for errno, EINTR */
+#ifndef _WIN32
+#include <sys/uio.h>    /* for writev() */
+#else
+#include <io.h>         /* for _write() */
+#endif
+
+#include "Buffer.h"
+
+/* the most buffers handed to one writev() call */
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define BUFFER_FLUSH_PARTS  IOV_MAX
+#else
+#define BUFFER_FLUSH_PARTS  64
+#endif
+
+/******************************************************************************
+ * WRITING
+*******************************************************************************/
+
+struct Buffer buffer_over(void * memory, size_t capacity)
+{
+    assert(memory || !capacity);
+
+    return (struct Buffer) { memory, 0, capacity, 1 };
+}
+
+/**
+ * @brief Make room for n more bytes and return where they go. The length is
+ *        not changed: the caller fills the bytes in and then adds n to it.
+ */
+unsigned char * buffer_reserve(struct Buffer * buffer, size_t n)
+{
+    assert(buffer);
+
+    if (buffer->capacity - buffer->length < n)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (capacity - buffer->length < n)
+            capacity *= 2;
+        if (buffer->borrowed)
+        {
+            /* out of the caller's memory and onto the heap */
+            unsigned char * data = malloc(capacity);
+            assert(data);
+            buffer->data = memcpy(data, buffer->data, buffer->length);
+            buffer->borrowed = 0;
+        }
+        else
+            buffer->data = realloc(buffer->data, capacity);
+        assert(buffer->data);
+        buffer->capacity = capacity;
+    }
+    return buffer->data + buffer->length;
+}
+
+void buffer_put(struct Buffer * buffer, const void * bytes, size_t n)
+{
+    memcpy(buffer_reserve(buffer, n), bytes, n);
+    buffer->length += n;
+}
+
+static void put_le(struct Buffer * buffer, uint64_t value, size_t n)
+{
+    unsigned char * out = buffer_reserve(buffer, n);
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = (unsigned char) (value >> (8 * i));
+    buffer->length += n;
+}
+
+void buffer_put_u16(struct Buffer * buffer, uint16_t value)
+{
+    put_le(buffer, value, 2);
+}
+
+void buffer_put_u32(struct Buffer * buffer, uint32_t value)
+{
+    put_le(buffer, value, 4);
+}
+
+void buffer_put_u64(struct Buffer * buffer, uint64_t value)
+{
+    put_le(buffer, value, 8);
+}
+
+/* ints are stored as 32-bit two's complement */
+void buffer_put_int(struct Buffer * buffer, int value)
+{
+    put_le(buffer, (uint32_t) value, 4);
+}
+
+void buffer_free(struct Buffer * buffer)
+{
+    if (!buffer->borrowed)
+        free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = buffer->capacity = 0;
+    buffer->borrowed = 0;
+}
+
+/******************************************************************************
+ * READING
+*******************************************************************************/
+
+int reader_get(struct Reader * reader, void * bytes, size_t n)
+{
+    assert(reader);
+
+    if ((size_t) (reader->end - reader->cursor) < n)
+        return -1;
+    memcpy(bytes, reader->cursor, n);
+    reader->cursor += n;
+
+    return 0;
+}
+
+static int get_le(struct Reader * reader, uint64_t * value, size_t n)
+{
+    assert(reader);
+
+    if ((size_t) (reader->end - reader->cursor) < n)
+        return -1;
+
+    *value = 0;
+    for (size_t i = 0; i < n; i++)
+        *value |= (uint64_t) reader->cursor[i] << (8 * i);
+    reader->cursor += n;
+
+    return 0;
+}
+
+int reader_get_u16(struct Reader * reader, uint16_t * value)
+{
+    uint64_t wide;
+    if (get_le(reader, &wide, 2))
+        return -1;
+    *value = (uint16_t) wide;
+
+    return 0;
+}
+
+int reader_get_u32(struct Reader * reader, uint32_t * value)
+{
+    uint64_t wide;
+    if (get_le(reader, &wide, 4))
+        return -1;
+    *value = (uint32_t) wide;
+
+    return 0;
+}
+
+int reader_get_u64(struct Reader * reader, uint64_t * value)
+{
+    return get_le(reader, value, 8);
+}
+
+int reader_get_int(struct Reader * reader, int * value)
+{
+    uint32_t bits;
+    if (reader_get_u32(reader, &bits))
+        return -1;
+    /* undo the two's complement encoding without relying on an out-of-range
+    unsigned to signed conversion */
+    *value = bits <= INT32_MAX ? (int) bits : -(int) (UINT32_MAX - bits) - 1;
+
+    return 0;
+}
+
+int reader_enter(struct Reader * reader)
+{
+    assert(reader);
+
+    if (reader->depth >= READER_MAX_DEPTH)
+        return -1;
+    reader->depth++;
+
+    return 0;
+}
+
+void reader_leave(struct Reader * reader)
+{
+    assert(reader && reader->depth);
+
+    reader->depth--;
+}
+
+/******************************************************************************
+ * TEXT
+*******************************************************************************/
+
+int buffer_print(struct Buffer * buffer, const char * text)
+{
+    size_t n = strlen(text);
+
+    buffer_put(buffer, text, n);
+    return (int) n;
+}
+
+/* The digits are produced two at a time from the end, out of a table of the
+hundred pairs */
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+int buffer_print_unsigned(struct Buffer * buffer, unsigned long long value)
+{
+    char digits[20];
+    char * start = digits + sizeof(digits);
+
+    while (value >= 100)
+    {
+        const char * pair = digit_pairs + 2 * (value % 100);
+        value /= 100;
+        *--start = pair[1];
+        *--start = pair[0];
+    }
+    if (value >= 10)
+    {
+        *--start = digit_pairs[2 * value + 1];
+        *--start = digit_pairs[2 * value];
+    }
+    else
+        *--start = (char) ('0' + value);
+
+    size_t n = (size_t) (digits + sizeof(digits) - start);
+    buffer_put(buffer, start, n);
+    return (int) n;
+}
+
+int buffer_print_int(struct Buffer * buffer, long long value)
+{
+    if (value >= 0)
+        return buffer_print_unsigned(buffer, (unsigned long long) value);
+
+    buffer_put(buffer, "-", 1);
+    /* negated in unsigned arithmetic, so that LLONG_MIN comes out right too */
+    return 1 + buffer_print_unsigned(buffer, 0ull - (unsigned long long) value);
+}
+
+int buffer_print_pointer(struct Buffer * buffer, const void * pointer)
+{
+    uintptr_t value = (uintptr_t) pointer;
+    char digits[2 + 2 * sizeof(value)];
+    char * start = digits + sizeof(digits);
+
+    if (!pointer)
+        return buffer_print(buffer, "(nil)");
+
+    do
+    {
+        *--start = "0123456789abcdef"[value & 0xf];
+        value >>= 4;
+    } while (value);
+    *--start = 'x';
+    *--start = '0';
+
+    size_t n = (size_t) (digits + sizeof(digits) - start);
+    buffer_put(buffer, start, n);
+    return (int) n;
+}
+
+#ifndef _WIN32
+
+int buffer_flush(int fd, struct Buffer * buffers, size_t n)
+{
+    size_t first = 0;       /* the first buffer not completely written */
+    size_t offset = 0;      /* and how much of it is */
+
+    assert(buffers || !n);
+    while (first < n)
+    {
+        struct iovec parts[BUFFER_FLUSH_PARTS];
+        int count = 0;
+
+        for (size_t i = first; i < n && count < BUFFER_FLUSH_PARTS; i++)
+        {
+            size_t skip = i == first ? offset : 0;
+            if (buffers[i].length > skip)
+            {
+                parts[count].iov_base = buffers[i].data + skip;
+                parts[count++].iov_len = buffers[i].length - skip;
+            }
+        }
+        if (!count)
+            break;
+
+        ssize_t written = writev(fd, parts, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+
+        size_t left = (size_t) written;
+        while (first < n && left >= buffers[first].length - offset)
+        {
+            left -= buffers[first++].length - offset;
+            offset = 0;
+        }
+        offset += left;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        buffers[i].length = 0;
+    return 0;
+}
+
+#else
+
+/* no writev() here: one write() per buffer */
+int buffer_flush(int fd, struct Buffer * buffers, size_t n)
+{
+    assert(buffers || !n);
+
+    for (size_t i = 0; i < n; i++)
+        for (size_t done = 0; done < buffers[i].length; )
+        {
+            int written = _write(fd, buffers[i].data + done, (unsigned) (buffers[i].length - done));
+            if (written < 0)
+                return -1;
+            done += (size_t) written;
+        }
+
+    for (size_t i = 0; i < n; i++)
+        buffers[i].length = 0;
+    return 0;
+}
+
+#endif
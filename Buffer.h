@@ -0,0 +1,75 @@
+#ifndef __BUFFER__H__SL
+#define __BUFFER__H__SL
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************
+ * BYTE BUFFERS
+ * struct Buffer is a caller-owned growable byte buffer: start from { 0 } and
+ * release the memory with buffer_free(). buffer_over() starts one in memory the
+ * caller supplies instead, such as an array on the stack, which it only leaves
+ * for the heap when it outgrows it. struct Reader walks over bytes owned by
+ * someone else, such as a Buffer or a mapped file.
+ * Multi-byte integers are always written little-endian.
+*******************************************************************************/
+
+struct Buffer
+{
+    unsigned char * data;
+    size_t length;
+    size_t capacity;
+    int borrowed;       /* data is the caller's memory, not to be realloc()ed or freed */
+};
+
+struct Reader
+{
+    const unsigned char * cursor;
+    const unsigned char * end;
+    unsigned depth;     /* of the objects being read inside one another */
+};
+
+struct Buffer buffer_over(void * memory, size_t capacity);
+unsigned char * buffer_reserve(struct Buffer * buffer, size_t n);
+void buffer_put(struct Buffer * buffer, const void * bytes, size_t n);
+void buffer_put_u16(struct Buffer * buffer, uint16_t value);
+void buffer_put_u32(struct Buffer * buffer, uint32_t value);
+void buffer_put_u64(struct Buffer * buffer, uint64_t value);
+void buffer_put_int(struct Buffer * buffer, int value);
+void buffer_free(struct Buffer * buffer);
+
+/* The readers return 0 on success and -1, consuming nothing, if the input is
+too short. */
+int reader_get(struct Reader * reader, void * bytes, size_t n);
+int reader_get_u16(struct Reader * reader, uint16_t * value);
+int reader_get_u32(struct Reader * reader, uint32_t * value);
+int reader_get_u64(struct Reader * reader, uint64_t * value);
+int reader_get_int(struct Reader * reader, int * value);
+
+/* An object that deserializes others inside it calls reader_enter() before and
+reader_leave() after. reader_enter() returns -1 once objects are nested
+READER_MAX_DEPTH deep, so that no input runs the reading thread out of stack. */
+#define READER_MAX_DEPTH    256
+
+int reader_enter(struct Reader * reader);
+void reader_leave(struct Reader * reader);
+
+/******************************************************************************
+ * TEXT
+ * Formatting for the sputo() methods without the printf() family: there is no
+ * format string to parse, no locale and no stream lock. Each function returns
+ * the number of bytes it appended. Pointers come out the way glibc prints %p.
+*******************************************************************************/
+
+int buffer_print(struct Buffer * buffer, const char * text);
+int buffer_print_int(struct Buffer * buffer, long long value);
+int buffer_print_unsigned(struct Buffer * buffer, unsigned long long value);
+int buffer_print_pointer(struct Buffer * buffer, const void * pointer);
+
+/* Write the contents of n buffers to a file descriptor, with as few writev()
+calls as the system allows, and empty them. Returns 0, or -1 with errno set when
+a write fails; the buffers are then left as they were, and a part of them may
+have been written. */
+int buffer_flush(int fd, struct Buffer * buffers, size_t n);
+
+#endif  /* !__BUFFER__H__SL */
@@ -0,0 +1,590 @@
+#include <assert.h>     /* for assert() */
+#include <stdint.h>     /* for SIZE_MAX */
+#include <limits.h>     /* for UINT_MAX */
+#include <string.h>     /* for memset() */
+#include <stdlib.h>     /* for realloc() */
+#include <stdatomic.h>  /* for atomic_int */
+#include <pthread.h>    /* for pthread_mutex_t */
+
+#include "Collector.h"
+#include "Object.h"
+#include "Object_struct.h"
+#include "Pool.h"
+
+#ifdef OBJECT_GC
+
+/* The mark of an object is the epoch of the last cycle that reached it, or one
+of these once a cycle has found it unreachable */
+#define MARK_DOOMED     0u  /* to be destroyed */
+#define MARK_ORDERED    1u  /* has its place in the order of destruction */
+#define MARK_SWEPT      2u  /* destroyed, but its memory not given back yet */
+#define MARK_EPOCH      3u  /* the first epoch */
+
+enum Phase
+{
+    PHASE_IDLE,
+    PHASE_MARK,         /* tracing from the roots */
+    PHASE_SCAN,         /* going through the heaps for what was not reached */
+    PHASE_ORDER,        /* putting that in the order to destroy it in */
+    PHASE_DESTROY,      /* running the dtors */
+    PHASE_FREE,         /* giving the memory back */
+};
+
+struct Heap
+{
+    void ** objects;
+    size_t count;
+    size_t capacity;
+};
+
+/* The condemned objects from the end of the run before up to end came from the
+heap of class id heap */
+struct Run
+{
+    size_t heap;
+    size_t end;
+};
+
+/* An entry on the stack of the depth-first walk that orders the unreachable
+objects: done once the objects it reports have been walked */
+struct Visit
+{
+    const void * object;
+    int done;
+};
+
+/* All of it is guarded by the lock, except that marking is also read without it,
+by gc_write(), and that the dtors run without it. Only the thread running them,
+which is sweeping, can reach the objects they destroy. */
+static pthread_mutex_t gc_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int marking;
+static _Thread_local int sweeping;
+static enum Phase phase;
+static unsigned epoch = MARK_EPOCH;
+static int stepping;
+
+static struct Heap * heaps;         /* indexed by class id */
+static size_t heap_count;
+static size_t tracked;
+
+static void *** roots;
+static size_t root_count, root_capacity;
+
+static const void ** gray;          /* marked, but not traced yet */
+static size_t gray_count, gray_capacity;
+
+static void ** condemned;           /* not reached, in the order of the heaps */
+static size_t condemned_count, condemned_capacity;
+static struct Run * runs;
+static size_t run_count, run_capacity;
+static struct Visit * walk;
+static size_t walk_count, walk_capacity;
+static const void ** order;         /* condemned objects, destroyed from the end */
+static size_t order_count, order_capacity;
+
+static size_t heap_cursor, cursor;  /* how far the phase in progress has got */
+static int emptied;                 /* the heap of the run being freed, at once */
+static size_t unreachable;          /* found by the cycle in progress */
+static size_t pending;              /* of those, not destroyed yet */
+static size_t cycles, reclaimed;
+
+/**
+ * @brief Make room for one more element at the end of a growing array.
+ *
+ * @return void* the array, which may have moved
+ */
+static void * reserve(void * array, size_t * capacity, size_t count, size_t size)
+{
+    if (count < *capacity)
+        return array;
+    size_t wanted = *capacity ? 2 * *capacity : 64;
+    array = realloc(array, wanted * size);
+    assert(array);
+    *capacity = wanted;
+    return array;
+}
+
+static int is_leaf(const void * object)
+{
+    const struct Class * class = ((const struct Object *) object)->class;
+    return class->trace == ((const struct Class *) Object)->trace;
+}
+
+/* the same as is_of(object, Class), without the checks */
+static int is_class(const void * object)
+{
+    const struct Class * class = ((const struct Object *) object)->class;
+    return class->display[1] == Class;
+}
+
+/******************************************************************************
+ * HEAPS
+ * Every object allocate() makes is kept in the heap of its class until it is
+ * given back; its header holds its index there, so that it can be taken out by
+ * moving the last object of the heap into its place.
+*******************************************************************************/
+
+static struct Heap * heap_of(const struct Class * class)
+{
+    if (class->id >= heap_count)
+    {
+        size_t wanted = heap_count ? heap_count : 16;
+        while (wanted <= class->id)
+            wanted *= 2;
+        heaps = realloc(heaps, wanted * sizeof(struct Heap));
+        assert(heaps);
+        memset(heaps + heap_count, 0, (wanted - heap_count) * sizeof(struct Heap));
+        heap_count = wanted;
+    }
+    return heaps + class->id;
+}
+
+static void forget(struct Heap * heap, void * object)
+{
+    struct Header * header = header_of(object);
+
+    void * last = heap->objects[--heap->count];
+    heap->objects[header->slot] = last;
+    header_of(last)->slot = header->slot;
+    tracked--;
+}
+
+static void push_gray(const void * object)
+{
+    gray = reserve(gray, &gray_capacity, gray_count, sizeof(const void *));
+    gray[gray_count++] = object;
+}
+
+/**
+ * @brief Start tracking an object that allocate() just made. It counts as marked
+ *        by the cycle in progress, if any, which it therefore survives; while the
+ *        cycle marks, it is also traced later on for what its ctor stores in it.
+ *        Class descriptors are kept for good and not tracked.
+ */
+void gc_track(void * object)
+{
+    if (is_class(object))
+        return;
+    pthread_mutex_lock(&gc_lock);
+    struct Heap * heap = heap_of(((const struct Object *) object)->class);
+    heap->objects = reserve(heap->objects, &heap->capacity, heap->count, sizeof(void *));
+
+    struct Header * header = header_of(object);
+    header->slot = heap->count;
+    header->mark = epoch;
+    heap->objects[heap->count++] = object;
+    tracked++;
+    if (phase == PHASE_MARK && !is_leaf(object))
+        push_gray(object);
+    pthread_mutex_unlock(&gc_lock);
+}
+
+/**
+ * @brief Stop tracking an object that deallocate() is giving back.
+ *
+ * @return int 1 if the memory may go back now, 0 if the collector still has the
+ *         object somewhere and gives the memory back when the cycle ends
+ */
+int gc_untrack(void * object)
+{
+    struct Header * header = header_of(object);
+    int now = 1;
+
+    if (is_class(object))
+        return now;
+    /* an owner being destroyed deletes what it owns */
+    if (sweeping && header->mark == MARK_ORDERED)
+    {
+        header->mark = MARK_SWEPT;
+        pending--;
+        return 0;
+    }
+
+    pthread_mutex_lock(&gc_lock);
+    assert(header->mark != MARK_SWEPT);
+    if (header->mark == MARK_DOOMED || header->mark == MARK_ORDERED)
+    {
+        /* the collector still has the object, to destroy */
+        header->mark = MARK_SWEPT;
+        pending--;
+        now = 0;
+    }
+    else if (phase == PHASE_MARK && header->mark == epoch && !is_leaf(object))
+    {
+        /* or to trace */
+        header->mark = MARK_SWEPT;
+        now = 0;
+    }
+    else
+        forget(heaps + ((const struct Object *) object)->class->id, object);
+    pthread_mutex_unlock(&gc_lock);
+
+    return now;
+}
+
+/******************************************************************************
+ * ROOTS
+*******************************************************************************/
+
+void gc_root(void ** root)
+{
+    assert(root);
+    pthread_mutex_lock(&gc_lock);
+    roots = reserve(roots, &root_capacity, root_count, sizeof(void **));
+    roots[root_count++] = root;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+void gc_unroot(void ** root)
+{
+    pthread_mutex_lock(&gc_lock);
+    for (size_t i = 0; i < root_count; i++)
+        if (roots[i] == root)
+        {
+            roots[i] = roots[--root_count];
+            break;
+        }
+    pthread_mutex_unlock(&gc_lock);
+}
+
+/******************************************************************************
+ * MARKING
+ * The marked objects that have yet to be traced wait on the gray stack; leaves
+ * are marked without going there. Marking is done once the stack is empty and
+ * the roots bring nothing new. Until then a reference stored in an object that
+ * has already been traced would go unseen, so gc_write() marks the object the
+ * reference is to, and gc_write_all() everything an object that moved reports.
+*******************************************************************************/
+
+static void mark(struct Tracer * tracer, const void * object)
+{
+    if (!object)
+        return;
+    struct Header * header = header_of(object);
+    if (header->mark == epoch || header->mark == MARK_SWEPT)
+        return;
+    header->mark = epoch;
+    if (!is_leaf(object))
+        push_gray(object);
+}
+
+static struct Tracer marker = { mark };
+
+void gc_write(const void * object)
+{
+    if (!object || !atomic_load_explicit(&marking, memory_order_relaxed))
+        return;
+    pthread_mutex_lock(&gc_lock);
+    if (phase == PHASE_MARK)
+        mark(&marker, object);
+    pthread_mutex_unlock(&gc_lock);
+}
+
+void gc_write_all(const void * self)
+{
+    if (!atomic_load_explicit(&marking, memory_order_relaxed) || is_leaf(self))
+        return;
+    pthread_mutex_lock(&gc_lock);
+    if (phase == PHASE_MARK)
+        trace(self, &marker);
+    pthread_mutex_unlock(&gc_lock);
+}
+
+static void mark_roots(void)
+{
+    for (size_t i = 0; i < root_count; i++)
+        mark(&marker, *roots[i]);
+}
+
+static void begin(void)
+{
+    epoch = epoch == UINT_MAX ? MARK_EPOCH : epoch + 1;
+    unreachable = 0;
+    phase = PHASE_MARK;
+    atomic_store_explicit(&marking, 1, memory_order_relaxed);
+    mark_roots();
+}
+
+static size_t mark_step(size_t budget)
+{
+    while (budget)
+    {
+        if (gray_count)
+        {
+            const void * object = gray[--gray_count];
+            budget--;
+            /* deleted since it was marked */
+            if (header_of(object)->mark != MARK_SWEPT)
+                trace(object, &marker);
+            continue;
+        }
+        mark_roots();
+        if (!gray_count)
+        {
+            atomic_store_explicit(&marking, 0, memory_order_relaxed);
+            phase = PHASE_SCAN;
+            heap_cursor = cursor = 0;
+            break;
+        }
+    }
+    return budget;
+}
+
+/******************************************************************************
+ * SWEEPING
+ * What the heaps hold unmarked is condemned. The condemned objects are destroyed
+ * in the reverse of the order in which a depth-first walk over what they report
+ * finishes them, which puts an object before those it reports unless they
+ * report each other; leaves come last. Destroying them in that order lets an
+ * owner delete what it owns, which then only needs its memory back, and has
+ * every dtor run while the objects it refers to are still intact. The memory
+ * goes back last, a run of objects from the same heap at a time.
+*******************************************************************************/
+
+static void push_visit(const void * object, int done)
+{
+    walk = reserve(walk, &walk_capacity, walk_count, sizeof(struct Visit));
+    walk[walk_count++] = (struct Visit) { object, done };
+}
+
+/* A leaf reports nothing, so it can go in the order as soon as it is found:
+first, to be destroyed after everything that may refer to it */
+static void order_leaf(const void * object)
+{
+    header_of(object)->mark = MARK_ORDERED;
+    order = reserve(order, &order_capacity, order_count, sizeof(const void *));
+    order[order_count++] = object;
+}
+
+static size_t scan_step(size_t budget)
+{
+    while (budget && heap_cursor < heap_count)
+    {
+        struct Heap * heap = heaps + heap_cursor;
+        if (cursor >= heap->count)
+        {
+            heap_cursor++;
+            cursor = 0;
+            continue;
+        }
+        void * object = heap->objects[cursor++];
+        struct Header * header = header_of(object);
+        budget--;
+        if (header->mark == epoch)
+            continue;
+        if (header->mark != MARK_SWEPT)
+        {
+            unreachable++;
+            pending++;
+            if (is_leaf(object))
+                order_leaf(object);
+            else
+            {
+                header->mark = MARK_DOOMED;
+                push_visit(object, 0);
+            }
+        }
+        condemned = reserve(condemned, &condemned_capacity, condemned_count, sizeof(void *));
+        condemned[condemned_count++] = object;
+        if (!run_count || runs[run_count - 1].heap != heap_cursor)
+        {
+            runs = reserve(runs, &run_capacity, run_count, sizeof(struct Run));
+            runs[run_count++].heap = heap_cursor;
+        }
+        runs[run_count - 1].end = condemned_count;
+    }
+    if (heap_cursor >= heap_count)
+        phase = PHASE_ORDER;
+    return budget;
+}
+
+static void visit_doomed(struct Tracer * tracer, const void * object)
+{
+    if (object && header_of(object)->mark == MARK_DOOMED)
+        push_visit(object, 0);
+}
+
+static struct Tracer orderer = { visit_doomed };
+
+/* The scan has put every other condemned object on the stack to start a walk from */
+static size_t order_step(size_t budget)
+{
+    while (budget)
+    {
+        if (!walk_count)
+        {
+            phase = PHASE_DESTROY;
+            cursor = order_count;
+            break;
+        }
+
+        struct Visit visit = walk[--walk_count];
+        struct Header * header = header_of(visit.object);
+        budget--;
+        if (!visit.done)
+        {
+            /* reported twice, or walked already */
+            if (header->mark != MARK_DOOMED)
+                continue;
+            header->mark = MARK_ORDERED;
+            push_visit(visit.object, 1);
+            trace(visit.object, &orderer);
+            continue;
+        }
+        order = reserve(order, &order_capacity, order_count, sizeof(const void *));
+        order[order_count++] = visit.object;
+    }
+    return budget;
+}
+
+static size_t destroy_step(size_t budget)
+{
+    pthread_mutex_unlock(&gc_lock);
+    sweeping = 1;
+    while (budget && pending)
+    {
+        assert(cursor);
+        void * object = (void *) order[--cursor];
+        struct Header * header = header_of(object);
+        /* its owner has deleted it */
+        if (header->mark == MARK_SWEPT)
+            continue;
+        header->mark = MARK_SWEPT;
+        pending--;
+        budget--;
+        OBJECT_COUNT(class_of(object), STATS_DESTROYED, 1);
+        dtor(object);
+    }
+    sweeping = 0;
+    pthread_mutex_lock(&gc_lock);
+
+    /* once the owners have deleted the rest */
+    if (!pending)
+    {
+        phase = PHASE_FREE;
+        order_count = 0;
+        cursor = condemned_count;
+    }
+    return budget;
+}
+
+static size_t free_step(size_t budget)
+{
+    while (budget && run_count)
+    {
+        const struct Run * run = runs + run_count - 1;
+        struct Heap * heap = heaps + run->heap;
+        size_t start = run_count > 1 ? run[-1].end : 0;
+
+        /* a heap that holds nothing but the run can be emptied at once */
+        if (cursor == run->end && heap->count == run->end - start)
+        {
+            tracked -= heap->count;
+            heap->count = 0;
+            emptied = 1;
+        }
+
+        /* the objects become their blocks as they are taken out of the heap */
+        const struct Class * class = class_of(condemned[cursor - 1]);
+        size_t begin = cursor - start > budget ? cursor - budget : start;
+        for (size_t k = begin; k < cursor; k++)
+        {
+            if (!emptied)
+                forget(heap, condemned[k]);
+            condemned[k] = header_of(condemned[k]);
+        }
+        pool_free_all(condemned + begin, cursor - begin, OBJECT_HEADER_SIZE + class->size);
+        budget -= cursor - begin;
+        cursor = begin;
+        if (cursor == start)
+        {
+            run_count--;
+            emptied = 0;
+        }
+    }
+    if (!run_count)
+    {
+        phase = PHASE_IDLE;
+        condemned_count = 0;
+        cycles++;
+        reclaimed += unreachable;
+    }
+    return budget;
+}
+
+/******************************************************************************
+ * CYCLES
+*******************************************************************************/
+
+int gc_step(size_t budget)
+{
+    pthread_mutex_lock(&gc_lock);
+    assert(!stepping);
+    stepping = 1;
+
+    if (phase == PHASE_IDLE)
+        begin();
+    if (!budget)
+        budget = 1;
+    while (budget && phase != PHASE_IDLE)
+        switch (phase)
+        {
+        case PHASE_MARK:
+            budget = mark_step(budget);
+            break;
+        case PHASE_SCAN:
+            budget = scan_step(budget);
+            break;
+        case PHASE_ORDER:
+            budget = order_step(budget);
+            break;
+        case PHASE_DESTROY:
+            budget = destroy_step(budget);
+            break;
+        case PHASE_FREE:
+            budget = free_step(budget);
+            break;
+        default:
+            break;
+        }
+
+    int done = phase == PHASE_IDLE;
+    stepping = 0;
+    pthread_mutex_unlock(&gc_lock);
+
+    return done;
+}
+
+size_t gc_collect(void)
+{
+    pthread_mutex_lock(&gc_lock);
+    size_t before = reclaimed;
+    int busy = phase != PHASE_IDLE;
+    pthread_mutex_unlock(&gc_lock);
+
+    if (busy)
+        while (!gc_step(SIZE_MAX))
+            ;
+    while (!gc_step(SIZE_MAX))
+        ;
+
+    pthread_mutex_lock(&gc_lock);
+    size_t count = reclaimed - before;
+    pthread_mutex_unlock(&gc_lock);
+
+    return count;
+}
+
+void gc_stats(struct GcStats * stats)
+{
+    assert(stats);
+    pthread_mutex_lock(&gc_lock);
+    stats->objects = tracked;
+    stats->roots = root_count;
+    stats->cycles = cycles;
+    stats->reclaimed = reclaimed;
+    stats->collecting = phase != PHASE_IDLE;
+    pthread_mutex_unlock(&gc_lock);
+}
+
+#endif  /* OBJECT_GC */
@@ -0,0 +1,72 @@
+#ifndef __COLLECTOR__H__SL
+#define __COLLECTOR__H__SL
+
+#include <stddef.h>
+
+/******************************************************************************
+ * COLLECTOR
+ * In a build with OBJECT_GC objects made by new() need not be delete()d: a
+ * mark-sweep collector reclaims the ones that cannot be reached from its roots.
+ * A root is a variable that holds an object made by new(), or NULL:
+ *
+ *   static void * scene;
+ *   gc_root(&scene);
+ *   scene = new(Group, 0, 0);
+ *   ...
+ *   gc_step(1000);     // once a frame, or gc_collect() now and then
+ *
+ * Each class has a heap of the objects it allocated, and the collector finds
+ * what an object refers to with the trace selector. Classes that keep Object's
+ * trace are leaves: they are never traced, so Point or Circle cost the collector
+ * no more than their entry in the heap. A trace method must not make or delete
+ * objects, and only visit objects made by new().
+ *
+ * A cycle first marks every object it can reach, then sweeps the others. The
+ * sweep destroys an unreachable object before the ones it reports, unless they
+ * report each other, so that an owner like a Group tears down its children
+ * itself, as delete() would. A class that deletes objects in its dtor must
+ * therefore report them from trace. The memory then goes back to the pool a
+ * class at a time, with one lock per run.
+ *
+ * gc_step() does a bounded amount of a cycle, about budget objects traced,
+ * examined, destroyed or freed, so that no pause is long. Between steps the
+ * program may go on making, changing and deleting objects, as long as
+ *   - an object a variable holds is rooted, or was made since the cycle began:
+ *     objects made during a cycle survive it,
+ *   - a class calls OBJECT_WRITE(object) after storing a reference to object
+ *     (see Object_struct.h), which the containers here do.
+ * delete() is still allowed for an object that is done with.
+ *
+ * Any thread may make and delete objects, but nothing a step can reach, which
+ * includes the objects made while a cycle marks, may change while the step runs,
+ * and only one thread at a time steps. Without OBJECT_GC there is no collector.
+*******************************************************************************/
+
+#ifdef OBJECT_GC
+
+struct GcStats
+{
+    size_t objects;     /* tracked, including unreachable ones not swept yet */
+    size_t roots;
+    size_t cycles;      /* completed */
+    size_t reclaimed;   /* objects the completed cycles found unreachable */
+    int collecting;     /* a cycle is in progress */
+};
+
+/* Add or remove a variable holding an object from the roots */
+void gc_root(void ** root);
+void gc_unroot(void ** root);
+
+/* Do about budget units of work on the cycle in progress, starting one if there
+is none. Returns 1 if the step completed the cycle. */
+int gc_step(size_t budget);
+
+/* Complete the cycle in progress, then run a whole new one. Returns the number of
+objects found unreachable. */
+size_t gc_collect(void);
+
+void gc_stats(struct GcStats * stats);
+
+#endif  /* OBJECT_GC */
+
+#endif  /* !__COLLECTOR__H__SL */
@@ -0,0 +1,427 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcpy() */
+#include <stdlib.h>     /* for malloc(), realloc(), free() */
+
+#include "HandleTable.h"
+#include "HandleTable_struct.h"
+#include "Pool.h"
+#include "Buffer.h"
+
+#define HANDLETABLE_MIN_CAPACITY    16
+#define HANDLETABLE_MAX_CAPACITY    ((size_t) UINT32_MAX)  /* slot indices fit in 32 bits */
+
+/******************************************************************************
+ * STORAGE
+*******************************************************************************/
+
+/* Give back the memory of an object that lives on elsewhere or is already torn
+down: the same as deallocate(), but not counted as a destruction */
+static void free_loose(void * object)
+{
+#ifdef OBJECT_GC
+    if (!gc_untrack(object))
+        return;
+#endif
+#ifdef OBJECT_HEADER
+    pool_free(header_of(object), OBJECT_HEADER_SIZE + size_of(object));
+#else
+    pool_free(object, size_of(object));
+#endif
+}
+
+/* Release whatever memory the object in the slot occupies */
+static void vacate(struct HandleTable * self, struct HandleSlot * slot)
+{
+    if (slot->link == HANDLE_LOOSE)
+        free_loose(slot->object);
+    else
+    {
+        struct HandleBlock * block = self->blocks + slot->link;
+        if (--block->live == 0)
+        {
+            free(block->memory);
+            block->memory = NULL;
+        }
+    }
+}
+
+static void destroy(struct HandleTable * self, struct HandleSlot * slot)
+{
+    void * object = slot->object;
+
+    OBJECT_COUNT(class_of(object), STATS_DESTROYED, 1);
+    dtor(object);
+    vacate(self, slot);
+    slot->object = NULL;
+}
+
+static void grow(struct HandleTable * self, size_t capacity)
+{
+    if (capacity > HANDLETABLE_MAX_CAPACITY)
+        capacity = HANDLETABLE_MAX_CAPACITY;
+    if (capacity <= self->capacity)
+        return;
+
+    struct HandleSlot * slots = realloc(self->slots, capacity * sizeof(*slots));
+    assert(slots);
+    self->slots = slots;
+    self->capacity = capacity;
+}
+
+static struct Handle put(struct HandleTable * self, void * object)
+{
+    uint32_t index;
+
+    if (self->free != HANDLE_END)
+    {
+        index = self->free;
+        self->free = self->slots[index].link;
+    }
+    else
+    {
+        if (self->used == self->capacity)
+            grow(self, 2 * self->capacity);
+        assert(self->used < self->capacity);
+        index = (uint32_t) self->used++;
+        self->slots[index].generation = 1;
+    }
+
+    struct HandleSlot * slot = self->slots + index;
+    slot->object = object;
+    slot->link = HANDLE_LOOSE;
+    self->count++;
+    OBJECT_WRITE(object);
+
+    return (struct Handle) { index, slot->generation };
+}
+
+static struct HandleSlot * slot_of(const struct HandleTable * self, struct Handle handle)
+{
+    if (handle.index >= self->used)
+        return NULL;
+
+    struct HandleSlot * slot = self->slots + handle.index;
+    return slot->object && slot->generation == handle.generation ? slot : NULL;
+}
+
+/******************************************************************************
+ * HANDLES
+*******************************************************************************/
+
+struct Handle handle_new(void * _self, const void * class, ...)
+{
+    struct HandleTable * self = _self;
+    assert(self);
+
+    void * object = allocate(class);
+
+    va_list arg_list;
+    va_start(arg_list, class);
+    object = ctor(object, &arg_list);
+    va_end(arg_list);
+
+    return put(self, object);
+}
+
+struct Handle handle_adopt(void * _self, void * object)
+{
+    struct HandleTable * self = _self;
+    assert(self && object);
+
+    return put(self, object);
+}
+
+void * handle_get(const void * _self, struct Handle handle)
+{
+    const struct HandleTable * self = _self;
+    assert(self);
+
+    struct HandleSlot * slot = slot_of(self, handle);
+    return slot ? slot->object : NULL;
+}
+
+int handle_delete(void * _self, struct Handle handle)
+{
+    struct HandleTable * self = _self;
+    assert(self);
+
+    struct HandleSlot * slot = slot_of(self, handle);
+    if (!slot)
+        return -1;
+
+    destroy(self, slot);
+    /* after 2^32 - 1 reuses a slot's generations come round again; 0 is skipped */
+    if (++slot->generation == 0)
+        slot->generation = 1;
+    slot->link = self->free;
+    self->free = handle.index;
+    self->count--;
+
+    return 0;
+}
+
+size_t handle_count(const void * _self)
+{
+    const struct HandleTable * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+void * handle_next(const void * _self, size_t * cursor, struct Handle * handle)
+{
+    const struct HandleTable * self = _self;
+    assert(self && cursor);
+
+    while (*cursor < self->used)
+    {
+        const struct HandleSlot * slot = self->slots + (*cursor)++;
+        if (slot->object)
+        {
+            if (handle)
+                *handle = (struct Handle) { (uint32_t) (*cursor - 1), slot->generation };
+            return slot->object;
+        }
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * COMPACTION
+ * The objects of a class are copied, in slot order, into a new block and the
+ * slots pointed at their new places. Memory of their own is given back at once,
+ * an older block once the last object has left it. A class whose objects fill
+ * one block exactly, and so were compacted before and have not changed since,
+ * is left where it is.
+*******************************************************************************/
+
+static uint32_t new_block(struct HandleTable * self, const struct Class * class, size_t capacity)
+{
+    size_t b = 0;
+
+    while (b < self->block_count && self->blocks[b].memory)
+        b++;
+    if (b == self->block_count)
+    {
+        struct HandleBlock * blocks = realloc(self->blocks, (b + 1) * sizeof(*blocks));
+        assert(blocks && b < HANDLE_LOOSE);
+        self->blocks = blocks;
+        self->block_count++;
+    }
+
+    struct HandleBlock * block = self->blocks + b;
+    block->memory = malloc(capacity * class->size);
+    assert(block->memory);
+    block->class = class;
+    block->capacity = capacity;
+    block->live = 0;
+
+    return (uint32_t) b;
+}
+
+static size_t compact_class(struct HandleTable * self, const struct Class * class)
+{
+    size_t n = 0;
+    uint32_t link = HANDLE_LOOSE;
+    int packed = 1;
+
+    for (size_t i = 0; i < self->used; i++)
+    {
+        const struct HandleSlot * slot = self->slots + i;
+        if (slot->object && is_a(slot->object, class))
+        {
+            if (n++ == 0)
+                link = slot->link;
+            packed = packed && slot->link == link;
+        }
+    }
+    if (!n || (packed && link != HANDLE_LOOSE && self->blocks[link].capacity == n))
+        return 0;
+
+    uint32_t b = new_block(self, class, n);
+    struct HandleBlock * block = self->blocks + b;
+
+    for (size_t i = 0; i < self->used; i++)
+    {
+        struct HandleSlot * slot = self->slots + i;
+        if (slot->object && is_a(slot->object, class))
+        {
+            void * moved = memcpy(block->memory + block->live++ * class->size, slot->object, class->size);
+            vacate(self, slot);
+            slot->object = moved;
+            slot->link = b;
+            OBJECT_WRITE_ALL(moved);
+        }
+    }
+    return n;
+}
+
+size_t handle_compact(void * _self, const void * class)
+{
+    struct HandleTable * self = _self;
+    assert(self);
+
+    if (class)
+        return compact_class(self, class);
+
+    /* every class that has an object in the table, each once */
+    const struct Class ** classes = NULL;
+    size_t count = 0, moved = 0;
+
+    for (size_t i = 0; i < self->used; i++)
+    {
+        if (!self->slots[i].object)
+            continue;
+
+        const struct Class * of = class_of(self->slots[i].object);
+        size_t c = 0;
+        while (c < count && classes[c] != of)
+            c++;
+        if (c == count)
+        {
+            const struct Class ** more = realloc(classes, (count + 1) * sizeof(*classes));
+            assert(more);
+            classes = more;
+            classes[count++] = of;
+        }
+    }
+    for (size_t c = 0; c < count; c++)
+        moved += compact_class(self, classes[c]);
+
+    free(classes);
+    return moved;
+}
+
+/******************************************************************************
+ * HANDLETABLE CLASS METHODS
+*******************************************************************************/
+
+static void * HandleTable_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct HandleTable * self = super_ctor(HandleTable, _self, arglist_ptr);
+    size_t capacity = va_arg(*arglist_ptr, size_t);
+
+    self->free = HANDLE_END;
+    grow(self, capacity > HANDLETABLE_MIN_CAPACITY ? capacity : HANDLETABLE_MIN_CAPACITY);
+
+    return self;
+}
+
+static void * HandleTable_dtor(void * _self)
+{
+    struct HandleTable * self = _self;
+
+    for (size_t i = 0; i < self->used; i++)
+        if (self->slots[i].object)
+            destroy(self, self->slots + i);
+    free(self->slots);
+    free(self->blocks);
+
+    return super_dtor(HandleTable, self);
+}
+
+/* An object with memory of its own is reported; one in a block is not an
+object the collector knows, so it is traced in turn */
+static void HandleTable_trace(const void * _self, struct Tracer * tracer)
+{
+    const struct HandleTable * self = _self;
+
+    for (size_t i = 0; i < self->used; i++)
+    {
+        const struct HandleSlot * slot = self->slots + i;
+        if (!slot->object)
+            continue;
+        if (slot->link == HANDLE_LOOSE)
+            tracer->visit(tracer, slot->object);
+        else
+            trace(slot->object, tracer);
+    }
+}
+
+static int HandleTable_sputo(const void * _self, struct Buffer * out)
+{
+    const struct HandleTable * self = _self;
+
+    int n = buffer_print(out, "HandleTable of ");
+    n += buffer_print_unsigned(out, self->count);
+    n += buffer_print(out, " objects at ");
+    n += buffer_print_pointer(out, _self);
+    return n + buffer_print(out, "\n");
+}
+
+/* The copy has the same handles, each naming a copy() of the original object
+with memory of its own. */
+static void * HandleTable_copy(const void * _self)
+{
+    const struct HandleTable * self = _self;
+    struct HandleTable * replica = super_copy(HandleTable, self);
+
+    replica->slots = malloc(self->capacity * sizeof(*replica->slots));
+    assert(replica->slots);
+    memcpy(replica->slots, self->slots, self->used * sizeof(*replica->slots));
+    replica->blocks = NULL;
+    replica->block_count = 0;
+
+    for (size_t i = 0; i < self->used; i++)
+    {
+        struct HandleSlot * slot = replica->slots + i;
+        if (!slot->object)
+            continue;
+
+        slot->object = copy(slot->object);
+        slot->link = HANDLE_LOOSE;
+        if (!slot->object)
+        {
+            /* leave the originals the rest of the slots still point to alone */
+            for (size_t j = i + 1; j < replica->used; j++)
+                replica->slots[j].object = NULL;
+            HandleTable_dtor(replica);
+            deallocate(replica);
+            return NULL;
+        }
+    }
+    return replica;
+}
+
+/* The objects are of any class; store them with an Archive instead */
+static int HandleTable_serialize(const void * _self, struct Buffer * out)
+{
+    fprintf(stderr, "HandleTable: cannot serialize, archive the objects instead\n");
+
+    return -1;
+}
+
+static void * HandleTable_deserialize(void * _self, struct Reader * in)
+{
+    return NULL;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * HandleTable;
+
+static atomic_int handletable_once;
+
+static void buildHandleTable(void)
+{
+    HandleTable = new(
+        Class,
+        "HandleTable",
+        Object,
+        sizeof(struct HandleTable),
+        ctor, HandleTable_ctor,
+        dtor, HandleTable_dtor,
+        sputo, HandleTable_sputo,
+        copy, HandleTable_copy,
+        serialize, HandleTable_serialize,
+        deserialize, HandleTable_deserialize,
+        trace, HandleTable_trace,
+        NULL);
+}
+
+void initHandleTable(void)
+{
+    class_once(&handletable_once, buildHandleTable);
+}
@@ -0,0 +1,64 @@
+#ifndef __HANDLETABLE__H__SL
+#define __HANDLETABLE__H__SL
+
+#include <stdint.h>
+
+#include "Object.h"
+
+/******************************************************************************
+ * HANDLE TABLE
+ * new(HandleTable, (size_t) capacity) creates a table that owns objects and
+ * names them by handle instead of by address. A handle is the index of a slot
+ * in the table and the generation the slot was at when the object was put
+ * there; deleting the object moves the slot to the next generation, so an old
+ * handle is recognized as stale instead of leading to freed memory.
+ *
+ * Because nothing outside the table holds their addresses, the objects can be
+ * moved: handle_compact() copies the live objects of a class into one block,
+ * in handle order, and gives back the memory they were scattered over. Objects
+ * are moved with memcpy(), like the elements of a Vector, so they must not
+ * point into themselves or be pointed to from elsewhere. An address from
+ * handle_get() is only good until the next compaction.
+ *
+ * The objects belong to the table: they are destroyed with handle_delete() or
+ * with the table, never with delete(). A table is not safe to change from
+ * several threads at once.
+*******************************************************************************/
+
+extern const void * HandleTable;
+
+struct Handle
+{
+    uint32_t index;
+    uint32_t generation;    /* never 0 for a handle the table gave out */
+};
+
+/* A handle that never names an object */
+#define HANDLE_NONE ((struct Handle) { 0, 0 })
+
+/* Construct an object in the table: the arguments go to the class's ctor */
+struct Handle handle_new(void * table, const void * class, ...);
+
+/* Take over an object made by new() */
+struct Handle handle_adopt(void * table, void * object);
+
+/* The object, or NULL when the handle is stale */
+void * handle_get(const void * table, struct Handle handle);
+
+/* Destroy the object. Returns -1, and does nothing, when the handle is stale. */
+int handle_delete(void * table, struct Handle handle);
+
+size_t handle_count(const void * table);
+
+/* Visit every object in handle order: start with *cursor = 0 and call until
+NULL comes back. handle, if not NULL, receives the object's handle. */
+void * handle_next(const void * table, size_t * cursor, struct Handle * handle);
+
+/* Move the objects of exactly class, or of every class when class is NULL,
+into contiguous storage. Returns the number of objects moved. */
+size_t handle_compact(void * table, const void * class);
+
+/* initHandleTable is used to set up the class descriptor for HandleTable */
+void initHandleTable(void);
+
+#endif  /* !__HANDLETABLE__H__SL */
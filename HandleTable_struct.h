@@ -0,0 +1,44 @@
+#ifndef __HANDLETABLE_STRUCT__H__SL
+#define __HANDLETABLE_STRUCT__H__SL
+
+#include "Object_struct.h"
+#include "HandleTable.h"
+
+/******************************************************************************
+ * HandleTable structure
+*******************************************************************************/
+/* An object either has memory of its own, from allocate(), or sits in one of
+the blocks handle_compact() made; a block is given back once the last object in
+it is gone. A free slot holds NULL and links to the next free slot, and keeps
+its generation so the slot's next object gets a new one. */
+#define HANDLE_LOOSE    UINT32_MAX  /* block of an object with memory of its own */
+#define HANDLE_END      UINT32_MAX  /* end of the free list */
+
+struct HandleSlot
+{
+    void * object;
+    uint32_t generation;
+    uint32_t link;      /* the block of a live object, the next free slot otherwise */
+};
+
+struct HandleBlock
+{
+    unsigned char * memory;     /* NULL for an unused entry */
+    const struct Class * class;
+    size_t capacity;            /* objects it was made for */
+    size_t live;
+};
+
+struct HandleTable
+{
+    const struct Object _;
+    struct HandleSlot * slots;
+    size_t count;
+    size_t used;        /* slots that ever held an object */
+    size_t capacity;
+    uint32_t free;      /* first free slot below used */
+    struct HandleBlock * blocks;
+    size_t block_count;
+};
+
+#endif  /* !__HANDLETABLE_STRUCT__H__SL */
@@ -0,0 +1,404 @@
+#include <assert.h>     /* for assert() */
+#include <limits.h>     /* for CHAR_BIT */
+#include <string.h>     /* for memcpy() */
+#include <stdlib.h>     /* for malloc(), calloc(), free() */
+
+#include "HashSet.h"
+#include "HashSet_struct.h"
+
+#define HASHSET_MIN_CAPACITY    8
+
+/* 2^64 divided by the golden ratio: multiplying by it spreads consecutive codes
+over the whole word, so the top bits make a good slot index */
+#define FIBONACCI   ((size_t) 11400714819323198485u)
+
+/******************************************************************************
+ * STATIC METHODS
+*******************************************************************************/
+
+static size_t code_of(const void * element)
+{
+    size_t code = hash(element);
+
+    /* 0 is reserved for empty slots */
+    return code ? code : 1;
+}
+
+static size_t home(const struct HashSet * self, size_t code)
+{
+    return (code * FIBONACCI) >> self->shift;
+}
+
+/**
+ * @brief The smallest power of two that holds count elements without going over
+ *        the maximum load.
+ */
+static size_t capacity_for(const struct HashSet * self, size_t count)
+{
+    size_t capacity = HASHSET_MIN_CAPACITY;
+
+    while ((double) count > capacity * self->max_load)
+        capacity *= 2;
+    return capacity;
+}
+
+/**
+ * @brief Put an element that is known not to be in the table yet into the first
+ *        empty slot of its probe.
+ */
+static void place(struct HashSet * self, size_t code, void * key, void * value)
+{
+    size_t mask = self->capacity - 1;
+    size_t i = home(self, code);
+
+    while (self->hashes[i])
+        i = (i + 1) & mask;
+    self->hashes[i] = code;
+    self->keys[i] = key;
+    if (self->values)
+        self->values[i] = value;
+}
+
+static void resize(struct HashSet * self, size_t capacity)
+{
+    size_t * hashes = self->hashes;
+    void ** keys = self->keys;
+    void ** values = self->values;
+    size_t old_capacity = self->capacity;
+
+    self->capacity = capacity;
+    self->shift = sizeof(size_t) * CHAR_BIT;
+    for (size_t c = capacity; c > 1; c >>= 1)
+        self->shift--;
+    /* max_load is below 1, so there is always an empty slot to end a probe */
+    self->limit = (size_t) (capacity * self->max_load);
+
+    self->hashes = calloc(capacity, sizeof(*self->hashes));
+    self->keys = malloc(capacity * sizeof(*self->keys));
+    assert(self->hashes && self->keys);
+    if (values)
+    {
+        self->values = malloc(capacity * sizeof(*self->values));
+        assert(self->values);
+    }
+
+    for (size_t i = 0; i < old_capacity; i++)
+        if (hashes[i])
+            place(self, hashes[i], keys[i], values ? values[i] : NULL);
+
+    free(hashes);
+    free(keys);
+    free(values);
+}
+
+/**
+ * @brief Follow the probe of key. Returns the slot of the element equal to key
+ *        or, if there is none, the empty slot that ends the probe.
+ */
+static size_t probe(const struct HashSet * self, const void * key, size_t code)
+{
+    size_t mask = self->capacity - 1;
+    size_t i = home(self, code);
+
+    for (; self->hashes[i]; i = (i + 1) & mask)
+        if (self->hashes[i] == code && (self->keys[i] == key || !differ(self->keys[i], key)))
+            break;
+    return i;
+}
+
+/**
+ * @brief Find the slot of key, adding key to the table if it is not there yet.
+ *        A new map entry starts out with a NULL value.
+ */
+static size_t insert(struct HashSet * self, void * key)
+{
+    size_t code = code_of(key);
+    size_t i = probe(self, key, code);
+
+    if (self->hashes[i])
+        return i;
+    if (self->count >= self->limit)
+    {
+        resize(self, self->capacity * 2);
+        i = probe(self, key, code);
+    }
+    self->hashes[i] = code;
+    self->keys[i] = key;
+    if (self->values)
+        self->values[i] = NULL;
+    self->count++;
+    OBJECT_WRITE(key);
+
+    return i;
+}
+
+/**
+ * @brief Empty slot i. Instead of leaving a tombstone, the elements after it in
+ *        the same cluster are shifted back over the gap unless that would put
+ *        them in front of their home slot.
+ */
+static void erase(struct HashSet * self, size_t i)
+{
+    size_t mask = self->capacity - 1;
+
+    for (size_t j = (i + 1) & mask; self->hashes[j]; j = (j + 1) & mask)
+    {
+        if (((j - home(self, self->hashes[j])) & mask) < ((j - i) & mask))
+            continue;
+        self->hashes[i] = self->hashes[j];
+        self->keys[i] = self->keys[j];
+        if (self->values)
+            self->values[i] = self->values[j];
+        i = j;
+    }
+    self->hashes[i] = 0;
+    self->count--;
+}
+
+/******************************************************************************
+ * SET AND MAP FUNCTIONS
+*******************************************************************************/
+
+size_t set_count(const void * _self)
+{
+    const struct HashSet * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+void * set_add(void * _self, void * element)
+{
+    struct HashSet * self = _self;
+    assert(self && element);
+
+    size_t i = insert(self, element);
+    return self->keys[i];
+}
+
+void * set_find(const void * _self, const void * key)
+{
+    const struct HashSet * self = _self;
+    assert(self && key);
+
+    size_t i = probe(self, key, code_of(key));
+    return self->hashes[i] ? self->keys[i] : NULL;
+}
+
+/**
+ * @brief Remove the element equal to key.
+ *
+ * @return void* the element that was removed, or NULL if there was none
+ */
+void * set_remove(void * _self, const void * key)
+{
+    struct HashSet * self = _self;
+    assert(self && key);
+
+    size_t i = probe(self, key, code_of(key));
+    if (!self->hashes[i])
+        return NULL;
+
+    void * element = self->keys[i];
+    erase(self, i);
+    return element;
+}
+
+void * map_put(void * _self, void * key, void * value)
+{
+    struct HashSet * self = _self;
+    assert(self && self->values && key);
+
+    size_t i = insert(self, key);
+    void * previous = self->values[i];
+    self->values[i] = value;
+    OBJECT_WRITE(value);
+
+    return previous;
+}
+
+void * map_get(const void * _self, const void * key)
+{
+    const struct HashSet * self = _self;
+    assert(self && self->values && key);
+
+    size_t i = probe(self, key, code_of(key));
+    return self->hashes[i] ? self->values[i] : NULL;
+}
+
+/**
+ * @brief Remove the entry for key.
+ *
+ * @return void* the value key had, or NULL if there was no entry
+ */
+void * map_remove(void * _self, const void * key)
+{
+    struct HashSet * self = _self;
+    assert(self && self->values && key);
+
+    size_t i = probe(self, key, code_of(key));
+    if (!self->hashes[i])
+        return NULL;
+
+    void * value = self->values[i];
+    erase(self, i);
+    return value;
+}
+
+void * set_next(const void * _self, size_t * cursor, void ** value)
+{
+    const struct HashSet * self = _self;
+    assert(self && cursor);
+
+    for (size_t i = *cursor; i < self->capacity; i++)
+        if (self->hashes[i])
+        {
+            *cursor = i + 1;
+            if (value)
+                *value = self->values ? self->values[i] : NULL;
+            return self->keys[i];
+        }
+    *cursor = self->capacity;
+    return NULL;
+}
+
+void set_load_factor(void * _self, double max_load)
+{
+    struct HashSet * self = _self;
+    assert(self && max_load >= 0.1 && max_load <= 0.95);
+
+    self->max_load = max_load;
+    size_t capacity = capacity_for(self, self->count);
+    if (capacity > self->capacity)
+        resize(self, capacity);
+    else
+        self->limit = (size_t) (self->capacity * max_load);
+}
+
+/******************************************************************************
+ * HASHSET CLASS METHODS
+*******************************************************************************/
+
+static void * HashSet_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct HashSet * self = super_ctor(HashSet, _self, arglist_ptr);
+
+    self->max_load = HASHSET_LOAD_FACTOR;
+    resize(self, capacity_for(self, va_arg(*arglist_ptr, size_t)));
+
+    return self;
+}
+
+static void * HashSet_dtor(void * _self)
+{
+    struct HashSet * self = _self;
+
+    free(self->hashes);
+    free(self->keys);
+    free(self->values);
+
+    return super_dtor(HashSet, self);
+}
+
+static void * duplicate(const void * block, size_t size)
+{
+    void * copy = malloc(size);
+    assert(copy);
+
+    return memcpy(copy, block, size);
+}
+
+/* The copy has tables of its own but shares the elements, keys and values */
+static void * HashSet_copy(const void * _self)
+{
+    const struct HashSet * self = _self;
+    struct HashSet * replica = super_copy(HashSet, self);
+
+    replica->hashes = duplicate(self->hashes, self->capacity * sizeof(*self->hashes));
+    replica->keys = duplicate(self->keys, self->capacity * sizeof(*self->keys));
+    if (self->values)
+        replica->values = duplicate(self->values, self->capacity * sizeof(*self->values));
+
+    return replica;
+}
+
+/* The elements, keys and values are not owned, but the table refers to them */
+static void HashSet_trace(const void * _self, struct Tracer * tracer)
+{
+    const struct HashSet * self = _self;
+
+    for (size_t i = 0; i < self->capacity; i++)
+        if (self->hashes[i])
+        {
+            tracer->visit(tracer, self->keys[i]);
+            if (self->values && self->values[i])
+                tracer->visit(tracer, self->values[i]);
+        }
+}
+
+/* A table only holds pointers to objects it does not own, so it has nothing of its
+own to write. Serialize the elements themselves instead. */
+static int HashSet_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Class * class = class_of(_self);
+    fprintf(stderr, "%s: cannot serialize table\n", class->name);
+
+    return -1;
+}
+
+static void * HashSet_deserialize(void * _self, struct Reader * in)
+{
+    return NULL;
+}
+
+/******************************************************************************
+ * HASHMAP CLASS METHODS
+*******************************************************************************/
+
+static void * HashMap_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct HashSet * self = super_ctor(HashMap, _self, arglist_ptr);
+
+    /* from here on resize() reallocates the values along with the keys */
+    self->values = malloc(self->capacity * sizeof(*self->values));
+    assert(self->values);
+
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * HashSet;
+const void * HashMap;
+
+static atomic_int hash_set_once;
+
+static void buildHashSet(void)
+{
+    HashSet = new(
+        Class,
+        "HashSet",
+        Object,
+        sizeof(struct HashSet),
+        ctor, HashSet_ctor,
+        dtor, HashSet_dtor,
+        copy, HashSet_copy,
+        serialize, HashSet_serialize,
+        deserialize, HashSet_deserialize,
+        trace, HashSet_trace,
+        NULL);
+    HashMap = new(
+        Class,
+        "HashMap",
+        HashSet,
+        sizeof(struct HashSet),
+        ctor, HashMap_ctor,
+        NULL);
+}
+
+void initHashSet(void)
+{
+    class_once(&hash_set_once, buildHashSet);
+}
@@ -0,0 +1,41 @@
+#ifndef __HASHSET__H__SL
+#define __HASHSET__H__SL
+
+#include "Object.h"
+
+/* new(HashSet, (size_t) capacity) and new(HashMap, (size_t) capacity) create
+empty tables with room for capacity elements before the first rehash. Elements
+are compared with differ() and hashed with hash(). The tables hold pointers to
+the elements and keys but do not own them: deleting a table leaves them alone,
+and an element must not change in a way that affects its hash while it is in a
+table. */
+extern const void * HashSet;
+extern const void * HashMap;
+
+#define HASHSET_LOAD_FACTOR 0.75
+
+size_t set_count(const void * set);
+
+/* Add element unless an equal one is there already. Returns the element that is
+in the set afterwards, so set_add(set, e) != e means e was a duplicate. */
+void * set_add(void * set, void * element);
+void * set_find(const void * set, const void * key);
+void * set_remove(void * set, const void * key);
+
+/* Associate value with key. Returns the value key had before, or NULL. */
+void * map_put(void * map, void * key, void * value);
+void * map_get(const void * map, const void * key);
+void * map_remove(void * map, const void * key);
+
+/* Visit every element (or key) in no particular order: start with *cursor = 0
+and call until NULL comes back. value, if not NULL, receives a map's value. */
+void * set_next(const void * set, size_t * cursor, void ** value);
+
+/* The table grows once count / capacity would go over max_load, which must lie
+between 0.1 and 0.95. Lower values mean shorter probes and more memory. */
+void set_load_factor(void * set, double max_load);
+
+/* initHashSet is used to set up the class descriptors for both tables */
+void initHashSet(void);
+
+#endif  /* !__HASHSET__H__SL */
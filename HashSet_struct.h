@@ -0,0 +1,28 @@
+#ifndef __HASHSET_STRUCT__H__SL
+#define __HASHSET_STRUCT__H__SL
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * HashSet structure
+*******************************************************************************/
+/* Open addressing with linear probing. The hash code of every element is kept
+in its own array next to the element pointers, so a probe walks a run of
+consecutive hash codes and only calls differ() when two codes match. A stored
+code of 0 marks an empty slot. values is only allocated for HashMap. The
+capacity is a power of two; the home slot of a code is its top bits after a
+multiplication, so weak hash() functions still spread out. */
+struct HashSet
+{
+    const struct Object _;
+    size_t count;
+    size_t capacity;
+    size_t limit;       /* count that triggers the next rehash */
+    unsigned shift;     /* code >> shift is the home slot */
+    double max_load;
+    size_t * hashes;
+    void ** keys;
+    void ** values;
+};
+
+#endif  /* !__HASHSET_STRUCT__H__SL */
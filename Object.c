@@ -1,335 +1,1021 @@
-#include <assert.h>     /* for assert() */
-#include <stddef.h>     /* for offsetof() */
-#include <string.h>     /* for memcpy() */
-#include <stdlib.h>     /* for calloc() */
-
-#include "Object.h"
-#include "Object_struct.h"
-
-/******************************************************************************
- * STATIC METHODS
- * These helper functions are available to outside files too.
-*******************************************************************************/
-
-const void * class_of(const void * _self)
-{
-    const struct Object * self = _self;
-    assert(self && self->class);
-
-    return self->class;
-}
-
-size_t size_of(const void * _self)
-{
-    const struct Class * class = class_of(_self);
-
-    return class->size;
-}
-
-const void * super(const void * _self)
-{
-    const struct Class * self = _self;
-    assert(self && self->super);
-
-    return self->super;
-}
-
-/******************************************************************************
- * GENERIC SELECTORS
- * Functions that are used to call the other methods defined in the class descriptor
-*******************************************************************************/
-
-/**
- * @brief Selector function that will call the actual ctor function defined in the class.
- *        Ctor aids in the creation of a new object
- *
- * @param _self the object to call it for
- * @param arg_list_ptr the optional list of arguments
- * @return void* return a generic pointer pointing to the constructed object
- */
-void * ctor(void * _self, va_list * arg_list_ptr)
-{
-    const struct Class * class = class_of(_self);
-    assert(class->ctor);
-
-    return class->ctor(_self, arg_list_ptr);
-}
-
-/**
- * @brief Selector function that will call the actual destructor given by the class descriptor.
- *        Dtor aids in the reclaimation of memory when destroying an object
- *
- * @param _self the object to call it for
- * @return void* return a generic pointer pointing to the object for further deconstruction
- */
-void * dtor(void * _self)
-{
-    const struct Class * class = class_of(_self);
-    assert(class->dtor);
-
-    return class->dtor(_self);
-}
-
-/**
- * @brief Selector fuctions to call the actual differ function defined in the class descriptor.
- *        Differ check if two objects are different from each other.
- *
- * @param _self the object to call it for
- * @param other the object to compare
- * @return int return the value returned by the class-defined differ function
- */
-int differ(const void * _self, const void * other)
-{
-    const struct Class * class = class_of(_self);
-    assert(class->differ);
-
-    return class->differ(_self, other);
-}
-
-/**
- * @brief Selector function to call the actual puto function defined by the class descriptor.
- *        Puto prints the object out to a file.
- *
- * @param _self the object to print
- * @param file_ptr the file to print into
- * @return int the value returned by the class-defined puto function
- */
-int puto(const void * _self, FILE * file_ptr)
-{
-    const struct Class * class = class_of(_self);
-    assert(class->puto);
-
-    return class->puto(_self, file_ptr);
-}
-
-/******************************************************************************
- * MEMORY MANAGEMENT FUNCTIONS
- * new and delete are called whenever a new object is created or destroyed
-*******************************************************************************/
-
-void * new(const void * _class, ...)
-{
-    const struct Class * class = _class;
-    assert(class && class->size);
-
-    struct Object * object = NULL;
-    object = calloc(1, class->size);
-    assert(object);
-    object->class = class;
-
-    va_list arg_list;
-    va_start(arg_list, _class);
-    object = ctor(object, &arg_list);
-    va_end(arg_list);
-
-    return object;
-}
-
-void delete(void * _self)
-{
-    if (_self)
-        free(dtor(_self));
-    _self = NULL;
-}
-/******************************************************************************
- * SUPER CLASS SELECTORS
- * Functions that are called by any subclasses to access its superclass methods.
-*******************************************************************************/
-
-void * super_ctor(const void * _class, void * _self, va_list * arg_list_ptr)
-{
-    const struct Class * superclass = super(_class);
-    assert(_self && superclass->ctor);
-
-    return superclass->ctor(_self, arg_list_ptr);
-}
-
-void * super_dtor(const void * _class, void * _self)
-{
-    const struct Class * superclass = super(_class);
-    assert(_self && superclass->dtor);
-
-    return superclass->dtor(_self);
-}
-
-int super_differ(const void * _class, const void * _self, const void* other)
-{
-    const struct Class* superclass = super(_class);
-
-    assert(_self && superclass->differ);
-    return superclass->differ(_self, other);
-}
-
-int super_puto(const void * _class, const void * _self, FILE * file_ptr)
-{
-    const struct Class * superclass = super(_class);
-
-    assert(_self && superclass->puto);
-    return superclass->puto(_self, file_ptr);
-}
-
-/******************************************************************************
- * OBJECT CLASS METHODS
- * Methods that are unique to the Object class. Since Object is the base class of everything,
- * its method is the default of all its subclasses, including the Class metaclass.
-*******************************************************************************/
-
-/**
- * @brief By the time the contructor of Object is called, the new() method has already created
- * a pointer to the object and allocated a chunk of memory to it. It has also copied the class
- * descriptor pointer into the only field that Object has, the "class" field. Therefore there
- * is nothing for Object_ctor to do.
- *
- * @param _self the pointer to the Object
- * @param arglist_ptr the pointer to the optional list of arguments, will always be empty for
- *                    Object since we don't have extra data aside from the class descriptor.
- * @return void* the pointer to the object
- */
-static void * Object_ctor(void * _self, va_list * arglist_ptr)
-{
-    return _self;
-}
-
-/**
- * @brief "Delete" all the data in Object. Since Object has only one data field which is
- * the class descriptor pointer, which is the responsibility of delete(), we do nothing here
- *
- * @param _self pointer to the Object to be destructed
- */
-static void * Object_dtor(void * _self)
-{
-    return _self;
-}
-
-static int Object_differ(const void * _self, const void * other)
-{
-    return (_self != other);
-}
-
-static int Object_puto(const void * _self, FILE * file_ptr)
-{
-    const struct Class * class = class_of(_self);
-
-    return fprintf(file_ptr, "%s at %p\n", class->name, _self);
-}
-
-/******************************************************************************
- * CLASS METACLASS METHODS
- * Methods that are unique to the Class metaclass. It is only used to create a new class
- * descriptor so it only really ctor method, the dtor method is there to ensure that we
- * prevent accidental deletion of class descriptors.
-*******************************************************************************/
-
-static void * Class_ctor(void * _self, va_list * arglist_ptr)
-{
-    /* "self" is a class descriptor so cast it as such */
-    struct Class * self = _self;
-
-    /* pass the values in the arg list into self */
-    self->name = va_arg(*arglist_ptr, char *);
-    self->super = va_arg(*arglist_ptr, struct Class *);
-    self->size = va_arg(*arglist_ptr, size_t);
-    assert(self->super);
-
-    /* Now is the hard part, we need to pass all the methods into
-    their correct position on the class descriptor */
-    /* First find the offset of the ctor method inside the class struct */
-    const size_t offset = offsetof(struct Class, ctor);
-    /* Here we assume that the superclass descriptor has been constructed.
-    if so we can copy all of its methods to this newly created class descriptor
-    first, then later we can just modify the ones we define in the arg_list */
-    /**
-     * Here we have:
-     * (char *) self + offset : address of self + offset is the destination to copy the
-     *   data to. Casted to char pointer because char is guaranteed to be 1 byte, therefore
-     *   its pointer arithmetic will be equivalent to pointer-to-byte arithmetic. As in,
-     *   when you add or substract 1 to the pointer, the address is moved 1 byte forward or
-     *   backward.
-     * (char *) self->super + offset: the data come from the super class descriptor starting
-     *   at offset.
-     * size_of(self->super) - offset: size_of(self->super) is the size of the entire
-     *   superclass descriptor. Since we only need to copy from the position of offset
-     *   to the end, we substract offset from the total size to get the correct chunk.
-    **/
-    memcpy((char *) self + offset, (char *) self->super + offset, size_of(self->super) - offset);
-
-    /* pointer to any type usually have the same size, except for the pointer to function. on
-    some system, the pointer to function may have different value since it's not part of the
-    data section. Therefore casting between void *, aka generic pointer and a function pointer
-    is not allowed. We can create a new type using typedef, and this new type will be in the
-    type of a pointer to generic function */
-    typedef void (*func_ptr)();
-    func_ptr selector;
-
-    /* copy the arglist to a new one so we can reuse the arglist_ptr multiple times */
-    va_list cpy_arglist;
-    va_copy(cpy_arglist, *arglist_ptr);
-    /* the data given in the arg_list is of this structure: general name, local implementation
-    to  map each methods given to its correct slot we use an chain if statement here until we
-    read NULL */
-    while (selector = va_arg(cpy_arglist, func_ptr))
-    {
-        func_ptr method = va_arg(cpy_arglist, func_ptr);
-        /* at this point selector holds the slot and method holds the local implementation */
-        if (selector == (func_ptr) ctor)
-            /* since self->ctor is of the type void* (*)(const void *, va_list *) we need to cast
-            it to the (func_pointer) type, we can either do it this way or cast method to self->ctor
-            type, but since we have a bunch of them with different footprints it's more convenience
-            this way. */
-            *((func_ptr *) &self->ctor) = method;
-        else if (selector == (func_ptr) dtor)
-            *((func_ptr*) &self->dtor) = method;
-        else if (selector == (func_ptr) differ)
-            *((func_ptr*) &self->differ) = method;
-        else if (selector == (func_ptr) puto)
-            *((func_ptr*) &self->puto) = method;
-    }
-    va_end(cpy_arglist);
-    return self;
-}
-
-static void * Class_dtor(void * _self)
-{
-    struct Class * self = _self;
-    fprintf(stderr, "%s: cannot destroy class", self->name);
-
-    return NULL;
-}
-
-/******************************************************************************
- * INITIALIZATION
- * A very important step that requires special explaination. Each of the two members
- * of the struct is a class descriptor in itself, the first one for the Object class,
- * and the second one for the Class metaclass. The Object class needs a class descriptor,
- * therefore it needs a fully initialized Class metaclass. The Class metaclass in turn is
- * a subclass of the Object class and needs a fully initialized Object class. Therefore,
- * we need to be creative in how we solve this problem
-*******************************************************************************/
-
-static const struct Class object[] = {
-    {
-        /* These params correspond to: */
-        {object + 1},          /* const struct Object _ */
-        "Object",              /* const char * name  */
-        object,                /* const struct Class * super */
-        sizeof(struct Object), /* size_t size */
-        Object_ctor,           /* void* (*ctor) */
-        Object_dtor,           /* void* (*dtor) */
-        Object_differ,         /* int (*differ) */
-        Object_puto,           /* int (*puto) */
-    },
-    {
-        {object + 1},
-        "Class",
-        object,
-        sizeof(struct Class),
-        Class_ctor,
-        Class_dtor,
-        Object_differ,
-        Object_puto,
-     },
-};
-
-/* now we can use object[0] and object[1] as "Object" and "Class". */
-const void* Object = object;
-const void* Class = object + 1;
+#include <assert.h>     /* for assert() */
+#include <stddef.h>     /* for offsetof() */
+#include <stdint.h>     /* for uintptr_t */
+#include <string.h>     /* for memcpy(), memset() */
+#include <stdlib.h>     /* for malloc() */
+#include <sched.h>      /* for sched_yield() */
+
+#include "Object.h"
+#include "Object_struct.h"
+#include "Object_dispatch.h"
+#include "Pool.h"
+#include "Buffer.h"
+
+#ifdef OBJECT_FAST_DISPATCH
+/* The selectors are inline functions in Object_dispatch.h. Declaring them extern
+ * here makes this the one translation unit that emits their external definitions. */
+extern inline const void * class_of(const void * self);
+extern inline size_t size_of(const void * self);
+extern inline const void * super(const void * self);
+extern inline int is_a(const void * self, const void * class);
+extern inline int is_of(const void * self, const void * class);
+extern inline void * cast(const void * self, const void * class);
+extern inline void * ctor(void * self, va_list * arg_list_ptr);
+extern inline void * dtor(void * self);
+extern inline int differ(const void * self, const void * other);
+extern inline int puto(const void * self, FILE * file_ptr);
+extern inline int sputo(const void * self, struct Buffer * out);
+extern inline int serialize(const void * self, struct Buffer * out);
+extern inline void * deserialize(void * self, struct Reader * in);
+extern inline void * copy(const void * self);
+extern inline size_t hash(const void * self);
+extern inline void trace(const void * self, struct Tracer * tracer);
+extern inline void * super_ctor(const void * class, void * self, va_list * arg_list_ptr);
+extern inline void * super_dtor(const void * class, void * self);
+extern inline int super_differ(const void * class, const void * self, const void * other);
+extern inline int super_puto(const void * class, const void * self, FILE * file_ptr);
+extern inline int super_sputo(const void * class, const void * self, struct Buffer * out);
+extern inline int super_serialize(const void * class, const void * self, struct Buffer * out);
+extern inline void * super_deserialize(const void * class, void * self, struct Reader * in);
+extern inline void * super_copy(const void * class, const void * self);
+extern inline size_t super_hash(const void * class, const void * self);
+extern inline void super_trace(const void * class, const void * self, struct Tracer * tracer);
+#endif
+
+/******************************************************************************
+ * MEMORY MANAGEMENT FUNCTIONS
+ * new and delete are called whenever a new object is created or destroyed.
+ * The memory comes from the per-size slab pool in Pool.c rather than straight
+ * from calloc() and free().
+*******************************************************************************/
+
+/**
+ * @brief Get zeroed memory for an object of the given class from the pool and set
+ *        its class. No ctor is run. With OBJECT_REFCOUNT the object starts out
+ *        with one reference; with OBJECT_GC the collector starts tracking it.
+ */
+void * allocate(const void * _class)
+{
+    const struct Class * class = _class;
+    assert(class && class->size);
+
+#ifdef OBJECT_HEADER
+    struct Header * header = pool_alloc(OBJECT_HEADER_SIZE + class->size);
+    assert(header);
+#ifdef OBJECT_REFCOUNT
+    atomic_init(&header->references, 1);
+#endif
+    struct Object * object = (struct Object *) (header + 1);
+#else
+    struct Object * object = pool_alloc(class->size);
+    assert(object);
+#endif
+    object->class = class;
+#ifdef OBJECT_GC
+    gc_track(object);
+#endif
+    OBJECT_COUNT(class, STATS_CREATED, 1);
+    OBJECT_COUNT(class, STATS_BYTES, class->size);
+
+    return object;
+}
+
+/**
+ * @brief Return the memory of an object to the pool. No dtor is run. With
+ *        OBJECT_GC the memory of an object the collector may still look at goes
+ *        back at the end of its cycle instead.
+ */
+void deallocate(void * _self)
+{
+    if (!_self)
+        return;
+    OBJECT_COUNT(class_of(_self), STATS_DESTROYED, 1);
+#ifdef OBJECT_GC
+    if (!gc_untrack(_self))
+        return;
+#endif
+#ifdef OBJECT_HEADER
+    pool_free(header_of(_self), OBJECT_HEADER_SIZE + size_of(_self));
+#else
+    pool_free(_self, size_of(_self));
+#endif
+}
+
+void * new(const void * _class, ...)
+{
+    struct Object * object = allocate(_class);
+
+    va_list arg_list;
+    va_start(arg_list, _class);
+    object = ctor(object, &arg_list);
+    va_end(arg_list);
+
+    return object;
+}
+
+/**
+ * @brief Placement version of new(): construct an object of the given class in
+ *        caller-supplied storage, for example on the stack or embedded in another
+ *        struct. The buffer must hold at least the class size. Tear the object down
+ *        with dtor() instead of delete() since there is nothing to free.
+ *
+ * @param _buffer the storage for the object
+ * @param _class the class of the new object, followed by the arguments for its ctor
+ * @return void* the constructed object
+ */
+void * init(void * _buffer, const void * _class, ...)
+{
+    const struct Class * class = _class;
+    assert(_buffer && class && class->size);
+
+    struct Object * object = memset(_buffer, 0, class->size);
+    object->class = class;
+
+    va_list arg_list;
+    va_start(arg_list, _class);
+    object = ctor(object, &arg_list);
+    va_end(arg_list);
+
+    return object;
+}
+
+void delete(void * _self)
+{
+    if (_self)
+        deallocate(dtor(_self));
+    _self = NULL;
+}
+
+/**
+ * @brief Fold value into a running hash. Start from 0 and feed in the fields that
+ *        differ() compares, in a fixed order.
+ */
+size_t hash_combine(size_t hash, size_t value)
+{
+    /* the golden-ratio mix from boost::hash_combine */
+    return hash ^ (value + (size_t) 0x9e3779b97f4a7c15u + (hash << 6) + (hash >> 2));
+}
+
+#ifdef OBJECT_REFCOUNT
+/**
+ * @brief Take another reference to an object made by new(). Every retain() must be
+ *        matched by a release(); the reference new() returned counts as one.
+ *
+ * @return void* the object, for convenience
+ */
+void * retain(void * _self)
+{
+    assert(_self);
+    /* the caller already holds a reference, so nothing can be ordered before this */
+    atomic_fetch_add_explicit(&header_of(_self)->references, 1, memory_order_relaxed);
+
+    return _self;
+}
+
+/**
+ * @brief Drop a reference to an object. The thread that drops the last one deletes
+ *        the object. Do not also call delete() on a shared object.
+ */
+void release(void * _self)
+{
+    if (!_self)
+        return;
+    if (atomic_fetch_sub_explicit(&header_of(_self)->references, 1, memory_order_release) == 1)
+    {
+        /* see every other owner's writes to the object before tearing it down */
+        atomic_thread_fence(memory_order_acquire);
+        delete(_self);
+    }
+}
+#endif
+
+/******************************************************************************
+ * BATCH SELECTORS
+ * Apply a selector to a whole array of objects. The objects are first grouped by
+ * class so that each class's method is called over one contiguous run, which keeps
+ * the indirect branch predictable and loads each class descriptor once per run.
+ * Runs are visited in order of each class's first appearance in the array and the
+ * objects within a run keep their relative order.
+*******************************************************************************/
+
+/**
+ * @brief Split objects into runs of the same class and call fn once per run.
+ *
+ * @param objects the array of objects
+ * @param n the number of objects
+ * @param fn called with the class, the run, its length and, for each object in the
+ *           run, its position in the original array. positions is NULL when the run
+ *           is the original array itself.
+ * @param ctx passed through to fn
+ */
+void batch_by_class(void * const * objects, size_t n, batch_fn fn, void * ctx)
+{
+    if (!n)
+        return;
+
+    /* the common case of a homogeneous array needs no reordering at all */
+    const struct Class * first = class_of(objects[0]);
+    size_t i = 1;
+    while (i < n && class_of(objects[i]) == first)
+        i++;
+    if (i == n)
+    {
+        fn(first, objects, n, NULL, ctx);
+        return;
+    }
+
+    /* the class table grows to at most n entries but is searched linearly: arrays
+    mixing more than a handful of classes are not what this is for */
+    const struct Class ** classes = malloc(n * sizeof(*classes));
+    size_t * counts = calloc(n + 1, sizeof(*counts));
+    size_t * which = malloc(n * sizeof(*which));
+    size_t * positions = malloc(n * sizeof(*positions));
+    void ** sorted = malloc(n * sizeof(*sorted));
+    assert(classes && counts && which && positions && sorted);
+
+    size_t k = 0, last = 0;
+    for (i = 0; i < n; i++)
+    {
+        const struct Class * class = class_of(objects[i]);
+        if (k == 0 || classes[last] != class)
+        {
+            for (last = 0; last < k && classes[last] != class; last++)
+                ;
+            if (last == k)
+                classes[k++] = class;
+        }
+        which[i] = last;
+        counts[last + 1]++;
+    }
+    /* counts[c] becomes the start of run c */
+    for (size_t c = 1; c <= k; c++)
+        counts[c] += counts[c - 1];
+    for (i = 0; i < n; i++)
+    {
+        size_t slot = counts[which[i]]++;
+        sorted[slot] = objects[i];
+        positions[slot] = i;
+    }
+    /* after the scatter counts[c] is the end of run c, which is the start of c + 1 */
+    size_t start = 0;
+    for (size_t c = 0; c < k; c++)
+    {
+        fn(classes[c], sorted + start, counts[c] - start, positions + start, ctx);
+        start = counts[c];
+    }
+
+    free(sorted);
+    free(positions);
+    free(which);
+    free(counts);
+    free(classes);
+}
+
+/* The text of puto() is gathered by sputo() on the stack, and written in one go */
+#define PUTO_TEXT_SIZE  4096
+
+int Object_puto(const void * _self, FILE * file_ptr);
+
+/* Write the text gathered and start over; the value puto() returns */
+static int put_text(struct Buffer * text, FILE * file_ptr)
+{
+    size_t n = text->length;
+
+    text->length = 0;
+    return fwrite(text->data, 1, n, file_ptr) == n ? (int) n : -1;
+}
+
+struct PutoContext
+{
+    FILE * file_ptr;
+    int total;
+};
+
+static void puto_run(const void * _class, void * const * run, size_t count,
+    const size_t * positions, void * _ctx)
+{
+    const struct Class * class = _class;
+    struct PutoContext * ctx = _ctx;
+    assert(class->puto);
+    OBJECT_COUNT(class, STATS_PUTO, count);
+
+    if (class->puto != Object_puto)
+    {
+        for (size_t i = 0; i < count; i++)
+            ctx->total += class->puto(run[i], ctx->file_ptr);
+        return;
+    }
+
+    /* a class that only overrides sputo: one fwrite() for many objects */
+    unsigned char memory[PUTO_TEXT_SIZE];
+    struct Buffer text = buffer_over(memory, sizeof(memory));
+
+    assert(class->sputo);
+    for (size_t i = 0; i < count; i++)
+    {
+        class->sputo(run[i], &text);
+        if (text.length > PUTO_TEXT_SIZE / 2 || i == count - 1)
+            ctx->total += put_text(&text, ctx->file_ptr);
+    }
+    buffer_free(&text);
+}
+
+/**
+ * @brief puto() every object in the array, grouped by class.
+ *
+ * @return int the sum of the values returned by the class-defined puto functions
+ */
+int puto_all(void * const * objects, size_t n, FILE * file_ptr)
+{
+    struct PutoContext ctx = { file_ptr, 0 };
+
+    batch_by_class(objects, n, puto_run, &ctx);
+    return ctx.total;
+}
+
+struct DifferContext
+{
+    const void * other;
+    int * results;
+    size_t count;
+};
+
+static void differ_run(const void * _class, void * const * run, size_t count,
+    const size_t * positions, void * _ctx)
+{
+    const struct Class * class = _class;
+    struct DifferContext * ctx = _ctx;
+    assert(class->differ);
+    OBJECT_COUNT(class, STATS_DIFFER, count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int result = class->differ(run[i], ctx->other);
+        if (ctx->results)
+            ctx->results[positions ? positions[i] : i] = result;
+        ctx->count += result != 0;
+    }
+}
+
+/**
+ * @brief Compare every object in the array with other.
+ *
+ * @param results if not NULL, results[i] receives differ(objects[i], other)
+ * @return size_t the number of objects that differ from other
+ */
+size_t differ_all(void * const * objects, size_t n, const void * other, int * results)
+{
+    struct DifferContext ctx = { other, results, 0 };
+
+    batch_by_class(objects, n, differ_run, &ctx);
+    return ctx.count;
+}
+
+/******************************************************************************
+ * CLASS INITIALIZATION AND REGISTRY
+ * Class descriptors other than Object and Class are built at run time by the
+ * initXxx() functions, which may be called from any number of threads at once.
+ * class_once() makes sure each one runs exactly once. Every descriptor built by
+ * Class_ctor is also entered into a registry so that it can be found by name.
+*******************************************************************************/
+
+enum { ONCE_NEW, ONCE_RUNNING, ONCE_DONE };
+
+/**
+ * @brief Call build exactly once for a given flag, however many threads get here at
+ *        the same time. Once build has returned the cost is a single acquire load.
+ *        Threads that lose the race wait for the winner, so build must not end up
+ *        calling class_once on its own flag.
+ *
+ * @param once a flag shared by all callers, statically initialized to 0
+ * @param build the function that creates the class descriptors
+ */
+void class_once(atomic_int * once, void (*build)(void))
+{
+    if (atomic_load_explicit(once, memory_order_acquire) == ONCE_DONE)
+        return;
+
+    int expected = ONCE_NEW;
+    if (atomic_compare_exchange_strong_explicit(once, &expected, ONCE_RUNNING,
+        memory_order_acquire, memory_order_acquire))
+    {
+        build();
+        /* publishes everything build() wrote, the descriptor pointers included */
+        atomic_store_explicit(once, ONCE_DONE, memory_order_release);
+        return;
+    }
+    while (atomic_load_explicit(once, memory_order_acquire) != ONCE_DONE)
+        sched_yield();
+}
+
+#define REGISTRY_BUCKETS 256
+
+/* The registry only ever grows, so it can be a hash table of lock-free stacks:
+a registration is pushed with a compare-and-swap and lookups just follow the
+links, without taking a lock on either side. */
+struct Registration
+{
+    struct Registration * next;
+    const struct Class * class;
+};
+
+static _Atomic(struct Registration *) registry[REGISTRY_BUCKETS];
+
+static size_t hash_name(const char * name)
+{
+    /* FNV-1a */
+    size_t hash = 2166136261u;
+    while (*name)
+        hash = (hash ^ (unsigned char) *name++) * 16777619u;
+
+    return hash % REGISTRY_BUCKETS;
+}
+
+static void push_registration(struct Registration * registration)
+{
+    _Atomic(struct Registration *) * bucket = registry + hash_name(registration->class->name);
+
+    registration->next = atomic_load_explicit(bucket, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(bucket, &registration->next, registration,
+        memory_order_release, memory_order_relaxed))
+        ;
+}
+
+static void register_class(const struct Class * class)
+{
+    struct Registration * registration = malloc(sizeof(*registration));
+    assert(registration);
+
+    registration->class = class;
+    push_registration(registration);
+}
+
+/**
+ * @brief Enter a class defined with CLASS_STATIC into the registry, so that
+ *        class_named() finds it. Registering a class again does nothing.
+ */
+void class_register(const void * _class)
+{
+    static _Atomic(const struct Class *) registered[CLASS_STATIC_IDS];
+    const struct Class * class = _class;
+    const struct Class * expected = NULL;
+    assert(class && class->id > 1 && class->id < CLASS_STATIC_IDS);
+
+    if (atomic_compare_exchange_strong_explicit(registered + class->id, &expected, class,
+        memory_order_relaxed, memory_order_relaxed))
+        register_class(class);
+    else if (expected != class)
+        fprintf(stderr, "%s: class id %zu is taken by %s\n", class->name, class->id, expected->name);
+}
+
+static struct Registration builtin[2];
+static atomic_int builtin_once;
+
+/* Object and Class are static, so nothing registers them: do it on first lookup */
+static void register_builtin(void)
+{
+    builtin[0].class = Object;
+    builtin[1].class = Class;
+    push_registration(builtin);
+    push_registration(builtin + 1);
+}
+
+/**
+ * @brief Find a class descriptor by the name it was given when it was created.
+ *        If several classes share a name the most recently created one is found.
+ *
+ * @param name the class name, for example "Circle"
+ * @return const void* the class descriptor, or NULL if no such class exists yet
+ */
+const void * class_named(const char * name)
+{
+    assert(name);
+    class_once(&builtin_once, register_builtin);
+
+    struct Registration * registration = atomic_load_explicit(registry + hash_name(name),
+        memory_order_acquire);
+    for (; registration; registration = registration->next)
+        if (strcmp(registration->class->name, name) == 0)
+            return registration->class;
+
+    return NULL;
+}
+
+/* Names up to this long are read into the stack, longer ones into the heap */
+#define CLASS_NAME_SHORT    64
+
+/**
+ * @brief Read a class name the way archives and containers write it, a u16
+ *        length followed by the bytes, and find the class with class_named().
+ *
+ * @param in the input, left after the name
+ * @param where what is being read, for the message about an unknown class
+ * @return const void* the class descriptor, or NULL if the input is too short
+ *         or names a class that does not exist or is a metaclass
+ */
+const void * class_read(struct Reader * in, const char * where)
+{
+    char short_name[CLASS_NAME_SHORT + 1];
+    const struct Class * class = NULL;
+    uint16_t length;
+    assert(in && where);
+
+    if (reader_get_u16(in, &length))
+        return NULL;
+    char * name = length <= CLASS_NAME_SHORT ? short_name : malloc(length + 1u);
+    assert(name);
+
+    if (!reader_get(in, name, length))
+    {
+        name[length] = '\0';
+        if (!(class = class_named(name)))
+            fprintf(stderr, "%s: unknown class in %s\n", name, where);
+        /* a metaclass makes class descriptors, which no archive holds */
+        else if (class->display[Class_descriptor.depth] == Class)
+        {
+            fprintf(stderr, "%s: class of classes in %s\n", name, where);
+            class = NULL;
+        }
+    }
+    if (name != short_name)
+        free(name);
+    return class;
+}
+
+/******************************************************************************
+ * METHOD BINDING
+ * new() for a class descriptor takes (selector, method) pairs after the size,
+ * ending with NULL. They are all bound here, for Class and every metaclass below
+ * it: a selector with a slot, one of Class's or one a metaclass declared with
+ * class_slot(), has the method put in the slot, any other selector names a
+ * message and has the method put in the class's table of messages.
+*******************************************************************************/
+
+#define SLOT_BUCKETS    64
+
+/* The slots are found by selector in a hash table of lock-free stacks, like the
+class registry: metaclasses only ever add to it. */
+struct Slot
+{
+    struct Slot * next;
+    selector_fn selector;
+    const struct Class * metaclass;
+    size_t offset;
+};
+
+static _Atomic(struct Slot *) slots[SLOT_BUCKETS];
+
+/* Fibonacci hashing: the high half of the product depends on every bit of the
+address, the low ones that alignment leaves at zero included */
+static size_t hash_selector(selector_fn selector)
+{
+    return (size_t) (((uint64_t) (uintptr_t) selector * 0x9e3779b97f4a7c15u) >> 32);
+}
+
+static void push_slot(struct Slot * slot)
+{
+    _Atomic(struct Slot *) * bucket = slots + hash_selector(slot->selector) % SLOT_BUCKETS;
+
+    slot->next = atomic_load_explicit(bucket, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(bucket, &slot->next, slot,
+        memory_order_release, memory_order_relaxed))
+        ;
+}
+
+static const struct Slot * find_slot(selector_fn selector)
+{
+    const struct Slot * slot = atomic_load_explicit(slots + hash_selector(selector) % SLOT_BUCKETS,
+        memory_order_acquire);
+    while (slot && slot->selector != selector)
+        slot = slot->next;
+
+    return slot;
+}
+
+void class_slot(const void * metaclass, selector_fn selector, size_t offset)
+{
+    struct Slot * slot = malloc(sizeof(*slot));
+    /* the slot is in the descriptors the metaclass makes */
+    assert(slot && metaclass && selector);
+    assert(offset + sizeof(selector_fn) <= ((const struct Class *) metaclass)->size);
+
+    slot->selector = selector;
+    slot->metaclass = metaclass;
+    slot->offset = offset;
+    push_slot(slot);
+}
+
+/* the metaclass of these is Class, filled in when they are registered */
+static struct Slot class_slots[] = {
+    { NULL, (selector_fn) ctor, NULL, offsetof(struct Class, ctor) },
+    { NULL, (selector_fn) dtor, NULL, offsetof(struct Class, dtor) },
+    { NULL, (selector_fn) differ, NULL, offsetof(struct Class, differ) },
+    { NULL, (selector_fn) puto, NULL, offsetof(struct Class, puto) },
+    { NULL, (selector_fn) sputo, NULL, offsetof(struct Class, sputo) },
+    { NULL, (selector_fn) serialize, NULL, offsetof(struct Class, serialize) },
+    { NULL, (selector_fn) deserialize, NULL, offsetof(struct Class, deserialize) },
+    { NULL, (selector_fn) copy, NULL, offsetof(struct Class, copy) },
+    { NULL, (selector_fn) hash, NULL, offsetof(struct Class, hash) },
+    { NULL, (selector_fn) trace, NULL, offsetof(struct Class, trace) },
+};
+static atomic_int class_slots_once;
+
+static void register_class_slots(void)
+{
+    for (size_t i = 0; i < sizeof(class_slots) / sizeof(class_slots[0]); i++)
+    {
+        class_slots[i].metaclass = Class;
+        push_slot(class_slots + i);
+    }
+}
+
+struct Method
+{
+    const struct Class * class;     /* the class whose table the entry is in */
+    selector_fn selector;           /* NULL in an empty entry */
+    message_fn method;
+};
+
+static const struct Method * find_method(const struct Class * class, selector_fn selector)
+{
+    if (!class->methods)
+        return NULL;
+
+    for (size_t i = hash_selector(selector); ; i++)
+    {
+        const struct Method * method = class->methods + (i & class->method_mask);
+        if (method->selector == selector)
+            return method;
+        if (!method->selector)
+            return NULL;
+    }
+}
+
+/* Enter a message in a table that has room for it, overriding an inherited one */
+static void put_method(struct Class * self, selector_fn selector, message_fn method)
+{
+    struct Method * methods = (struct Method *) self->methods;
+    size_t i = hash_selector(selector);
+
+    while (methods[i & self->method_mask].selector && methods[i & self->method_mask].selector != selector)
+        i++;
+    methods[i & self->method_mask] = (struct Method) { self, selector, method };
+}
+
+/**
+ * @brief Bind the (selector, method) pairs that follow the size in the arguments
+ *        of new() for a class. The inherited methods have already been copied
+ *        into the slots; the inherited messages are copied into a table of the
+ *        class's own, large enough for its own messages too, if it has any.
+ */
+static void bind_methods(struct Class * self, va_list * arglist_ptr)
+{
+    const struct Class * super = self->super;
+    size_t messages = 0;
+
+    class_once(&class_slots_once, register_class_slots);
+
+    /* pointer to any type usually have the same size, except for the pointer to function.
+    Casting between void *, aka generic pointer, and a function pointer is not allowed, so
+    the pairs are read as selector_fn, the type of a pointer to a generic function. The
+    arglist is copied so that the metaclass ctors can still read it after us. */
+    va_list cpy_arglist;
+    va_copy(cpy_arglist, *arglist_ptr);
+    for (selector_fn selector; (selector = va_arg(cpy_arglist, selector_fn)); )
+    {
+        (void) va_arg(cpy_arglist, selector_fn);
+        messages += !find_slot(selector);
+    }
+    va_end(cpy_arglist);
+
+    /* the table is kept at most half full */
+    self->methods = NULL;
+    self->method_mask = 0;
+    if (super->methods || messages)
+    {
+        size_t capacity = 8;
+        while (capacity < 2 * (super->method_mask + 1 + messages))
+            capacity *= 2;
+        self->methods = calloc(capacity, sizeof(struct Method));
+        assert(self->methods);
+        self->method_mask = capacity - 1;
+        for (size_t i = 0; super->methods && i <= super->method_mask; i++)
+            if (super->methods[i].selector)
+                put_method(self, super->methods[i].selector, super->methods[i].method);
+    }
+
+    va_copy(cpy_arglist, *arglist_ptr);
+    for (selector_fn selector; (selector = va_arg(cpy_arglist, selector_fn)); )
+    {
+        selector_fn method = va_arg(cpy_arglist, selector_fn);
+        const struct Slot * slot = find_slot(selector);
+
+        if (!slot)
+            put_method(self, selector, (message_fn) method);
+        else
+        {
+            /* a slot of another metaclass is not in this descriptor */
+            assert(is_of(self, slot->metaclass));
+            *(selector_fn *) ((char *) self + slot->offset) = method;
+        }
+    }
+    va_end(cpy_arglist);
+}
+
+/******************************************************************************
+ * MESSAGES
+*******************************************************************************/
+
+int responds_to(const void * self, selector_fn selector)
+{
+    const struct Class * class = class_of(self);
+    const struct Slot * slot = find_slot(selector);
+
+    if (slot)
+        return is_of(class, slot->metaclass) && *(const selector_fn *) ((const char *) class + slot->offset);
+    return find_method(class, selector) != NULL;
+}
+
+void * vsend(struct SendCache * cache, void * self, selector_fn selector, va_list * arg_ptr)
+{
+    const struct Class * class = class_of(self);
+    const struct Method * method;
+
+    if (cache)
+    {
+        method = atomic_load_explicit(&cache->method, memory_order_acquire);
+        if (method && method->class == class)
+        {
+            assert(method->selector == selector);
+            return method->method(self, arg_ptr);
+        }
+    }
+
+    method = find_method(class, selector);
+    if (!method)
+    {
+        fprintf(stderr, "%s: does not respond to the message\n", class->name);
+        return NULL;
+    }
+    if (cache)
+        atomic_store_explicit(&cache->method, method, memory_order_release);
+    return method->method(self, arg_ptr);
+}
+
+void * message_send(void * self, selector_fn selector, ...)
+{
+    va_list arg_list;
+    va_start(arg_list, selector);
+    void * result = vsend(NULL, self, selector, &arg_list);
+    va_end(arg_list);
+
+    return result;
+}
+
+void * send_cached(struct SendCache * cache, void * self, selector_fn selector, ...)
+{
+    va_list arg_list;
+    va_start(arg_list, selector);
+    void * result = vsend(cache, self, selector, &arg_list);
+    va_end(arg_list);
+
+    return result;
+}
+
+/******************************************************************************
+ * OBJECT CLASS METHODS
+ * Methods that are unique to the Object class. Since Object is the base class of everything,
+ * its method is the default of all its subclasses, including the Class metaclass.
+*******************************************************************************/
+
+/**
+ * @brief By the time the contructor of Object is called, the new() method has already created
+ * a pointer to the object and allocated a chunk of memory to it. It has also copied the class
+ * descriptor pointer into the only field that Object has, the "class" field. Therefore there
+ * is nothing for Object_ctor to do.
+ *
+ * @param _self the pointer to the Object
+ * @param arglist_ptr the pointer to the optional list of arguments, will always be empty for
+ *                    Object since we don't have extra data aside from the class descriptor.
+ * @return void* the pointer to the object
+ */
+void * Object_ctor(void * _self, va_list * arglist_ptr)
+{
+    return _self;
+}
+
+/**
+ * @brief "Delete" all the data in Object. Since Object has only one data field which is
+ * the class descriptor pointer, which is the responsibility of delete(), we do nothing here
+ *
+ * @param _self pointer to the Object to be destructed
+ */
+void * Object_dtor(void * _self)
+{
+    return _self;
+}
+
+int Object_differ(const void * _self, const void * other)
+{
+    return (_self != other);
+}
+
+/* two objects are only equal if they are the same object, so hash the address */
+size_t Object_hash(const void * _self)
+{
+    return hash_combine(0, (uintptr_t) _self);
+}
+
+/* an Object refers to no other objects */
+void Object_trace(const void * _self, struct Tracer * tracer)
+{
+}
+
+int Object_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Class * class = class_of(_self);
+
+    int n = buffer_print(out, class->name);
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, _self);
+    return n + buffer_print(out, "\n");
+}
+
+/* puto() is sputo() into memory on the stack, and one fwrite() */
+int Object_puto(const void * _self, FILE * file_ptr)
+{
+    unsigned char memory[256];
+    struct Buffer text = buffer_over(memory, sizeof(memory));
+
+    sputo(_self, &text);
+    int n = put_text(&text, file_ptr);
+    buffer_free(&text);
+
+    return n;
+}
+
+/**
+ * @brief Object has no fields besides its class, which the container records, so
+ * there is nothing to write or read.
+ */
+int Object_serialize(const void * _self, struct Buffer * out)
+{
+    return 0;
+}
+
+void * Object_deserialize(void * _self, struct Reader * in)
+{
+    return _self;
+}
+
+/**
+ * @brief The default copy is a flat one. The header of the copy, if there is one,
+ * is left alone so that the copy starts with a single reference of its own.
+ */
+void * Object_copy(const void * _self)
+{
+    void * replica = allocate(class_of(_self));
+
+    return memcpy(replica, _self, size_of(_self));
+}
+
+/******************************************************************************
+ * CLASS METACLASS METHODS
+ * Methods that are unique to the Class metaclass. It is only used to create a new class
+ * descriptor so it only really ctor method, the dtor method is there to ensure that we
+ * prevent accidental deletion of class descriptors.
+*******************************************************************************/
+
+/* Object and Class are 0 and 1, and the static classes are below CLASS_STATIC_IDS */
+static atomic_size_t class_count = CLASS_STATIC_IDS;
+
+void * Class_ctor(void * _self, va_list * arglist_ptr)
+{
+    /* "self" is a class descriptor so cast it as such */
+    struct Class * self = _self;
+
+    /* pass the values in the arg list into self */
+    self->name = va_arg(*arglist_ptr, char *);
+    self->super = va_arg(*arglist_ptr, struct Class *);
+    self->size = va_arg(*arglist_ptr, size_t);
+    assert(self->super);
+
+    /* Now is the hard part, we need to pass all the methods into
+    their correct position on the class descriptor */
+    /* First find the offset of the ctor method inside the class struct */
+    const size_t offset = offsetof(struct Class, ctor);
+    /* Here we assume that the superclass descriptor has been constructed.
+    if so we can copy all of its methods to this newly created class descriptor
+    first, then later we can just modify the ones we define in the arg_list */
+    /**
+     * Here we have:
+     * (char *) self + offset : address of self + offset is the destination to copy the
+     *   data to. Casted to char pointer because char is guaranteed to be 1 byte, therefore
+     *   its pointer arithmetic will be equivalent to pointer-to-byte arithmetic. As in,
+     *   when you add or substract 1 to the pointer, the address is moved 1 byte forward or
+     *   backward.
+     * (char *) self->super + offset: the data come from the super class descriptor starting
+     *   at offset.
+     * size_of(self->super) - offset: size_of(self->super) is the size of the entire
+     *   superclass descriptor. Since we only need to copy from the position of offset
+     *   to the end, we substract offset from the total size to get the correct chunk.
+    **/
+    memcpy((char *) self + offset, (char *) self->super + offset, size_of(self->super) - offset);
+    /* the id came along with the methods, give the new class one of its own */
+    self->id = atomic_fetch_add_explicit(&class_count, 1, memory_order_relaxed);
+    /* so did the ancestors; the class goes below them */
+    self->depth = self->super->depth + 1;
+    assert(self->depth < CLASS_MAX_DEPTH);
+    self->display[self->depth] = self;
+
+    bind_methods(self, arglist_ptr);
+
+    register_class(self);
+    return self;
+}
+
+void * Class_dtor(void * _self)
+{
+    struct Class * self = _self;
+    fprintf(stderr, "%s: cannot destroy class", self->name);
+
+    return NULL;
+}
+
+/* Class descriptors are made of pointers into the running program, so they are
+looked up by name on loading instead of being written out. */
+int Class_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Class * self = _self;
+    fprintf(stderr, "%s: cannot serialize class\n", self->name);
+
+    return -1;
+}
+
+/* A flat copy of a descriptor would share its name and be missing from the registry */
+void * Class_copy(const void * _self)
+{
+    const struct Class * self = _self;
+    fprintf(stderr, "%s: cannot copy class\n", self->name);
+
+    return NULL;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+ * A very important step that requires special explaination. There are two class
+ * descriptors to set up, the first one for the Object class, and the second one for
+ * the Class metaclass. The Object class needs a class descriptor,
+ * therefore it needs a fully initialized Class metaclass. The Class metaclass in turn is
+ * a subclass of the Object class and needs a fully initialized Object class. Therefore,
+ * we need to be creative in how we solve this problem: both are constants that refer
+ * to each other, which is also how CLASS_STATIC defines the classes below them.
+*******************************************************************************/
+
+const struct Class Object_descriptor = {
+    /* These params correspond to: */
+    {&Class_descriptor},   /* const struct Object _ */
+    "Object",              /* const char * name  */
+    &Object_descriptor,    /* const struct Class * super */
+    sizeof(struct Object), /* size_t size */
+    Object_ctor,           /* void* (*ctor) */
+    Object_dtor,           /* void* (*dtor) */
+    Object_differ,         /* int (*differ) */
+    Object_puto,           /* int (*puto) */
+    Object_sputo,          /* int (*sputo) */
+    Object_serialize,      /* int (*serialize) */
+    Object_deserialize,    /* void* (*deserialize) */
+    Object_copy,           /* void* (*copy) */
+    Object_hash,           /* size_t (*hash) */
+    Object_trace,          /* void (*trace) */
+    0,                     /* size_t id */
+    0,                     /* size_t depth */
+    {&Object_descriptor},  /* const struct Class * display[] */
+    NULL,                  /* const struct Method * methods */
+    0,                     /* size_t method_mask */
+};
+
+const struct Class Class_descriptor = {
+    {&Class_descriptor},
+    "Class",
+    &Object_descriptor,
+    sizeof(struct Class),
+    Class_ctor,
+    Class_dtor,
+    Object_differ,
+    Object_puto,
+    Object_sputo,
+    Class_serialize,
+    Object_deserialize,
+    Class_copy,
+    Object_hash,
+    Object_trace,
+    1,
+    1,
+    {&Object_descriptor, &Class_descriptor},
+    NULL,
+    0,
+};
+
+const void * const Object = &Object_descriptor;
+const void * const Class = &Class_descriptor;
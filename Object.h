@@ -1,23 +1,99 @@
-#ifndef __OBJECT__H__SL
-#define __OBJECT__H__SL
-
-#include <stdio.h>
-#include <stdarg.h>
-
-
-extern const void * Object;
-extern const void * Class;
-
-void * new(const void * class, ...);
-void delete(void * self);
-
-void * ctor(void * self, va_list * arglist_ptr);
-void * dtor(void * self);
-int differ(const void * self, const void * other);
-int puto(const void * self, FILE * file_pointer);
-
-const void * class_of(const void * self);
-const void * super(const void * self);
-size_t size_of(const void * self);
-
+#ifndef __OBJECT__H__SL
+#define __OBJECT__H__SL
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+
+struct Buffer;
+struct Reader;
+struct Tracer;
+
+
+extern const void * const Object;
+extern const void * const Class;
+
+void * new(const void * class, ...);
+void delete(void * self);
+void * init(void * buffer, const void * class, ...);
+
+/* Shared ownership, for objects made by new() in a build with OBJECT_REFCOUNT */
+#ifdef OBJECT_REFCOUNT
+void * retain(void * self);
+void release(void * self);
+#endif
+
+const void * class_named(const char * name);
+
+/* Read a class name written as a u16 length and the bytes, as archives and
+containers do, and look it up. Returns NULL if the input is too short, or with a
+message naming where, if there is no such class or it is a metaclass. */
+const void * class_read(struct Reader * in, const char * where);
+
+/* With OBJECT_FAST_DISPATCH the selectors are inline functions defined in
+Object_dispatch.h, which then has to see the class descriptor structure. */
+#ifdef OBJECT_FAST_DISPATCH
+#include "Object_struct.h"
+#else
+void * ctor(void * self, va_list * arglist_ptr);
+void * dtor(void * self);
+int differ(const void * self, const void * other);
+int puto(const void * self, FILE * file_pointer);
+int sputo(const void * self, struct Buffer * out);
+int serialize(const void * self, struct Buffer * out);
+void * deserialize(void * self, struct Reader * in);
+void * copy(const void * self);
+size_t hash(const void * self);
+void trace(const void * self, struct Tracer * tracer);
+
+const void * class_of(const void * self);
+const void * super(const void * self);
+size_t size_of(const void * self);
+
+int is_a(const void * self, const void * class);
+int is_of(const void * self, const void * class);
+void * cast(const void * self, const void * class);
+#endif
+
+/* Batch selectors: apply puto/differ to an array of objects grouped by class */
+int puto_all(void * const * objects, size_t n, FILE * file_pointer);
+size_t differ_all(void * const * objects, size_t n, const void * other, int * results);
+
+/* Messages: a method given to new() for a selector without a slot in the
+descriptor goes into a table of messages the class keeps, and is inherited like
+the methods in slots are. Any function can be such a selector, usually one that
+sends itself:
+
+    void * area(void * self, ...)
+    {
+        static struct SendCache cache;
+        va_list arg_list;
+        va_start(arg_list, self);
+        void * result = vsend(&cache, self, (selector_fn) area, &arg_list);
+        va_end(arg_list);
+        return result;
+    }
+
+The method is a message_fn, which takes the arguments after self from the list.
+responds_to() answers for slots and messages alike; message_send() only calls
+messages, and prints an error and returns NULL for one the class does not have.
+It is not called send() so as not to take the place of send(2) from the C
+library in the programs that link this one.
+
+A SendCache, zero to start with, belongs to one call site and so to one
+selector. It remembers the method found last, so that sending the message again
+to an object of the same class costs about as much as a call through a slot. */
+typedef void (*selector_fn)(void);
+typedef void * (*message_fn)(void * self, va_list * arg_ptr);
+
+struct SendCache
+{
+    _Atomic(const struct Method *) method;
+};
+
+int responds_to(const void * self, selector_fn selector);
+void * message_send(void * self, selector_fn selector, ...);
+void * send_cached(struct SendCache * cache, void * self, selector_fn selector, ...);
+void * vsend(struct SendCache * cache, void * self, selector_fn selector, va_list * arg_ptr);
+
 #endif  /* !__OBJECT__H__SL */
\ No newline at end of file
@@ -0,0 +1,330 @@
+#ifndef __OBJECT_DISPATCH__H__SL
+#define __OBJECT_DISPATCH__H__SL
+
+/******************************************************************************
+ * SELECTOR DEFINITIONS
+ * The selectors are written once, here, and compiled in one of two ways:
+ *
+ *   checked build (default): Object.c includes this file and the selectors are
+ *       ordinary functions that assert() the object and the slot on every call.
+ *   OBJECT_FAST_DISPATCH: Object_struct.h includes this file and the selectors
+ *       become C99 inline functions that load the slot and make the indirect call,
+ *       with no validation. Object.c emits the one external definition of each, so
+ *       a selector still has a single address for Class_ctor to bind methods by.
+*******************************************************************************/
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * STATIC METHODS
+ * These helper functions are available to outside files too.
+*******************************************************************************/
+
+OBJECT_SELECTOR const void * class_of(const void * _self)
+{
+    const struct Object * self = _self;
+    OBJECT_CHECK(self && self->class);
+
+    return self->class;
+}
+
+OBJECT_SELECTOR size_t size_of(const void * _self)
+{
+    const struct Class * class = class_of(_self);
+
+    return class->size;
+}
+
+OBJECT_SELECTOR const void * super(const void * _self)
+{
+    const struct Class * self = _self;
+    OBJECT_CHECK(self && self->super);
+
+    return self->super;
+}
+
+/**
+ * @brief Type tests. is_a() asks whether the object's class is exactly class,
+ *        is_of() whether it is class or a subclass of it. Every class keeps its
+ *        ancestors by depth, so is_of() is one load and one compare however deep
+ *        the hierarchy is. Both are false for a NULL object.
+ */
+OBJECT_SELECTOR int is_a(const void * _self, const void * class)
+{
+    return _self && class_of(_self) == class;
+}
+
+OBJECT_SELECTOR int is_of(const void * _self, const void * _class)
+{
+    const struct Class * class = _class;
+    OBJECT_CHECK(class && class->depth < CLASS_MAX_DEPTH);
+
+    return _self && ((const struct Class *) class_of(_self))->display[class->depth] == class;
+}
+
+/**
+ * @brief Checked cast: the object itself if is_of(_self, class), NULL otherwise
+ */
+OBJECT_SELECTOR void * cast(const void * _self, const void * class)
+{
+    return is_of(_self, class) ? (void *) _self : NULL;
+}
+
+/******************************************************************************
+ * GENERIC SELECTORS
+ * Functions that are used to call the other methods defined in the class descriptor
+*******************************************************************************/
+
+/**
+ * @brief Selector function that will call the actual ctor function defined in the class.
+ *        Ctor aids in the creation of a new object
+ *
+ * @param _self the object to call it for
+ * @param arg_list_ptr the optional list of arguments
+ * @return void* return a generic pointer pointing to the constructed object
+ */
+OBJECT_SELECTOR void * ctor(void * _self, va_list * arg_list_ptr)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->ctor);
+    OBJECT_COUNT(class, STATS_CTOR, 1);
+
+    return class->ctor(_self, arg_list_ptr);
+}
+
+/**
+ * @brief Selector function that will call the actual destructor given by the class descriptor.
+ *        Dtor aids in the reclaimation of memory when destroying an object
+ *
+ * @param _self the object to call it for
+ * @return void* return a generic pointer pointing to the object for further deconstruction
+ */
+OBJECT_SELECTOR void * dtor(void * _self)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->dtor);
+    OBJECT_COUNT(class, STATS_DTOR, 1);
+
+    return class->dtor(_self);
+}
+
+/**
+ * @brief Selector fuctions to call the actual differ function defined in the class descriptor.
+ *        Differ check if two objects are different from each other.
+ *
+ * @param _self the object to call it for
+ * @param other the object to compare
+ * @return int return the value returned by the class-defined differ function
+ */
+OBJECT_SELECTOR int differ(const void * _self, const void * other)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->differ);
+    OBJECT_COUNT(class, STATS_DIFFER, 1);
+
+    return class->differ(_self, other);
+}
+
+/**
+ * @brief Selector function to call the actual puto function defined by the class descriptor.
+ *        Puto prints the object out to a file.
+ *
+ * @param _self the object to print
+ * @param file_ptr the file to print into
+ * @return int the value returned by the class-defined puto function
+ */
+OBJECT_SELECTOR int puto(const void * _self, FILE * file_ptr)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->puto);
+    OBJECT_COUNT(class, STATS_PUTO, 1);
+
+    return class->puto(_self, file_ptr);
+}
+
+/**
+ * @brief Selector function to call the sputo function defined by the class descriptor.
+ *        Sputo appends the text puto() prints to a buffer, without going through
+ *        stdio. Object's puto is built on it, so a class only overrides sputo.
+ *
+ * @param _self the object to print
+ * @param out the buffer to append to
+ * @return int the number of bytes appended
+ */
+OBJECT_SELECTOR int sputo(const void * _self, struct Buffer * out)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->sputo);
+
+    return class->sputo(_self, out);
+}
+
+/**
+ * @brief Selector function to call the serialize function defined by the class descriptor.
+ *        Serialize appends the binary representation of the object's fields to a buffer.
+ *        The class itself is not written, that is up to the container format.
+ *
+ * @param _self the object to write
+ * @param out the buffer to append to
+ * @return int 0 on success, -1 if the object cannot be serialized
+ */
+OBJECT_SELECTOR int serialize(const void * _self, struct Buffer * out)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->serialize);
+
+    return class->serialize(_self, out);
+}
+
+/**
+ * @brief Selector function to call the deserialize function defined by the class descriptor.
+ *        Deserialize is the counterpart of ctor for objects read back from serialize()'s
+ *        output: it is called on zeroed memory whose class has already been set.
+ *
+ * @param _self the object to fill in
+ * @param in the input, advanced past the object's fields
+ * @return void* the object, or NULL if the input is truncated or malformed
+ */
+OBJECT_SELECTOR void * deserialize(void * _self, struct Reader * in)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->deserialize);
+
+    return class->deserialize(_self, in);
+}
+
+/**
+ * @brief Selector function to call the copy function defined by the class descriptor.
+ *        It returns a new object equal to the original, to be deleted on its own.
+ *        Object's copy is a memcpy() of size_of(self) bytes, which is all a class of plain
+ *        values needs; classes that own memory or other resources override it.
+ *
+ * @param _self the object to copy
+ * @return void* the copy, or NULL if the object cannot be copied
+ */
+OBJECT_SELECTOR void * copy(const void * _self)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->copy);
+
+    return class->copy(_self);
+}
+
+/**
+ * @brief Selector function to call the hash function defined by the class descriptor.
+ *        Objects that differ() reports as equal must have the same hash. Object's
+ *        hash goes with its differ and is based on the address of the object.
+ *
+ * @param _self the object to hash
+ * @return size_t the hash code
+ */
+OBJECT_SELECTOR size_t hash(const void * _self)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(class->hash);
+
+    return class->hash(_self);
+}
+
+/**
+ * @brief Selector function to call the trace function defined by the class
+ *        descriptor, which reports the objects self refers to. Object's trace
+ *        reports none, so classes that do not override it are leaves.
+ *
+ * @param _self the object to trace
+ * @param tracer the tracer to report each object to
+ */
+OBJECT_SELECTOR void trace(const void * _self, struct Tracer * tracer)
+{
+    const struct Class * class = class_of(_self);
+    OBJECT_CHECK(tracer && class->trace);
+
+    class->trace(_self, tracer);
+}
+
+/******************************************************************************
+ * SUPER CLASS SELECTORS
+ * Functions that are called by any subclasses to access its superclass methods.
+*******************************************************************************/
+
+OBJECT_SELECTOR void * super_ctor(const void * _class, void * _self, va_list * arg_list_ptr)
+{
+    const struct Class * superclass = super(_class);
+    OBJECT_CHECK(_self && superclass->ctor);
+
+    return superclass->ctor(_self, arg_list_ptr);
+}
+
+OBJECT_SELECTOR void * super_dtor(const void * _class, void * _self)
+{
+    const struct Class * superclass = super(_class);
+    OBJECT_CHECK(_self && superclass->dtor);
+
+    return superclass->dtor(_self);
+}
+
+OBJECT_SELECTOR int super_differ(const void * _class, const void * _self, const void* other)
+{
+    const struct Class* superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->differ);
+    return superclass->differ(_self, other);
+}
+
+OBJECT_SELECTOR int super_puto(const void * _class, const void * _self, FILE * file_ptr)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->puto);
+    return superclass->puto(_self, file_ptr);
+}
+
+OBJECT_SELECTOR int super_sputo(const void * _class, const void * _self, struct Buffer * out)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->sputo);
+    return superclass->sputo(_self, out);
+}
+
+OBJECT_SELECTOR int super_serialize(const void * _class, const void * _self, struct Buffer * out)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->serialize);
+    return superclass->serialize(_self, out);
+}
+
+OBJECT_SELECTOR void * super_deserialize(const void * _class, void * _self, struct Reader * in)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->deserialize);
+    return superclass->deserialize(_self, in);
+}
+
+OBJECT_SELECTOR void * super_copy(const void * _class, const void * _self)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->copy);
+    return superclass->copy(_self);
+}
+
+OBJECT_SELECTOR size_t super_hash(const void * _class, const void * _self)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->hash);
+    return superclass->hash(_self);
+}
+
+OBJECT_SELECTOR void super_trace(const void * _class, const void * _self, struct Tracer * tracer)
+{
+    const struct Class * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->trace);
+    superclass->trace(_self, tracer);
+}
+
+#endif  /* !__OBJECT_DISPATCH__H__SL */
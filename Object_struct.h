@@ -1,29 +1,335 @@
-#ifndef __OBJECT_STRUCT__H__SL
-#define __OBJECT_STRUCT__H__SL
-
-#include <stdio.h>
-#include <stdarg.h>
-
-struct Object
-{
-    const struct Class * class;
-};
-
-struct Class
-{
-    const struct Object _;
-    const char * name;
-    const struct Class * super;
-    size_t size;
-    void * (*ctor)(void * self, va_list * arg_ptr);
-    void * (*dtor)(void * self);
-    int (*differ)(const void * self, const void * other);
-    int (*puto)(const void * self, FILE * file_ptr);
-};
-
-void * super_ctor(const void * class, void * self, va_list * arg_ptr);
-void * super_dtor(const void * class, void * self);
-int super_differ(const void * class, const void * self, const void * other);
-int super_puto(const void * class, const void * self, FILE * file_ptr);
-
-#endif  /* !__OBJECT_STRUCT__H__SL */
+#ifndef __OBJECT_STRUCT__H__SL
+#define __OBJECT_STRUCT__H__SL
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+struct Buffer;
+struct Reader;
+struct Method;
+struct Tracer;
+
+/* the same as in Object.h */
+typedef void (*selector_fn)(void);
+
+struct Object
+{
+    const struct Class * class;
+};
+
+/* The deepest a class may sit below Object, which is at depth 0 */
+#define CLASS_MAX_DEPTH 16
+
+struct Class
+{
+    const struct Object _;
+    const char * name;
+    const struct Class * super;
+    size_t size;
+    void * (*ctor)(void * self, va_list * arg_ptr);
+    void * (*dtor)(void * self);
+    int (*differ)(const void * self, const void * other);
+    int (*puto)(const void * self, FILE * file_ptr);
+    int (*sputo)(const void * self, struct Buffer * out);
+    int (*serialize)(const void * self, struct Buffer * out);
+    void * (*deserialize)(void * self, struct Reader * in);
+    void * (*copy)(const void * self);
+    size_t (*hash)(const void * self);
+    void (*trace)(const void * self, struct Tracer * tracer);
+    size_t id;      /* Object is 0, the other classes are numbered in order of
+                    creation after the static ones (see CLASS_STATIC) */
+    /* display[d] is the ancestor at depth d, from Object at display[0] down to
+    the class itself at display[depth]; the entries below it are NULL */
+    size_t depth;
+    const struct Class * display[CLASS_MAX_DEPTH];
+    /* the methods bound to selectors that have no slot, the inherited ones
+    included, as a hash table of method_mask + 1 entries; NULL if there are none */
+    const struct Method * methods;
+    size_t method_mask;
+};
+
+/* trace() reports each object that self refers to by calling visit() on the
+tracer. A class holding objects made by new() reports them; one holding objects
+in its own memory, like a Vector, traces them in turn instead, since they are not
+objects of their own to visit. */
+struct Tracer
+{
+    void (*visit)(struct Tracer * self, const void * object);
+};
+
+/* With OBJECT_REFCOUNT or OBJECT_GC every object made by allocate(), and so by
+new(), is preceded by a header: its reference count (see retain() and release()),
+or where the collector keeps it and the mark of the last cycle that reached it
+(see Collector.h). Objects built with init() or new_in() have no header. */
+#if defined(OBJECT_REFCOUNT) && defined(OBJECT_GC)
+#error "OBJECT_REFCOUNT and OBJECT_GC cannot be used together"
+#endif
+
+#ifdef OBJECT_REFCOUNT
+#define OBJECT_HEADER
+struct Header
+{
+    _Alignas(max_align_t) atomic_size_t references;
+};
+#elif defined(OBJECT_GC)
+#define OBJECT_HEADER
+struct Header
+{
+    _Alignas(max_align_t) size_t slot;  /* the index in the heap of its class */
+    unsigned mark;
+};
+#endif
+
+#ifdef OBJECT_HEADER
+#define OBJECT_HEADER_SIZE  sizeof(struct Header)
+#define header_of(self)     ((struct Header *) (self) - 1)
+#else
+#define OBJECT_HEADER_SIZE  0
+#endif
+
+/* With OBJECT_GC allocate() hands every object to the collector and deallocate()
+takes it back; gc_untrack() returns 0 when the collector is to give the memory
+back itself, later. So that a cycle in progress sees every reference, a class
+calls OBJECT_WRITE(object) after it stores a reference to object, and
+OBJECT_WRITE_ALL(self) after it moves self, an object with references of its own,
+into memory of its own. Without OBJECT_GC the hooks compile to nothing. */
+#ifdef OBJECT_GC
+void gc_track(void * object);
+int gc_untrack(void * object);
+void gc_write(const void * object);
+void gc_write_all(const void * self);
+#define OBJECT_WRITE(object)    gc_write(object)
+#define OBJECT_WRITE_ALL(self)  gc_write_all(self)
+#else
+#define OBJECT_WRITE(object)    ((void) 0)
+#define OBJECT_WRITE_ALL(self)  ((void) 0)
+#endif
+
+/******************************************************************************
+ * INSTRUMENTATION HOOKS
+ * With OBJECT_STATS the runtime counts, per class, the objects allocate() and
+ * deallocate() handle and the calls made through the ctor, dtor, differ, puto
+ * and draw selectors. Each thread counts into a table of its own, indexed by
+ * class id, so counting never contends: a counter is only ever written by its
+ * thread and is bumped with a plain load and store. stats_snapshot() adds the
+ * tables up. Without OBJECT_STATS the hooks compile to nothing.
+*******************************************************************************/
+
+enum
+{
+    STATS_CREATED,
+    STATS_DESTROYED,
+    STATS_BYTES,
+    STATS_CTOR,
+    STATS_DTOR,
+    STATS_DIFFER,
+    STATS_PUTO,
+    STATS_DRAW,
+    STATS_COUNTERS
+};
+
+#ifdef OBJECT_STATS
+
+struct ClassCounters
+{
+    _Atomic(const struct Class *) class;    /* NULL until the thread first counts it */
+    atomic_uint_least64_t count[STATS_COUNTERS];
+};
+
+/* A thread's table only grows, and only with the lock in Stats.c held, which is
+also held while the tables are added up. */
+struct CounterTable
+{
+    struct ClassCounters * counters;
+    size_t capacity;
+    struct CounterTable * next;
+    int registered;
+};
+
+extern _Thread_local struct CounterTable counter_table;
+
+/* The slow path: make room for class in the calling thread's table */
+struct ClassCounters * stats_entry(const struct Class * class);
+
+inline void stats_bump(const struct Class * class, int counter, uint64_t n)
+{
+    struct ClassCounters * entry = class->id < counter_table.capacity
+        ? counter_table.counters + class->id : NULL;
+
+    if (!entry || !atomic_load_explicit(&entry->class, memory_order_relaxed))
+        entry = stats_entry(class);
+    atomic_store_explicit(entry->count + counter,
+        atomic_load_explicit(entry->count + counter, memory_order_relaxed) + n,
+        memory_order_relaxed);
+}
+
+#define OBJECT_COUNT(class, counter, n)  stats_bump((const struct Class *) (class), (counter), (n))
+#else
+#define OBJECT_COUNT(class, counter, n)  ((void) 0)
+#endif
+
+/* Selector definitions (see Object_dispatch.h) are prefixed with OBJECT_SELECTOR
+and validate their arguments with OBJECT_CHECK, which is compiled out of the
+fast-dispatch build. */
+#ifdef OBJECT_FAST_DISPATCH
+#define OBJECT_SELECTOR     inline
+#define OBJECT_CHECK(expr)  ((void) 0)
+#include "Object_dispatch.h"
+#else
+#define OBJECT_SELECTOR
+#define OBJECT_CHECK(expr)  assert(expr)
+void * super_ctor(const void * class, void * self, va_list * arg_ptr);
+void * super_dtor(const void * class, void * self);
+int super_differ(const void * class, const void * self, const void * other);
+int super_puto(const void * class, const void * self, FILE * file_ptr);
+int super_sputo(const void * class, const void * self, struct Buffer * out);
+int super_serialize(const void * class, const void * self, struct Buffer * out);
+void * super_deserialize(const void * class, void * self, struct Reader * in);
+void * super_copy(const void * class, const void * self);
+size_t super_hash(const void * class, const void * self);
+void super_trace(const void * class, const void * self, struct Tracer * tracer);
+#endif
+
+/* Allocate a zeroed object of the given class without running its ctor, and give
+its memory back without running its dtor. new() and delete() are built on these;
+loaders use them to fill objects in some other way, for example deserialize(). */
+void * allocate(const void * class);
+void deallocate(void * self);
+
+/* Mix value into hash, for building hash() methods out of several fields */
+size_t hash_combine(size_t hash, size_t value);
+
+/* Used by the initXxx() functions to build their class descriptors exactly once,
+even when several threads call them at the same time. once must be a static
+atomic_int initialized to 0. */
+void class_once(atomic_int * once, void (*build)(void));
+
+/* A metaclass that adds slots for methods to its descriptors declares each one
+once, after the metaclass is built and before any class of it is, so that the
+methods given to new() for the selector go into the slot at that offset:
+
+    class_slot(PointClass, (selector_fn) draw, offsetof(struct PointClass, draw));
+
+The slots of struct Class itself are known from the start. */
+void class_slot(const void * metaclass, selector_fn selector, size_t offset);
+
+/******************************************************************************
+ * STATIC CLASSES
+ * A class can also be defined at compile time, the way Object and Class are:
+ * its descriptor is a constant that needs no initXxx() before it is used, goes
+ * into read-only memory (once relocated, in a position-independent program) and
+ * lets the compiler resolve calls made through it.
+ *
+ *   CLASS_STATIC(Circle, PointClass, Point, CIRCLE_ID,
+ *       Point_METHODS(),
+ *       ._.ctor = Circle_ctor,
+ *       .draw = Circle_draw);
+ *
+ * defines Circle_descriptor, a struct PointClass for instances of struct Circle
+ * that derives from Point, and Circle, the pointer to it. The methods are given
+ * as designators into the descriptor, so the slots of struct Class are under
+ * "._" in the descriptor of a class of PointClass. They start with those of the
+ * superclass, which X_METHODS(at) lists for a static class X, at being where
+ * X's metaclass part is in the descriptor; a later designator overrides an
+ * earlier one. A static class X also defines X_ANCESTORS for its subclasses,
+ * and a static metaclass X defines X_BASE, where struct Class is in its
+ * descriptors.
+ *
+ * What Class_ctor would do otherwise is left to the definition: the id, from
+ * 2 up to CLASS_STATIC_IDS, is picked by hand, a metaclass ctor does not run,
+ * and a static class has no messages. The superclass and metaclass have to be
+ * static as well. class_register() enters a static class into the registry, in
+ * any order, for class_named() and archives.
+*******************************************************************************/
+
+/* ids below this one are for static classes, new() numbers the others from it */
+#define CLASS_STATIC_IDS    32
+
+void class_register(const void * class);
+
+extern const struct Class Object_descriptor;
+extern const struct Class Class_descriptor;
+
+void * Object_ctor(void * self, va_list * arg_ptr);
+void * Object_dtor(void * self);
+int Object_differ(const void * self, const void * other);
+int Object_puto(const void * self, FILE * file_ptr);
+int Object_sputo(const void * self, struct Buffer * out);
+int Object_serialize(const void * self, struct Buffer * out);
+void * Object_deserialize(void * self, struct Reader * in);
+void * Object_copy(const void * self);
+size_t Object_hash(const void * self);
+void Object_trace(const void * self, struct Tracer * tracer);
+void * Class_ctor(void * self, va_list * arg_ptr);
+void * Class_dtor(void * self);
+int Class_serialize(const void * self, struct Buffer * out);
+void * Class_copy(const void * self);
+
+#define Object_METHODS(at) \
+    at.ctor = Object_ctor, at.dtor = Object_dtor, at.differ = Object_differ, \
+    at.puto = Object_puto, at.sputo = Object_sputo, at.serialize = Object_serialize, \
+    at.deserialize = Object_deserialize, at.copy = Object_copy, at.hash = Object_hash, \
+    at.trace = Object_trace
+#define Class_METHODS(at) \
+    Object_METHODS(at), at.ctor = Class_ctor, at.dtor = Class_dtor, \
+    at.serialize = Class_serialize, at.copy = Class_copy
+
+/* The entries of the display of a static class, X_ANCESTORS being those of X */
+#define CLASS_ANCESTOR(cls)     ((const struct Class *) &cls##_descriptor)
+#define Object_ANCESTORS        CLASS_ANCESTOR(Object)
+#define Class_ANCESTORS         Object_ANCESTORS, CLASS_ANCESTOR(Class)
+#define Class_BASE              /* a descriptor of Class is a struct Class */
+
+#define CLASS_STATIC(cls, meta, parent, number, ...) \
+    _Static_assert((number) > 1 && (number) < CLASS_STATIC_IDS, #cls ": not a static class id"); \
+    _Static_assert(CLASS_DEPTH(parent##_ANCESTORS) < CLASS_MAX_DEPTH, #cls ": too deep"); \
+    CLASS_OVERRIDES_BEGIN \
+    const struct meta cls##_descriptor = { \
+        CLASS_HEAD(meta##_BASE, cls, meta, parent, number), \
+        __VA_ARGS__ \
+    }; \
+    CLASS_OVERRIDES_END \
+    const void * const cls = &cls##_descriptor
+
+#define CLASS_DEPTH(...)    (sizeof((const struct Class *[]) { __VA_ARGS__ }) / sizeof(const struct Class *))
+
+#define CLASS_HEAD(at, cls, meta, parent, number) \
+    at._.class = CLASS_ANCESTOR(meta), \
+    at.name = #cls, \
+    at.super = CLASS_ANCESTOR(parent), \
+    at.size = sizeof(struct cls), \
+    at.id = (number), \
+    at.depth = CLASS_DEPTH(parent##_ANCESTORS), \
+    at.display = { parent##_ANCESTORS, CLASS_ANCESTOR(cls) }
+
+/* overriding the inherited methods is the point, so GCC and Clang are not to warn about it */
+#if defined(__GNUC__)
+#define CLASS_OVERRIDES_BEGIN   _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Woverride-init\"")
+#define CLASS_OVERRIDES_END     _Pragma("GCC diagnostic pop")
+#else
+#define CLASS_OVERRIDES_BEGIN
+#define CLASS_OVERRIDES_END
+#endif
+
+/* Batch selectors are built on batch_by_class(), which calls fn once per run of
+objects that share a class. positions[i] is the index of run[i] in the original
+array, or positions is NULL when the run is the original array. */
+typedef void (*batch_fn)(const void * class, void * const * run, size_t count,
+    const size_t * positions, void * ctx);
+void batch_by_class(void * const * objects, size_t n, batch_fn fn, void * ctx);
+
+/* Static dispatch: call a method through a class descriptor known at the call site
+instead of loading it from the object. When the descriptor is a constant the
+compiler can see (the same translation unit, or with link-time optimization) the
+indirect call is resolved at compile time. */
+#define ctor_as(class, self, arg_ptr)   (((const struct Class *) (class))->ctor((self), (arg_ptr)))
+#define dtor_as(class, self)            (((const struct Class *) (class))->dtor(self))
+#define differ_as(class, self, other)   (((const struct Class *) (class))->differ((self), (other)))
+#define puto_as(class, self, file_ptr)  (((const struct Class *) (class))->puto((self), (file_ptr)))
+#define sputo_as(class, self, out)      (((const struct Class *) (class))->sputo((self), (out)))
+
+#endif  /* !__OBJECT_STRUCT__H__SL */
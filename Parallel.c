@@ -0,0 +1,360 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcpy() */
+#include <stdlib.h>     /* for getenv(), atoi(), malloc() */
+#include <stdint.h>     /* for intptr_t */
+#include <stdatomic.h>  /* for atomic_int */
+#include <pthread.h>    /* for pthread_create() */
+#include <unistd.h>     /* for sysconf() */
+
+#include "Parallel.h"
+
+#define PARALLEL_MAX_THREADS    256
+#define PARALLEL_MAX_GRAIN      1024    /* of the automatic grain */
+
+static atomic_int thread_count;         /* 0 until first asked for */
+static atomic_size_t grain_setting;
+static _Thread_local int inside;        /* set while running the body of a loop */
+static _Thread_local int worker_index;
+
+/******************************************************************************
+ * SETTINGS
+*******************************************************************************/
+
+int parallel_threads(void)
+{
+    int threads = atomic_load_explicit(&thread_count, memory_order_relaxed);
+
+    if (!threads)
+    {
+        const char * value = getenv("OBJECT_THREADS");
+        threads = value ? atoi(value) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+        parallel_set_threads(threads);
+        threads = atomic_load_explicit(&thread_count, memory_order_relaxed);
+    }
+    return threads;
+}
+
+void parallel_set_threads(int threads)
+{
+    if (threads < 1)
+        threads = 1;
+    if (threads > PARALLEL_MAX_THREADS)
+        threads = PARALLEL_MAX_THREADS;
+    atomic_store_explicit(&thread_count, threads, memory_order_relaxed);
+}
+
+void parallel_set_grain(size_t grain)
+{
+    atomic_store_explicit(&grain_setting, grain, memory_order_relaxed);
+}
+
+int parallel_worker(void)
+{
+    return worker_index;
+}
+
+/******************************************************************************
+ * RANGES
+ * Each thread owns the indices begin .. end - 1 of its range. The owner takes
+ * a grain from the front, thieves take half of what is left from the back. A
+ * range is only touched with its lock held, which the owner nearly always gets
+ * at once; a range has a cache line to itself so the owners do not get in each
+ * other's way.
+*******************************************************************************/
+
+struct Range
+{
+    _Alignas(64) pthread_mutex_t lock;
+    size_t begin, end;
+};
+
+struct Job
+{
+    size_t n, grain;
+    range_fn fn;
+    void * ctx;
+    int participants;
+    struct Range ranges[PARALLEL_MAX_THREADS];
+};
+
+static int take(struct Range * range, size_t grain, size_t * begin, size_t * end)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&range->lock);
+    if (range->begin < range->end)
+    {
+        *begin = range->begin;
+        *end = range->end - range->begin < grain ? range->end : range->begin + grain;
+        range->begin = *end;
+        found = 1;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+/* Move half of what another thread has left into the thief's own, empty range */
+static int steal(struct Job * job, int thief)
+{
+    for (int i = 1; i < job->participants; i++)
+    {
+        struct Range * victim = job->ranges + (thief + i) % job->participants;
+        size_t begin = 0, end = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->begin < victim->end)
+        {
+            end = victim->end;
+            begin = end - (end - victim->begin + 1) / 2;
+            victim->end = begin;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (begin < end)
+        {
+            struct Range * own = job->ranges + thief;
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void work(struct Job * job, int index)
+{
+    size_t begin, end;
+
+    inside = 1;
+    worker_index = index;
+    do
+    {
+        while (take(job->ranges + index, job->grain, &begin, &end))
+            job->fn(begin, end, job->ctx);
+    }
+    while (steal(job, index));
+    worker_index = 0;
+    inside = 0;
+}
+
+/******************************************************************************
+ * POOL
+ * The workers sleep until the generation changes, work on the job if they are
+ * one of its participants, and report back. A job lives on the stack of the
+ * thread that started it, which waits for all of its workers before returning.
+ * It does not wait for the others, which may wake up after the job is gone, so
+ * the pool keeps the number of participants and they only ever look at that.
+*******************************************************************************/
+
+static struct
+{
+    pthread_mutex_t submit;     /* held while a job runs */
+    pthread_mutex_t lock;       /* for the fields below */
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    int started;                /* worker threads, numbered 1 .. started */
+    unsigned long generation;
+    unsigned long born;         /* the generation new workers start from */
+    struct Job * job;
+    int participants;           /* of the job, the calling thread included */
+    int running;                /* workers still on the job */
+} pool = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER,
+    PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, NULL, 0, 0 };
+
+static void * worker(void * arg)
+{
+    int index = (int) (intptr_t) arg;
+    unsigned long seen;
+
+    pthread_mutex_lock(&pool.lock);
+    seen = pool.born;
+    for (;;)
+    {
+        while (pool.generation == seen)
+            pthread_cond_wait(&pool.wake, &pool.lock);
+        seen = pool.generation;
+
+        if (index >= pool.participants)
+            continue;
+        struct Job * job = pool.job;
+        pthread_mutex_unlock(&pool.lock);
+
+        work(job, index);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.running == 0)
+            pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+/* Called with submit held. Returns the number of workers there are. */
+static int start_workers(int wanted)
+{
+    while (pool.started < wanted)
+    {
+        pthread_t thread;
+
+        /* the worker may first run after the job is posted, so it is told
+        which generation was current when it was made */
+        pthread_mutex_lock(&pool.lock);
+        pool.born = pool.generation;
+        int failed = pthread_create(&thread, NULL, worker, (void *) (intptr_t) (pool.started + 1));
+        if (!failed)
+            pool.started++;
+        pthread_mutex_unlock(&pool.lock);
+        if (failed)
+            break;
+        pthread_detach(thread);
+    }
+    return pool.started;
+}
+
+/* Run a loop on at most threads participants, the calling thread being one */
+static void run(size_t n, size_t grain, range_fn fn, void * ctx, int threads)
+{
+    if (!n)
+        return;
+    if (!grain)
+        grain = 1;
+
+    size_t chunks = (n - 1) / grain + 1;
+    if ((size_t) threads > chunks)
+        threads = (int) chunks;
+    if (threads <= 1 || inside || pthread_mutex_trylock(&pool.submit))
+    {
+        int index = worker_index;
+        worker_index = 0;
+        fn(0, n, ctx);
+        worker_index = index;
+        return;
+    }
+
+    int workers = start_workers(threads - 1);
+    if (workers < threads - 1)
+        threads = workers + 1;
+
+    struct Job job = { .n = n, .grain = grain, .fn = fn, .ctx = ctx, .participants = threads };
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_mutex_init(&job.ranges[i].lock, NULL);
+        job.ranges[i].begin = n / threads * i;
+        job.ranges[i].end = i == threads - 1 ? n : n / threads * (i + 1);
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.job = &job;
+    pool.participants = threads;
+    pool.running = threads - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.wake);
+    pthread_mutex_unlock(&pool.lock);
+
+    work(&job, 0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.running)
+        pthread_cond_wait(&pool.done, &pool.lock);
+    pool.job = NULL;
+    pool.participants = 0;
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < threads; i++)
+        pthread_mutex_destroy(&job.ranges[i].lock);
+    pthread_mutex_unlock(&pool.submit);
+}
+
+/**
+ * @brief Call fn(begin, end, ctx) for consecutive ranges that cover 0 .. n - 1,
+ *        on several threads at once. fn must be safe to run concurrently with
+ *        itself on different ranges.
+ *
+ * @param grain the most indices handed out at a time (0 means 1)
+ */
+void parallel_for(size_t n, size_t grain, range_fn fn, void * ctx)
+{
+    assert(fn);
+
+    run(n, grain, fn, ctx, parallel_threads());
+}
+
+/******************************************************************************
+ * OBJECT LOOPS
+*******************************************************************************/
+
+static size_t grain_for(size_t n)
+{
+    size_t grain = atomic_load_explicit(&grain_setting, memory_order_relaxed);
+
+    if (!grain)
+    {
+        /* about eight grains per thread, so that there is something to steal */
+        grain = n / (8 * (size_t) parallel_threads());
+        grain = grain < 1 ? 1 : grain > PARALLEL_MAX_GRAIN ? PARALLEL_MAX_GRAIN : grain;
+    }
+    return grain;
+}
+
+struct ForEach
+{
+    void * const * objects;
+    object_fn fn;
+    void * ctx;
+};
+
+static void for_each_range(size_t begin, size_t end, void * _each)
+{
+    struct ForEach * each = _each;
+
+    for (size_t i = begin; i < end; i++)
+        each->fn(each->objects[i], each->ctx);
+}
+
+void parallel_for_each(void * const * objects, size_t n, object_fn fn, void * ctx)
+{
+    struct ForEach each = { objects, fn, ctx };
+    assert((objects || !n) && fn);
+
+    parallel_for(n, grain_for(n), for_each_range, &each);
+}
+
+struct Reduce
+{
+    void * const * objects;
+    fold_fn fold;
+    void * ctx;
+    unsigned char * partials;   /* one per thread */
+    size_t stride;
+};
+
+static void reduce_range(size_t begin, size_t end, void * _reduce)
+{
+    struct Reduce * reduce = _reduce;
+    void * partial = reduce->partials + (size_t) parallel_worker() * reduce->stride;
+
+    for (size_t i = begin; i < end; i++)
+        reduce->fold(partial, reduce->objects[i], reduce->ctx);
+}
+
+void parallel_reduce(void * const * objects, size_t n, void * result, size_t size,
+    fold_fn fold, combine_fn combine, void * ctx)
+{
+    assert((objects || !n) && result && size && fold && combine);
+
+    /* keep the partial results on cache lines of their own */
+    size_t stride = (size + 63) / 64 * 64;
+    int threads = parallel_threads();
+    struct Reduce reduce = { objects, fold, ctx, malloc(threads * stride), stride };
+    assert(reduce.partials);
+
+    /* run() with the count the partials were made for, whatever the setting is now */
+    for (int i = 0; i < threads; i++)
+        memcpy(reduce.partials + i * stride, result, size);
+    run(n, grain_for(n), reduce_range, &reduce, threads);
+    for (int i = 0; i < threads; i++)
+        combine(result, reduce.partials + i * stride, ctx);
+
+    free(reduce.partials);
+}
@@ -0,0 +1,54 @@
+#ifndef __PARALLEL__H__SL
+#define __PARALLEL__H__SL
+
+#include <stddef.h>
+
+/******************************************************************************
+ * PARALLEL LOOPS
+ * The loops run on a pool of worker threads that is started on first use and
+ * kept for the life of the program, with the calling thread taking part. Each
+ * thread starts out with an equal share of the indices and works through it a
+ * grain at a time; a thread that runs out steals half of what another thread
+ * has left, so uneven work still spreads out. Every loop returns once all of
+ * its indices have been done.
+ *
+ * Only one loop runs on the pool at a time. A loop started while another one
+ * is running, from another thread or from inside the loop itself, runs on the
+ * calling thread alone. The loop bodies may call new() and delete().
+ *
+ * The number of threads is the number of online processors, or the value of the
+ * OBJECT_THREADS environment variable, or what parallel_set_threads() last set.
+*******************************************************************************/
+
+typedef void (*range_fn)(size_t begin, size_t end, void * ctx);
+typedef void (*object_fn)(void * object, void * ctx);
+
+/* fold adds object to a thread's partial result, combine adds a partial result
+to the final one; combine must be associative and commutative */
+typedef void (*fold_fn)(void * partial, void * object, void * ctx);
+typedef void (*combine_fn)(void * result, const void * partial, void * ctx);
+
+/* Call fn(begin, end, ctx) for ranges of at most grain indices (0 means 1) that
+together cover 0 .. n - 1 */
+void parallel_for(size_t n, size_t grain, range_fn fn, void * ctx);
+
+/* Call fn(objects[i], ctx) for every object, grain objects at a time */
+void parallel_for_each(void * const * objects, size_t n, object_fn fn, void * ctx);
+
+/* Fold every object into result, which is size bytes. On entry result holds the
+identity, for example an empty bounding box or a count of 0: each thread starts
+its partial result as a copy of it. */
+void parallel_reduce(void * const * objects, size_t n, void * result, size_t size,
+    fold_fn fold, combine_fn combine, void * ctx);
+
+/* The grain of parallel_for_each() and parallel_reduce(); 0, the default, picks
+one from the number of objects and threads */
+void parallel_set_grain(size_t grain);
+
+int parallel_threads(void);
+void parallel_set_threads(int threads);
+
+/* Inside a loop body: which thread runs it, 0 .. parallel_threads() - 1 */
+int parallel_worker(void);
+
+#endif  /* !__PARALLEL__H__SL */
@@ -0,0 +1,340 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memset() */
+#include <stdlib.h>     /* for malloc(), calloc() */
+#include <pthread.h>    /* for pthread_mutex_t */
+
+#include "Pool.h"
+#include "Object_struct.h"
+
+#define POOL_BUCKETS    (POOL_MAX_SIZE / POOL_GRANULE)
+#define POOL_SLAB_SIZE  (64 * 1024)
+#define POOL_BATCH      32
+
+#ifdef OBJECT_POOL_DISABLE
+#undef OBJECT_POOL_THREAD_CACHE
+#endif
+
+#if __STDC_VERSION__ >= 201112L
+#define thread_local _Thread_local
+#else
+#define thread_local __thread
+#endif
+
+/******************************************************************************
+ * BUCKETS
+ * One bucket per size class. A free block stores the pointer to the next free
+ * block in its first word, so the free list costs no memory of its own. Slabs are
+ * never handed back to the system: a program that once had a million Points alive
+ * keeps the memory for the next million.
+*******************************************************************************/
+
+struct Bucket
+{
+    pthread_mutex_t lock;
+    void * free_list;
+    size_t free;
+    size_t capacity;
+    size_t slabs;
+};
+
+#define BUCKET_INIT { PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, 0 }
+
+static struct Bucket buckets[POOL_BUCKETS] = {
+    BUCKET_INIT, BUCKET_INIT, BUCKET_INIT, BUCKET_INIT,
+    BUCKET_INIT, BUCKET_INIT, BUCKET_INIT, BUCKET_INIT,
+    BUCKET_INIT, BUCKET_INIT, BUCKET_INIT, BUCKET_INIT,
+    BUCKET_INIT, BUCKET_INIT, BUCKET_INIT, BUCKET_INIT,
+};
+
+static size_t bucket_of(size_t size)
+{
+    return (size + POOL_GRANULE - 1) / POOL_GRANULE - 1;
+}
+
+static size_t block_size_of(size_t bucket)
+{
+    return (bucket + 1) * POOL_GRANULE;
+}
+
+#ifndef OBJECT_POOL_DISABLE
+
+/**
+ * @brief Carve a new slab into blocks and put them on the bucket's free list.
+ *        Must be called with the bucket locked.
+ */
+static void refill(struct Bucket * bucket, size_t block_size)
+{
+    char * slab = malloc(POOL_SLAB_SIZE);
+    assert(slab);
+
+    size_t count = POOL_SLAB_SIZE / block_size;
+    /* link the blocks back to front so that they are handed out in address order */
+    for (size_t i = count; i-- > 0; )
+    {
+        void ** block = (void **) (slab + i * block_size);
+        *block = bucket->free_list;
+        bucket->free_list = block;
+    }
+    bucket->free += count;
+    bucket->capacity += count;
+    bucket->slabs++;
+}
+
+/**
+ * @brief Take up to count blocks from the shared free list, chained through their
+ *        first word. Returns the head of the chain and stores its length in *taken.
+ */
+static void * take(struct Bucket * bucket, size_t block_size, size_t count, size_t * taken)
+{
+    pthread_mutex_lock(&bucket->lock);
+    if (!bucket->free_list)
+        refill(bucket, block_size);
+
+    void * head = bucket->free_list;
+    void ** tail = head;
+    size_t n = 1;
+    while (n < count && *tail)
+    {
+        tail = *tail;
+        n++;
+    }
+    bucket->free_list = *tail;
+    bucket->free -= n;
+    pthread_mutex_unlock(&bucket->lock);
+
+    *tail = NULL;
+    *taken = n;
+    return head;
+}
+
+/**
+ * @brief Give a chain of count blocks from head to tail back to the shared free list.
+ */
+static void give(struct Bucket * bucket, void * head, void * tail, size_t count)
+{
+    pthread_mutex_lock(&bucket->lock);
+    *(void **) tail = bucket->free_list;
+    bucket->free_list = head;
+    bucket->free += count;
+    pthread_mutex_unlock(&bucket->lock);
+}
+
+#endif  /* !OBJECT_POOL_DISABLE */
+
+/******************************************************************************
+ * PER-THREAD CACHE
+ * With OBJECT_POOL_THREAD_CACHE each thread keeps up to 2 * POOL_BATCH blocks per
+ * bucket. The shared bucket is only locked to move a whole batch in or out, and a
+ * thread's cache is handed back to the buckets when the thread exits.
+*******************************************************************************/
+
+#ifdef OBJECT_POOL_THREAD_CACHE
+
+struct Cache
+{
+    void * head[POOL_BUCKETS];
+    size_t count[POOL_BUCKETS];
+    int registered;
+};
+
+static thread_local struct Cache cache;
+
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+static void flush(void * _cache)
+{
+    struct Cache * self = _cache;
+
+    for (size_t i = 0; i < POOL_BUCKETS; i++)
+    {
+        if (!self->head[i])
+            continue;
+        void ** tail = self->head[i];
+        while (*tail)
+            tail = *tail;
+        give(buckets + i, self->head[i], tail, self->count[i]);
+        self->head[i] = NULL;
+        self->count[i] = 0;
+    }
+}
+
+static void make_cache_key(void)
+{
+    pthread_key_create(&cache_key, flush);
+}
+
+static void register_cache(void)
+{
+    pthread_once(&cache_key_once, make_cache_key);
+    pthread_setspecific(cache_key, &cache);
+    cache.registered = 1;
+}
+
+static void * cache_alloc(size_t i)
+{
+    if (!cache.head[i])
+    {
+        if (!cache.registered)
+            register_cache();
+        cache.head[i] = take(buckets + i, block_size_of(i), POOL_BATCH, cache.count + i);
+    }
+    void ** block = cache.head[i];
+    cache.head[i] = *block;
+    cache.count[i]--;
+
+    return block;
+}
+
+static void cache_free(void * block, size_t i)
+{
+    *(void **) block = cache.head[i];
+    cache.head[i] = block;
+
+    if (++cache.count[i] > 2 * POOL_BATCH)
+    {
+        /* hand the oldest batch back: keep the POOL_BATCH most recently freed blocks */
+        void ** tail = cache.head[i];
+        for (size_t n = 1; n < POOL_BATCH; n++)
+            tail = *tail;
+        void * released = *tail;
+        *tail = NULL;
+
+        void ** last = released;
+        while (*last)
+            last = *last;
+        give(buckets + i, released, last, cache.count[i] - POOL_BATCH);
+        cache.count[i] = POOL_BATCH;
+    }
+}
+
+#endif  /* OBJECT_POOL_THREAD_CACHE */
+
+/******************************************************************************
+ * ALLOCATION
+*******************************************************************************/
+
+/**
+ * @brief Allocate a zeroed block of at least size bytes, like calloc(1, size).
+ */
+void * pool_alloc(size_t size)
+{
+#ifndef OBJECT_POOL_DISABLE
+    if (size && size <= POOL_MAX_SIZE)
+    {
+        size_t i = bucket_of(size);
+        void * block;
+#ifdef OBJECT_POOL_THREAD_CACHE
+        block = cache_alloc(i);
+#else
+        size_t taken;
+        block = take(buckets + i, block_size_of(i), 1, &taken);
+#endif
+        return memset(block, 0, size);
+    }
+#endif
+    return calloc(1, size);
+}
+
+/**
+ * @brief Return a block obtained from pool_alloc(). size must be the same size that
+ *        was asked for, which for objects is size_of() of the object.
+ */
+void pool_free(void * block, size_t size)
+{
+    if (!block)
+        return;
+#ifndef OBJECT_POOL_DISABLE
+    if (size && size <= POOL_MAX_SIZE)
+    {
+        size_t i = bucket_of(size);
+#ifdef OBJECT_POOL_THREAD_CACHE
+        cache_free(block, i);
+#else
+        give(buckets + i, block, block, 1);
+#endif
+        return;
+    }
+#endif
+    free(block);
+}
+
+/**
+ * @brief Return n blocks that were all asked for with the same size at once. The
+ *        blocks go straight to the shared free list, which is locked only once.
+ */
+void pool_free_all(void * const * blocks, size_t n, size_t size)
+{
+    if (!n)
+        return;
+#ifndef OBJECT_POOL_DISABLE
+    if (size && size <= POOL_MAX_SIZE)
+    {
+        for (size_t k = 1; k < n; k++)
+            *(void **) blocks[k - 1] = blocks[k];
+        give(buckets + bucket_of(size), blocks[0], blocks[n - 1], n);
+        return;
+    }
+#endif
+    for (size_t k = 0; k < n; k++)
+        free(blocks[k]);
+}
+
+/******************************************************************************
+ * STATISTICS
+*******************************************************************************/
+
+static void fill_stats(size_t i, struct PoolStats * stats)
+{
+    struct Bucket * bucket = buckets + i;
+
+    pthread_mutex_lock(&bucket->lock);
+    stats->block_size = block_size_of(i);
+    stats->slabs = bucket->slabs;
+    stats->capacity = bucket->capacity;
+    stats->free = bucket->free;
+    pthread_mutex_unlock(&bucket->lock);
+
+#ifdef OBJECT_POOL_THREAD_CACHE
+    stats->cached = cache.count[i];
+#else
+    stats->cached = 0;
+#endif
+    stats->in_use = stats->capacity - stats->free - stats->cached;
+}
+
+/**
+ * @brief Report the occupancy of the bucket that instances of class are taken from.
+ *
+ * @param class the class descriptor
+ * @param stats filled in with the bucket's numbers
+ * @return int 0 on success, -1 if instances of class are too large to be pooled
+ */
+int pool_stats(const void * _class, struct PoolStats * stats)
+{
+    const struct Class * class = _class;
+    assert(class && stats);
+
+    size_t size = OBJECT_HEADER_SIZE + class->size;
+    if (!class->size || size > POOL_MAX_SIZE)
+        return -1;
+    fill_stats(bucket_of(size), stats);
+
+    return 0;
+}
+
+/**
+ * @brief Print one line for every bucket that has carved at least one slab.
+ */
+void pool_report(FILE * file_ptr)
+{
+    for (size_t i = 0; i < POOL_BUCKETS; i++)
+    {
+        struct PoolStats stats;
+        fill_stats(i, &stats);
+        if (!stats.slabs)
+            continue;
+        fprintf(file_ptr, "pool %3zu bytes: %zu slabs, %zu blocks, %zu in use, %zu free, %zu cached\n",
+            stats.block_size, stats.slabs, stats.capacity, stats.in_use, stats.free, stats.cached);
+    }
+}
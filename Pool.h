@@ -0,0 +1,40 @@
+#ifndef __POOL__H__SL
+#define __POOL__H__SL
+
+#include <stdio.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * SLAB POOL
+ * new() and delete() take their memory from here instead of calloc() and free().
+ * Objects are grouped by size into buckets of POOL_GRANULE bytes; each bucket
+ * carves fixed-size blocks out of large slabs and keeps the returned ones on a
+ * free list. Objects larger than POOL_MAX_SIZE fall through to calloc()/free().
+ *
+ * Compile-time options:
+ *   OBJECT_POOL_THREAD_CACHE  keep a small per-thread cache in front of each bucket
+ *                             so that the common new()/delete() never takes a lock.
+ *   OBJECT_POOL_DISABLE       bypass the pool entirely (handy for valgrind/ASan).
+*******************************************************************************/
+
+#define POOL_GRANULE    16
+#define POOL_MAX_SIZE   256
+
+struct PoolStats
+{
+    size_t block_size;  /* size of one block in the bucket */
+    size_t slabs;       /* slabs carved for the bucket */
+    size_t capacity;    /* blocks carved out of those slabs */
+    size_t free;        /* blocks on the shared free list */
+    size_t cached;      /* blocks parked in the calling thread's cache */
+    size_t in_use;      /* blocks handed out (includes other threads' caches) */
+};
+
+void * pool_alloc(size_t size);
+void pool_free(void * block, size_t size);
+void pool_free_all(void * const * blocks, size_t n, size_t size);
+
+int pool_stats(const void * class, struct PoolStats * stats);
+void pool_report(FILE * file_ptr);
+
+#endif  /* !__POOL__H__SL */
@@ -0,0 +1,368 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcpy() */
+#include <stdlib.h>     /* for malloc(), calloc(), free() */
+#include <pthread.h>    /* for pthread_mutex_t, pthread_key_t */
+
+#include "Stats.h"
+#include "Stats_struct.h"
+
+/******************************************************************************
+ * COUNTER TABLES
+*******************************************************************************/
+
+#ifdef OBJECT_STATS
+
+extern inline void stats_bump(const struct Class * class, int counter, uint64_t n);
+
+_Thread_local struct CounterTable counter_table;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct CounterTable * tables;    /* of the threads that are running */
+static struct CounterTable retired;     /* the totals of the threads that have exited */
+
+static pthread_key_t retire_key;
+static pthread_once_t retire_key_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Grow a table to hold at least capacity classes. Must be called with the
+ *        lock held, and for a running thread's table only by that thread.
+ */
+static void grow(struct CounterTable * table, size_t capacity)
+{
+    size_t size = table->capacity ? table->capacity : 16;
+    while (size < capacity)
+        size *= 2;
+
+    struct ClassCounters * counters = calloc(size, sizeof(*counters));
+    assert(counters);
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        struct ClassCounters * from = table->counters + i;
+        atomic_init(&counters[i].class, atomic_load_explicit(&from->class, memory_order_relaxed));
+        for (size_t c = 0; c < STATS_COUNTERS; c++)
+            atomic_init(counters[i].count + c, atomic_load_explicit(from->count + c, memory_order_relaxed));
+    }
+    free(table->counters);
+    table->counters = counters;
+    table->capacity = size;
+}
+
+/* Fold the counters of an exiting thread into the retired totals */
+static void retire(void * _table)
+{
+    struct CounterTable * table = _table;
+
+    pthread_mutex_lock(&stats_lock);
+    struct CounterTable ** link = &tables;
+    while (*link != table)
+        link = &(*link)->next;
+    *link = table->next;
+
+    if (retired.capacity < table->capacity)
+        grow(&retired, table->capacity);
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        const struct Class * class = atomic_load_explicit(&table->counters[i].class, memory_order_relaxed);
+        if (!class)
+            continue;
+        atomic_store_explicit(&retired.counters[i].class, class, memory_order_relaxed);
+        for (size_t c = 0; c < STATS_COUNTERS; c++)
+            atomic_fetch_add_explicit(retired.counters[i].count + c,
+                atomic_load_explicit(table->counters[i].count + c, memory_order_relaxed),
+                memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    free(table->counters);
+    table->counters = NULL;
+    table->capacity = 0;
+    table->registered = 0;
+}
+
+static void make_retire_key(void)
+{
+    pthread_key_create(&retire_key, retire);
+}
+
+struct ClassCounters * stats_entry(const struct Class * class)
+{
+    pthread_mutex_lock(&stats_lock);
+    if (!counter_table.registered)
+    {
+        pthread_once(&retire_key_once, make_retire_key);
+        pthread_setspecific(retire_key, &counter_table);
+        counter_table.next = tables;
+        tables = &counter_table;
+        counter_table.registered = 1;
+    }
+    if (class->id >= counter_table.capacity)
+        grow(&counter_table, class->id + 1);
+
+    struct ClassCounters * entry = counter_table.counters + class->id;
+    atomic_store_explicit(&entry->class, class, memory_order_relaxed);
+    pthread_mutex_unlock(&stats_lock);
+
+    return entry;
+}
+
+/**
+ * @brief Add the counters of table to the running totals, which are indexed by
+ *        class id and have room for every id in the table.
+ */
+static void add_table(const struct CounterTable * table, const struct Class ** classes,
+    uint64_t (*totals)[STATS_COUNTERS])
+{
+    for (size_t i = 0; i < table->capacity; i++)
+    {
+        const struct Class * class = atomic_load_explicit(&table->counters[i].class, memory_order_relaxed);
+        if (!class)
+            continue;
+        classes[i] = class;
+        for (size_t c = 0; c < STATS_COUNTERS; c++)
+            totals[i][c] += atomic_load_explicit(table->counters[i].count + c, memory_order_relaxed);
+    }
+}
+
+#endif  /* OBJECT_STATS */
+
+/******************************************************************************
+ * SNAPSHOTS
+*******************************************************************************/
+
+static struct ClassStats * append(struct Snapshot * self, const void * class)
+{
+    /* the array is sized by the caller, so this only fills it in */
+    struct ClassStats * stats = self->classes + self->count++;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->class = class;
+    return stats;
+}
+
+/**
+ * @brief Add up the counters of all threads.
+ *
+ * @return void* a new Snapshot
+ */
+void * stats_snapshot(void)
+{
+    initStats();
+
+    struct Snapshot * self = new(Snapshot);
+#ifdef OBJECT_STATS
+    pthread_mutex_lock(&stats_lock);
+    size_t capacity = retired.capacity;
+    for (const struct CounterTable * table = tables; table; table = table->next)
+        capacity = table->capacity > capacity ? table->capacity : capacity;
+
+    const struct Class ** classes = calloc(capacity ? capacity : 1, sizeof(*classes));
+    uint64_t (*totals)[STATS_COUNTERS] = calloc(capacity ? capacity : 1, sizeof(*totals));
+    assert(classes && totals);
+    add_table(&retired, classes, totals);
+    for (const struct CounterTable * table = tables; table; table = table->next)
+        add_table(table, classes, totals);
+    pthread_mutex_unlock(&stats_lock);
+
+    self->classes = malloc((capacity ? capacity : 1) * sizeof(*self->classes));
+    assert(self->classes);
+    for (size_t i = 0; i < capacity; i++)
+    {
+        if (!classes[i])
+            continue;
+        struct ClassStats * stats = append(self, classes[i]);
+        stats->created = totals[i][STATS_CREATED];
+        stats->destroyed = totals[i][STATS_DESTROYED];
+        stats->live = (int64_t) (stats->created - stats->destroyed);
+        stats->bytes = totals[i][STATS_BYTES];
+        stats->ctor = totals[i][STATS_CTOR];
+        stats->dtor = totals[i][STATS_DTOR];
+        stats->differ = totals[i][STATS_DIFFER];
+        stats->puto = totals[i][STATS_PUTO];
+        stats->draw = totals[i][STATS_DRAW];
+    }
+    free(totals);
+    free(classes);
+#endif
+    return self;
+}
+
+/**
+ * @brief What happened between two snapshots: for every class in after, its
+ *        counters minus those in before. live becomes the change in live objects
+ *        and can be negative.
+ *
+ * @return void* a new Snapshot
+ */
+void * stats_diff(const void * _after, const void * _before)
+{
+    const struct Snapshot * after = _after;
+    const struct Snapshot * before = _before;
+    assert(after && before);
+
+    struct Snapshot * self = new(Snapshot);
+    self->classes = malloc((after->count ? after->count : 1) * sizeof(*self->classes));
+    assert(self->classes);
+
+    for (size_t i = 0; i < after->count; i++)
+    {
+        const struct ClassStats * a = after->classes + i;
+        const struct ClassStats * b = stats_for(before, a->class);
+        struct ClassStats * stats = append(self, a->class);
+        if (!b)
+        {
+            *stats = *a;
+            continue;
+        }
+        stats->created = a->created - b->created;
+        stats->destroyed = a->destroyed - b->destroyed;
+        stats->live = a->live - b->live;
+        stats->bytes = a->bytes - b->bytes;
+        stats->ctor = a->ctor - b->ctor;
+        stats->dtor = a->dtor - b->dtor;
+        stats->differ = a->differ - b->differ;
+        stats->puto = a->puto - b->puto;
+        stats->draw = a->draw - b->draw;
+    }
+    return self;
+}
+
+size_t stats_classes(const void * _self)
+{
+    const struct Snapshot * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+const struct ClassStats * stats_at(const void * _self, size_t i)
+{
+    const struct Snapshot * self = _self;
+    assert(self && i < self->count);
+
+    return self->classes + i;
+}
+
+/**
+ * @brief The counters of one class.
+ *
+ * @return const struct ClassStats* the counters, or NULL if the class was never counted
+ */
+const struct ClassStats * stats_for(const void * _self, const void * class)
+{
+    const struct Snapshot * self = _self;
+    assert(self);
+
+    for (size_t i = 0; i < self->count; i++)
+        if (self->classes[i].class == class)
+            return self->classes + i;
+    return NULL;
+}
+
+/**
+ * @brief Print a snapshot as a table (STATS_TEXT) or as a JSON document (STATS_JSON).
+ *
+ * @return int the number of characters printed
+ */
+int stats_dump(const void * _self, FILE * file_ptr, enum StatsFormat format)
+{
+    const struct Snapshot * self = _self;
+    int total = 0;
+    assert(self && file_ptr);
+
+    if (format == STATS_TEXT)
+        total += fprintf(file_ptr, "%-16s %10s %10s %10s %12s %10s %10s %10s %10s %10s\n",
+            "class", "created", "destroyed", "live", "bytes", "ctor", "dtor", "differ", "puto", "draw");
+    else
+        total += fprintf(file_ptr, "{\"classes\": [");
+
+    for (size_t i = 0; i < self->count; i++)
+    {
+        const struct ClassStats * s = self->classes + i;
+        const char * name = ((const struct Class *) s->class)->name;
+
+        if (format == STATS_TEXT)
+            total += fprintf(file_ptr, "%-16s %10llu %10llu %10lld %12llu %10llu %10llu %10llu %10llu %10llu\n",
+                name, (unsigned long long) s->created, (unsigned long long) s->destroyed,
+                (long long) s->live, (unsigned long long) s->bytes, (unsigned long long) s->ctor,
+                (unsigned long long) s->dtor, (unsigned long long) s->differ,
+                (unsigned long long) s->puto, (unsigned long long) s->draw);
+        else
+            total += fprintf(file_ptr, "%s\n  {\"class\": \"%s\", \"created\": %llu, \"destroyed\": %llu, "
+                "\"live\": %lld, \"bytes\": %llu, \"ctor\": %llu, \"dtor\": %llu, \"differ\": %llu, "
+                "\"puto\": %llu, \"draw\": %llu}", i ? "," : "",
+                name, (unsigned long long) s->created, (unsigned long long) s->destroyed,
+                (long long) s->live, (unsigned long long) s->bytes, (unsigned long long) s->ctor,
+                (unsigned long long) s->dtor, (unsigned long long) s->differ,
+                (unsigned long long) s->puto, (unsigned long long) s->draw);
+    }
+
+    if (format == STATS_JSON)
+        total += fprintf(file_ptr, "\n]}\n");
+    return total;
+}
+
+/******************************************************************************
+ * SNAPSHOT CLASS METHODS
+*******************************************************************************/
+
+static void * Snapshot_dtor(void * _self)
+{
+    struct Snapshot * self = _self;
+
+    free(self->classes);
+
+    return super_dtor(Snapshot, self);
+}
+
+static int Snapshot_puto(const void * _self, FILE * file_ptr)
+{
+    return stats_dump(_self, file_ptr, STATS_TEXT);
+}
+
+static void * Snapshot_copy(const void * _self)
+{
+    const struct Snapshot * self = _self;
+    struct Snapshot * replica = super_copy(Snapshot, self);
+
+    replica->classes = malloc((self->count ? self->count : 1) * sizeof(*replica->classes));
+    assert(replica->classes);
+    memcpy(replica->classes, self->classes, self->count * sizeof(*replica->classes));
+
+    return replica;
+}
+
+/* The counters refer to class descriptors, which only mean something in the
+running program. Dump them with STATS_JSON to keep them. */
+static int Snapshot_serialize(const void * _self, struct Buffer * out)
+{
+    fprintf(stderr, "Snapshot: cannot serialize counters\n");
+
+    return -1;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Snapshot;
+
+static atomic_int snapshot_once;
+
+static void buildSnapshot(void)
+{
+    Snapshot = new(
+        Class,
+        "Snapshot",
+        Object,
+        sizeof(struct Snapshot),
+        dtor, Snapshot_dtor,
+        puto, Snapshot_puto,
+        copy, Snapshot_copy,
+        serialize, Snapshot_serialize,
+        NULL);
+}
+
+void initStats(void)
+{
+    class_once(&snapshot_once, buildSnapshot);
+}
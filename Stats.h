@@ -0,0 +1,59 @@
+#ifndef __STATS__H__SL
+#define __STATS__H__SL
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Object.h"
+
+/******************************************************************************
+ * STATISTICS
+ * A Snapshot holds the counters of every class that has been counted, added
+ * up over all threads, including those that have exited. Counting happens only
+ * in a build with OBJECT_STATS; otherwise snapshots are empty.
+ *
+ *   void * before = stats_snapshot();
+ *   ...
+ *   void * after = stats_snapshot();
+ *   void * delta = stats_diff(after, before);
+ *   stats_dump(delta, stderr, STATS_TEXT);
+ *
+ * Snapshots are objects: delete() them when done. puto() prints the text form.
+*******************************************************************************/
+
+struct ClassStats
+{
+    const void * class;
+    uint64_t created;       /* objects from allocate(): new(), copy(), loading */
+    uint64_t destroyed;     /* objects given back with deallocate(), by delete() */
+    int64_t live;           /* created - destroyed */
+    uint64_t bytes;         /* allocated for the created objects */
+    uint64_t ctor;          /* calls through each selector */
+    uint64_t dtor;
+    uint64_t differ;
+    uint64_t puto;
+    uint64_t draw;
+};
+
+enum StatsFormat
+{
+    STATS_TEXT,
+    STATS_JSON
+};
+
+extern const void * Snapshot;
+
+void * stats_snapshot(void);
+void * stats_diff(const void * after, const void * before);
+
+/* The classes in a snapshot, in order of creation */
+size_t stats_classes(const void * snapshot);
+const struct ClassStats * stats_at(const void * snapshot, size_t i);
+const struct ClassStats * stats_for(const void * snapshot, const void * class);
+
+int stats_dump(const void * snapshot, FILE * file_ptr, enum StatsFormat format);
+
+/* initStats is used to set up the class descriptor for Snapshot */
+void initStats(void);
+
+#endif  /* !__STATS__H__SL */
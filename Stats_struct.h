@@ -0,0 +1,18 @@
+#ifndef __STATS_STRUCT__H__SL
+#define __STATS_STRUCT__H__SL
+
+#include "Object_struct.h"
+#include "Stats.h"
+
+/******************************************************************************
+ * Snapshot structure
+*******************************************************************************/
+
+struct Snapshot
+{
+    const struct Object _;
+    size_t count;
+    struct ClassStats * classes;    /* ordered by class id */
+};
+
+#endif  /* !__STATS_STRUCT__H__SL */
@@ -0,0 +1,290 @@
+#include <assert.h>     /* for assert() */
+#include <string.h>     /* for memcpy(), memset(), strlen() */
+#include <stdlib.h>     /* for malloc(), realloc(), free() */
+
+#include "Vector.h"
+#include "Vector_struct.h"
+#include "Buffer.h"
+
+#define VECTOR_MIN_CAPACITY 8
+
+/******************************************************************************
+ * STORAGE
+*******************************************************************************/
+
+static void * element_at(const struct Vector * self, size_t i)
+{
+    return self->data + i * self->stride;
+}
+
+/**
+ * @brief Make room for capacity elements. The elements are moved bitwise, by
+ *        realloc(), so every address handed out before may change.
+ */
+void vector_reserve(void * _self, size_t capacity)
+{
+    struct Vector * self = _self;
+    assert(self);
+
+    if (capacity <= self->capacity)
+        return;
+    assert(capacity <= (size_t) -1 / self->stride);
+
+    unsigned char * data = realloc(self->data, capacity * self->stride);
+    void ** index = realloc(self->index, capacity * sizeof(*index));
+    assert(data && index);
+
+    if (data != self->data)
+        self->indexed = 0;
+    self->data = data;
+    self->index = index;
+    self->capacity = capacity;
+}
+
+void * vector_allocate(void * _self)
+{
+    struct Vector * self = _self;
+    assert(self);
+
+    if (self->count == self->capacity)
+        vector_reserve(self, self->capacity ? 2 * self->capacity : VECTOR_MIN_CAPACITY);
+
+    struct Object * element = memset(element_at(self, self->count++), 0, self->stride);
+    element->class = self->element;
+
+    return element;
+}
+
+void * vector_append(void * _self, ...)
+{
+    void * element = vector_allocate(_self);
+
+    va_list arg_list;
+    va_start(arg_list, _self);
+    element = ctor(element, &arg_list);
+    va_end(arg_list);
+
+    return element;
+}
+
+/******************************************************************************
+ * ELEMENTS
+*******************************************************************************/
+
+size_t vector_count(const void * _self)
+{
+    const struct Vector * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+void * vector_at(const void * _self, size_t i)
+{
+    const struct Vector * self = _self;
+    assert(self && i < self->count);
+
+    return element_at(self, i);
+}
+
+void vector_pop(void * _self)
+{
+    struct Vector * self = _self;
+    assert(self && self->count);
+
+    dtor(element_at(self, --self->count));
+    if (self->indexed > self->count)
+        self->indexed = self->count;
+}
+
+void vector_clear(void * _self)
+{
+    struct Vector * self = _self;
+    assert(self);
+
+    for (size_t i = 0; i < self->count; i++)
+        dtor(element_at(self, i));
+    self->count = 0;
+    self->indexed = 0;
+}
+
+void * const * vector_objects(void * _self)
+{
+    struct Vector * self = _self;
+    assert(self);
+
+    for (; self->indexed < self->count; self->indexed++)
+        self->index[self->indexed] = element_at(self, self->indexed);
+
+    return self->index;
+}
+
+/******************************************************************************
+ * VECTOR CLASS METHODS
+*******************************************************************************/
+
+static void * Vector_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct Vector * self = super_ctor(Vector, _self, arglist_ptr);
+
+    self->element = va_arg(*arglist_ptr, const struct Class *);
+    assert(self->element && self->element->size >= sizeof(struct Object));
+    self->stride = self->element->size;
+    vector_reserve(self, va_arg(*arglist_ptr, size_t));
+
+    return self;
+}
+
+static void * Vector_dtor(void * _self)
+{
+    struct Vector * self = _self;
+
+    vector_clear(self);
+    free(self->data);
+    free(self->index);
+
+    return super_dtor(Vector, self);
+}
+
+/* The elements live in the vector's memory rather than being objects of their
+own, so each one is traced in turn; leaves report nothing */
+static void Vector_trace(const void * _self, struct Tracer * tracer)
+{
+    const struct Vector * self = _self;
+
+    if (self->element->trace == ((const struct Class *) Object)->trace)
+        return;
+    for (size_t i = 0; i < self->count; i++)
+        trace(element_at(self, i), tracer);
+}
+
+static int Vector_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Vector * self = _self;
+
+    int n = buffer_print(out, "Vector of ");
+    n += buffer_print_unsigned(out, self->count);
+    n += buffer_print(out, " ");
+    n += buffer_print(out, self->element->name);
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, _self);
+    return n + buffer_print(out, "\n");
+}
+
+/* Each element is copied with copy() and the copy moved into the new storage,
+ * which leaves the copy's own memory empty to be given back with deallocate(). */
+static void * Vector_copy(const void * _self)
+{
+    const struct Vector * self = _self;
+    struct Vector * replica = super_copy(Vector, self);
+
+    replica->count = replica->capacity = replica->indexed = 0;
+    replica->data = NULL;
+    replica->index = NULL;
+    vector_reserve(replica, self->count);
+
+    for (size_t i = 0; i < self->count; i++)
+    {
+        void * element = copy(element_at(self, i));
+        if (!element)
+        {
+            Vector_dtor(replica);
+            deallocate(replica);
+            return NULL;
+        }
+        memcpy(element_at(replica, replica->count++), element, replica->stride);
+        deallocate(element);
+    }
+    return replica;
+}
+
+/* The element class is written by name, like in an archive's class table,
+ * followed by the count and the fields of each element. An element that writes
+ * nothing is written as a zero byte, so that every element takes at least one
+ * and a count the input cannot hold is refused before anything is allocated. */
+static int Vector_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Vector * self = _self;
+    size_t length = strlen(self->element->name);
+    assert(length <= UINT16_MAX);
+
+    if (super_serialize(Vector, self, out))
+        return -1;
+    buffer_put_u16(out, (uint16_t) length);
+    buffer_put(out, self->element->name, length);
+    buffer_put_u64(out, self->count);
+    for (size_t i = 0; i < self->count; i++)
+    {
+        size_t start = out->length;
+        if (serialize(element_at(self, i), out))
+            return -1;
+        if (out->length == start)
+            buffer_put(out, "", 1);
+    }
+
+    return 0;
+}
+
+static void * Vector_deserialize(void * _self, struct Reader * in)
+{
+    struct Vector * self = super_deserialize(Vector, _self, in);
+    uint64_t count;
+
+    if (!self || !(self->element = class_read(in, "vector")) || reader_get_u64(in, &count)
+        || count > (uint64_t) (in->end - in->cursor))
+        return NULL;
+    self->stride = self->element->size;
+
+    /* the elements may be containers themselves */
+    if (reader_enter(in))
+        return NULL;
+
+    vector_reserve(self, count);
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const unsigned char * start = in->cursor;
+        unsigned char empty;
+
+        /* a failed deserialize() cleans up after itself */
+        if (!deserialize(vector_allocate(self), in))
+            self->count--;
+        else if (in->cursor != start || (!reader_get(in, &empty, 1) && !empty))
+            continue;
+
+        reader_leave(in);
+        Vector_dtor(self);
+        return NULL;
+    }
+    reader_leave(in);
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Vector;
+
+static atomic_int vector_once;
+
+static void buildVector(void)
+{
+    Vector = new(
+        Class,
+        "Vector",
+        Object,
+        sizeof(struct Vector),
+        ctor, Vector_ctor,
+        dtor, Vector_dtor,
+        sputo, Vector_sputo,
+        copy, Vector_copy,
+        serialize, Vector_serialize,
+        deserialize, Vector_deserialize,
+        trace, Vector_trace,
+        NULL);
+}
+
+void initVector(void)
+{
+    class_once(&vector_once, buildVector);
+}
@@ -0,0 +1,46 @@
+#ifndef __VECTOR__H__SL
+#define __VECTOR__H__SL
+
+#include "Object.h"
+
+/******************************************************************************
+ * VECTOR
+ * new(Vector, class, (size_t) capacity) creates an empty vector of objects of
+ * exactly that class, stored by value one after the other, size_of() bytes
+ * apart. Each element is a complete object with its class pointer, so every
+ * selector works on vector_at(vector, i), but it belongs to the vector: it is
+ * never delete()d on its own, and with OBJECT_REFCOUNT it has no reference
+ * count, like an object made with init().
+ *
+ * When the vector grows its elements are moved with memcpy(). An element must
+ * not hold pointers into itself or be pointed to from elsewhere across a growth;
+ * vector_reserve() up front keeps them in place.
+*******************************************************************************/
+
+extern const void * Vector;
+
+size_t vector_count(const void * vector);
+void * vector_at(const void * vector, size_t i);
+
+/* Construct a new element at the end: the arguments go to the class's ctor */
+void * vector_append(void * vector, ...);
+
+/* A new element at the end that is zeroed and has its class set, with no ctor
+run, for the typed initializers such as Point_init() */
+void * vector_allocate(void * vector);
+
+/* Destroy the last element, or all of them */
+void vector_pop(void * vector);
+void vector_clear(void * vector);
+
+void vector_reserve(void * vector, size_t capacity);
+
+/* The addresses of the elements, for the batch selectors:
+       puto_all(vector_objects(vector), vector_count(vector), stdout);
+The array stays valid until the vector grows or is deleted. */
+void * const * vector_objects(void * vector);
+
+/* initVector is used to set up the class descriptor for Vector */
+void initVector(void);
+
+#endif  /* !__VECTOR__H__SL */
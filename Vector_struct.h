@@ -0,0 +1,24 @@
+#ifndef __VECTOR_STRUCT__H__SL
+#define __VECTOR_STRUCT__H__SL
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * Vector structure
+*******************************************************************************/
+/* Element i starts at data + i * stride. index, the array vector_objects()
+hands out, has room for capacity addresses, of which the first indexed are
+filled in; it is refilled after the data moves. */
+struct Vector
+{
+    const struct Object _;
+    const struct Class * element;
+    size_t stride;
+    size_t count;
+    size_t capacity;
+    unsigned char * data;
+    void ** index;
+    size_t indexed;
+};
+
+#endif  /* !__VECTOR_STRUCT__H__SL */
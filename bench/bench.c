@@ -0,0 +1,449 @@
+/* Micro-benchmarks for the object runtime. Build the bench target with
+ * -DCMAKE_BUILD_TYPE=Release (and any of the OBJECT_* options to compare them).
+ *
+ * Usage: bench [options]
+ *   --format csv|json   output format, csv by default
+ *   --output FILE       write the results to FILE instead of stdout
+ *   --filter TEXT       only run the cases whose name contains TEXT
+ *   --threads N         run every case on N threads at once
+ *   --pin CPU           pin thread t to core CPU + t
+ *   --repetitions N     timed repetitions per case, the median is reported (5)
+ *   --scale F           multiply the iteration count of every case by F
+ *   --baseline FILE     compare with the csv output of an earlier run
+ *   --list              print the names of the cases and exit
+ *
+ * The cases use fixed inputs and iteration counts, so results only differ by
+ * noise between runs on the same machine and build. Whatever the cases print
+ * goes to the null device.
+ */
+#define _GNU_SOURCE  /* for clock_gettime() and pthread_setaffinity_np() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "bench.h"
+
+#define MAX_REPETITIONS 100
+
+/* what the cases computed, kept so that the compiler cannot drop the work */
+static volatile size_t sink;
+
+static const struct BenchCase * const suites[] = {
+    runtime_cases, hash_cases, grid_cases, render_cases, parallel_cases, handle_cases,
+    group_cases, gc_cases, geometry_cases
+};
+
+struct BenchGroup
+{
+    int threads;
+    atomic_int ready;
+};
+
+struct Options
+{
+    int json;
+    FILE * output;
+    const char * filter;
+    int threads;
+    int pin;            /* first core, or -1 */
+    int repetitions;
+    double scale;
+};
+
+struct Result
+{
+    double ns_per_op;
+    double min_ns_per_op;
+    double max_ns_per_op;
+    double mops;        /* million operations per second over all threads */
+    double mb_per_sec;
+};
+
+/******************************************************************************
+ * TIMING
+*******************************************************************************/
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void bench_start(struct BenchRun * run)
+{
+    struct BenchGroup * group = run->group;
+
+    atomic_fetch_add(&group->ready, 1);
+    while (atomic_load(&group->ready) < group->threads)
+        sched_yield();
+    run->start = now();
+}
+
+void bench_stop(struct BenchRun * run)
+{
+    run->stop = now();
+}
+
+static void pin(int cpu)
+{
+    if (cpu < 0)
+        return;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+        fprintf(stderr, "bench: cannot pin to core %d\n", cpu);
+#elif defined(_WIN32)
+    if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu))
+        fprintf(stderr, "bench: cannot pin to core %d\n", cpu);
+#else
+    fprintf(stderr, "bench: pinning is not supported here\n");
+#endif
+}
+
+struct Worker
+{
+    pthread_t thread;
+    const struct BenchCase * bench;
+    struct BenchRun run;
+    int cpu;
+};
+
+static void * work(void * _worker)
+{
+    struct Worker * worker = _worker;
+
+    pin(worker->cpu);
+    worker->bench->run(&worker->run);
+    return NULL;
+}
+
+/**
+ * @brief Run a case once on every thread. Returns the mean time per operation of
+ *        the threads and stores the throughput of the whole group.
+ */
+static double repeat(const struct BenchCase * bench, long iterations, const struct Options * options,
+    struct Worker * workers, double * mops, double * mb_per_sec)
+{
+    struct BenchGroup group = { options->threads, 0 };
+
+    for (int t = 0; t < options->threads; t++)
+    {
+        struct Worker * worker = workers + t;
+        worker->bench = bench;
+        worker->run = (struct BenchRun) { iterations, t, 0, 0, 0, 0, &group };
+        worker->cpu = options->pin < 0 ? -1 : options->pin + t;
+    }
+    /* the first thread is the calling one, which was pinned once at start-up */
+    for (int t = 1; t < options->threads; t++)
+        if (pthread_create(&workers[t].thread, NULL, work, workers + t))
+        {
+            fprintf(stderr, "bench: cannot start thread %d\n", t);
+            exit(1);
+        }
+    bench->run(&workers[0].run);
+    for (int t = 1; t < options->threads; t++)
+        pthread_join(workers[t].thread, NULL);
+
+    double sum = 0, first = workers[0].run.start, last = workers[0].run.stop;
+    size_t bytes = 0;
+    for (int t = 0; t < options->threads; t++)
+    {
+        const struct BenchRun * run = &workers[t].run;
+        sum += (run->stop - run->start) * 1e9 / iterations;
+        first = run->start < first ? run->start : first;
+        last = run->stop > last ? run->stop : last;
+        bytes += run->bytes;
+        sink += run->sink;
+    }
+    *mops = options->threads * (double) iterations / (last - first) * 1e-6;
+    *mb_per_sec = bytes / (last - first) * 1e-6;
+
+    return sum / options->threads;
+}
+
+static int ascending(const void * a, const void * b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+static double median(double * values, int n)
+{
+    qsort(values, n, sizeof(*values), ascending);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static void measure(const struct BenchCase * bench, long iterations, const struct Options * options,
+    struct Result * result)
+{
+    struct Worker * workers = malloc(options->threads * sizeof(*workers));
+    double ns[MAX_REPETITIONS], mops[MAX_REPETITIONS], mb[MAX_REPETITIONS];
+
+    /* warm up the caches, the pool and the branch predictors */
+    repeat(bench, iterations / 10 + 1, options, workers, mops, mb);
+    for (int r = 0; r < options->repetitions; r++)
+        ns[r] = repeat(bench, iterations, options, workers, mops + r, mb + r);
+
+    result->mops = median(mops, options->repetitions);
+    result->mb_per_sec = median(mb, options->repetitions);
+    result->ns_per_op = median(ns, options->repetitions);
+    result->min_ns_per_op = ns[0];
+    result->max_ns_per_op = ns[options->repetitions - 1];
+
+    free(workers);
+}
+
+/******************************************************************************
+ * BASELINE
+ * A baseline is the csv output of an earlier run; only the name, threads and
+ * ns_per_op columns are used.
+*******************************************************************************/
+
+struct Baseline
+{
+    char name[64];
+    int threads;
+    double ns_per_op;
+};
+
+static struct Baseline * baseline;
+static size_t baseline_count;
+
+static void read_baseline(const char * path)
+{
+    FILE * file = fopen(path, "r");
+    char line[512];
+    size_t capacity = 0;
+
+    if (!file)
+    {
+        fprintf(stderr, "bench: cannot read baseline %s\n", path);
+        exit(2);
+    }
+    while (fgets(line, sizeof(line), file))
+    {
+        struct Baseline entry;
+        long iterations;
+        if (sscanf(line, "%63[^,],%d,%ld,%lf", entry.name, &entry.threads, &iterations,
+            &entry.ns_per_op) != 4)
+            continue;   /* the header */
+        if (baseline_count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            baseline = realloc(baseline, capacity * sizeof(*baseline));
+            if (!baseline)
+                exit(1);
+        }
+        baseline[baseline_count++] = entry;
+    }
+    fclose(file);
+}
+
+static const struct Baseline * baseline_of(const char * name, int threads)
+{
+    for (size_t i = 0; i < baseline_count; i++)
+        if (baseline[i].threads == threads && strcmp(baseline[i].name, name) == 0)
+            return baseline + i;
+    return NULL;
+}
+
+/******************************************************************************
+ * OUTPUT
+*******************************************************************************/
+
+static void begin_output(const struct Options * options)
+{
+    FILE * out = options->output;
+
+    if (!options->json)
+    {
+        fprintf(out, "name,threads,iterations,ns_per_op,min_ns_per_op,max_ns_per_op,mops,mb_per_sec");
+        fprintf(out, baseline ? ",baseline_ns_per_op,change_percent\n" : "\n");
+        return;
+    }
+
+    fprintf(out, "{\n  \"config\": {\"threads\": %d, \"pin\": %d, \"repetitions\": %d, \"scale\": %g",
+        options->threads, options->pin, options->repetitions, options->scale);
+    static const struct { const char * name; int on; } switches[] = {
+        { "fast_dispatch",
+#ifdef OBJECT_FAST_DISPATCH
+            1 },
+#else
+            0 },
+#endif
+        { "refcount",
+#ifdef OBJECT_REFCOUNT
+            1 },
+#else
+            0 },
+#endif
+        { "gc",
+#ifdef OBJECT_GC
+            1 },
+#else
+            0 },
+#endif
+        { "pool_thread_cache",
+#ifdef OBJECT_POOL_THREAD_CACHE
+            1 },
+#else
+            0 },
+#endif
+        { "pool_disable",
+#ifdef OBJECT_POOL_DISABLE
+            1 },
+#else
+            0 },
+#endif
+        { "stats",
+#ifdef OBJECT_STATS
+            1 },
+#else
+            0 },
+#endif
+    };
+    for (size_t i = 0; i < sizeof(switches) / sizeof(switches[0]); i++)
+        fprintf(out, ", \"%s\": %s", switches[i].name, switches[i].on ? "true" : "false");
+#ifdef __VERSION__
+    fprintf(out, ", \"compiler\": \"%s\"", __VERSION__);
+#endif
+    fprintf(out, "},\n  \"results\": [");
+}
+
+static void output(const struct Options * options, const char * name, long iterations,
+    const struct Result * result, int first)
+{
+    FILE * out = options->output;
+    const struct Baseline * base = baseline_of(name, options->threads);
+    double change = base ? (result->ns_per_op / base->ns_per_op - 1) * 100 : 0;
+
+    if (!options->json)
+    {
+        fprintf(out, "%s,%d,%ld,%.3f,%.3f,%.3f,%.3f,%.3f", name, options->threads, iterations,
+            result->ns_per_op, result->min_ns_per_op, result->max_ns_per_op, result->mops,
+            result->mb_per_sec);
+        if (base)
+            fprintf(out, ",%.3f,%.1f\n", base->ns_per_op, change);
+        else
+            fprintf(out, baseline ? ",,\n" : "\n");
+        return;
+    }
+
+    fprintf(out, "%s\n    {\"name\": \"%s\", \"threads\": %d, \"iterations\": %ld, "
+        "\"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f, "
+        "\"mops\": %.3f, \"mb_per_sec\": %.3f", first ? "" : ",", name, options->threads,
+        iterations, result->ns_per_op, result->min_ns_per_op, result->max_ns_per_op,
+        result->mops, result->mb_per_sec);
+    if (base)
+        fprintf(out, ", \"baseline_ns_per_op\": %.3f, \"change_percent\": %.1f", base->ns_per_op, change);
+    fprintf(out, "}");
+}
+
+static void end_output(const struct Options * options)
+{
+    if (options->json)
+        fprintf(options->output, "\n  ]\n}\n");
+    fflush(options->output);
+}
+
+/******************************************************************************
+ * MAIN
+*******************************************************************************/
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: bench [--format csv|json] [--output FILE] [--filter TEXT] [--threads N]\n"
+        "             [--pin CPU] [--repetitions N] [--scale F] [--baseline FILE] [--list]\n");
+    exit(2);
+}
+
+int main(int argc, char ** argv)
+{
+    struct Options options = { 0, NULL, "", 1, -1, 5, 1.0 };
+    const char * output_path = NULL;
+    int list = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char * arg = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--list") == 0)
+        {
+            list = 1;
+            continue;
+        }
+        if (!value)
+            usage();
+        i++;
+        if (strcmp(arg, "--format") == 0 && (!strcmp(value, "csv") || !strcmp(value, "json")))
+            options.json = !strcmp(value, "json");
+        else if (strcmp(arg, "--output") == 0)
+            output_path = value;
+        else if (strcmp(arg, "--filter") == 0)
+            options.filter = value;
+        else if (strcmp(arg, "--threads") == 0 && atoi(value) > 0)
+            options.threads = atoi(value);
+        else if (strcmp(arg, "--pin") == 0 && atoi(value) >= 0)
+            options.pin = atoi(value);
+        else if (strcmp(arg, "--repetitions") == 0 && atoi(value) > 0 && atoi(value) <= MAX_REPETITIONS)
+            options.repetitions = atoi(value);
+        else if (strcmp(arg, "--scale") == 0 && atof(value) > 0)
+            options.scale = atof(value);
+        else if (strcmp(arg, "--baseline") == 0)
+            read_baseline(value);
+        else
+            usage();
+    }
+
+    if (list)
+    {
+        for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++)
+            for (const struct BenchCase * bench = suites[s]; bench->name; bench++)
+                printf("%s\n", bench->name);
+        return 0;
+    }
+
+    /* keep the results and send whatever the cases print to the null device */
+    options.output = output_path ? fopen(output_path, "w") : fdopen(dup(fileno(stdout)), "w");
+    if (!options.output || !freopen(NULL_DEVICE, "w", stdout))
+    {
+        fprintf(stderr, "bench: cannot open the output\n");
+        return 1;
+    }
+
+    pin(options.pin);
+    begin_output(&options);
+    int first = 1;
+    for (size_t s = 0; s < sizeof(suites) / sizeof(suites[0]); s++)
+        for (const struct BenchCase * bench = suites[s]; bench->name; bench++)
+        {
+            if (!strstr(bench->name, options.filter))
+                continue;
+
+            long iterations = (long) (bench->iterations * options.scale);
+            struct Result result;
+            measure(bench, iterations > 0 ? iterations : 1, &options, &result);
+            output(&options, bench->name, iterations > 0 ? iterations : 1, &result, first);
+            first = 0;
+        }
+    end_output(&options);
+
+    fclose(options.output);
+    free(baseline);
+    return 0;
+}
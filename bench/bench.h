@@ -0,0 +1,53 @@
+#ifndef __BENCH__H__SL
+#define __BENCH__H__SL
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/******************************************************************************
+ * BENCHMARK CASES
+ * A case is a function that does its setup, calls bench_start(), performs
+ * run->iterations operations, calls bench_stop() and cleans up. With --threads
+ * the driver calls it on every thread at once, so a case keeps its state on its
+ * own stack or heap. bench_start() also lines the threads up, so the timed parts
+ * overlap.
+*******************************************************************************/
+
+struct BenchRun
+{
+    long iterations;    /* operations to perform */
+    int thread;         /* 0 .. threads - 1 */
+    size_t bytes;       /* a case that produces output adds its size here */
+    size_t sink;        /* and the results it computes here, so that they count */
+    double start;       /* filled in by bench_start() and bench_stop() */
+    double stop;
+    struct BenchGroup * group;
+};
+
+struct BenchCase
+{
+    const char * name;
+    void (*run)(struct BenchRun * run);
+    long iterations;    /* default count, multiplied by --scale */
+};
+
+void bench_start(struct BenchRun * run);
+void bench_stop(struct BenchRun * run);
+
+/* The case tables end with an entry whose name is NULL */
+extern const struct BenchCase runtime_cases[];
+extern const struct BenchCase hash_cases[];
+extern const struct BenchCase grid_cases[];
+extern const struct BenchCase render_cases[];
+extern const struct BenchCase parallel_cases[];
+extern const struct BenchCase handle_cases[];
+extern const struct BenchCase group_cases[];
+extern const struct BenchCase gc_cases[];
+extern const struct BenchCase geometry_cases[];
+
+#endif  /* !__BENCH__H__SL */
@@ -0,0 +1,106 @@
+/* Cases for the collector of an OBJECT_GC build: tearing down scenes of groups
+ * of circles with delete() and with a collection, and a collection that finds
+ * them all still in use. Each operation is one object reclaimed or marked. The
+ * collector takes everything unreachable in the process, so with --threads only
+ * the first thread builds and collects; the others just line up. Without
+ * OBJECT_GC there are no cases. */
+#include <stdlib.h>
+
+#include "bench.h"
+
+#ifdef OBJECT_GC
+
+#include "Circle.h"
+#include "Group.h"
+#include "Collector.h"
+
+#define GROUPS      64
+#define CHILDREN    1023    /* a group and its children are 1024 objects */
+#define SCENE       (GROUPS * (CHILDREN + 1))
+
+static void * make_scene(void)
+{
+    void * scene = new(Group, 0, 0);
+
+    for (int g = 0; g < GROUPS; g++)
+    {
+        void * group = new(Group, g, g);
+        for (int c = 0; c < CHILDREN; c++)
+            group_add(group, new(Circle, c, g, 1 + c % 8));
+        group_add(scene, group);
+    }
+    return scene;
+}
+
+/* Build enough scenes for the iterations into a group that holds them all */
+static void * make_world(struct BenchRun * run)
+{
+    initCircle();
+    initGroup();
+
+    void * world = new(Group, 0, 0);
+    for (long done = 0; done < run->iterations; done += SCENE)
+        group_add(world, make_scene());
+    return world;
+}
+
+static void teardown_delete(struct BenchRun * run)
+{
+    void * world = run->thread ? NULL : make_world(run);
+
+    bench_start(run);
+    delete(world);
+    bench_stop(run);
+}
+
+static void teardown_collect(struct BenchRun * run)
+{
+    if (!run->thread)
+    {
+        gc_collect();   /* the garbage earlier cases left, if any */
+        make_world(run);
+    }
+
+    bench_start(run);
+    if (!run->thread)
+        run->sink += gc_collect();
+    bench_stop(run);
+}
+
+static void mark_live(struct BenchRun * run)
+{
+    void * world = NULL;
+
+    if (!run->thread)
+    {
+        gc_root(&world);
+        world = make_world(run);
+        gc_collect();
+    }
+
+    bench_start(run);
+    if (!run->thread)
+        run->sink += gc_collect();
+    bench_stop(run);
+
+    if (!run->thread)
+    {
+        gc_unroot(&world);
+        gc_collect();
+    }
+}
+
+const struct BenchCase gc_cases[] = {
+    { "gc/teardown/delete", teardown_delete, 1 << 20 },
+    { "gc/teardown/collect", teardown_collect, 1 << 20 },
+    { "gc/mark/live", mark_live, 1 << 20 },
+    { NULL }
+};
+
+#else
+
+const struct BenchCase gc_cases[] = {
+    { NULL }
+};
+
+#endif  /* OBJECT_GC */
@@ -0,0 +1,126 @@
+/* Cases for the batch geometry kernels: overlap tests between PAIRS pairs of
+ * circles, done one pair at a time on Circle objects as user code would, and by
+ * circles_overlap() at each instruction set level. Each operation is one pair.
+ * A level the processor does not have runs the best one it has. */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "PointArray.h"
+#include "Geometry.h"
+
+#define PAIRS   4096
+
+static int coordinate(size_t i, unsigned salt)
+{
+    return (int) ((i * 2654435761u ^ salt) % 2000) - 1000;
+}
+
+static void make_arrays(void ** a, void ** b)
+{
+    struct PointView view;
+
+    initPointArray();
+    *a = new(CircleArray, (size_t) PAIRS);
+    *b = new(CircleArray, (size_t) PAIRS);
+    for (size_t i = 0; i < PAIRS; i++)
+    {
+        points_append(*a, Circle_init(&view, coordinate(i, 1), coordinate(i, 2), 1 + (int) i % 50));
+        points_append(*b, Circle_init(&view, coordinate(i, 3), coordinate(i, 4), 1 + (int) i % 70));
+    }
+}
+
+static void overlap_objects(struct BenchRun * run)
+{
+    void ** a = malloc(PAIRS * sizeof(void *)), ** b = malloc(PAIRS * sizeof(void *));
+
+    initCircle();
+    for (size_t i = 0; i < PAIRS; i++)
+    {
+        a[i] = new(Circle, coordinate(i, 1), coordinate(i, 2), 1 + (int) i % 50);
+        b[i] = new(Circle, coordinate(i, 3), coordinate(i, 4), 1 + (int) i % 70);
+    }
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += PAIRS)
+        for (size_t i = 0; i < PAIRS; i++)
+        {
+            long long dx = (long long) x(a[i]) - x(b[i]);
+            long long dy = (long long) y(a[i]) - y(b[i]);
+            long long reach = (long long) radius(a[i]) + radius(b[i]);
+            run->sink += dx * dx + dy * dy <= reach * reach;
+        }
+    bench_stop(run);
+
+    for (size_t i = 0; i < PAIRS; i++)
+    {
+        delete(a[i]);
+        delete(b[i]);
+    }
+    free(a);
+    free(b);
+}
+
+static void overlap(struct BenchRun * run, int level)
+{
+    void * a, * b;
+    uint64_t mask[PAIRS / 64];
+
+    make_arrays(&a, &b);
+    geometry_set_level(level);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += PAIRS)
+        run->sink += circles_overlap(a, b, mask);
+    bench_stop(run);
+
+    geometry_set_level(GEOMETRY_AVX2);
+    delete(a);
+    delete(b);
+}
+
+static void overlap_scalar(struct BenchRun * run)
+{
+    overlap(run, GEOMETRY_SCALAR);
+}
+
+static void overlap_sse2(struct BenchRun * run)
+{
+    overlap(run, GEOMETRY_SSE2);
+}
+
+static void overlap_avx2(struct BenchRun * run)
+{
+    overlap(run, GEOMETRY_AVX2);
+}
+
+static void distance2(struct BenchRun * run)
+{
+    void * a, * b;
+    uint64_t * distances = malloc(PAIRS * sizeof(uint64_t));
+
+    make_arrays(&a, &b);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += PAIRS)
+    {
+        points_distance2(a, b, distances);
+        run->sink += distances[done / PAIRS % PAIRS];
+    }
+    bench_stop(run);
+
+    free(distances);
+    delete(a);
+    delete(b);
+}
+
+const struct BenchCase geometry_cases[] = {
+    { "geometry/overlap/objects", overlap_objects, 100000000 },
+    { "geometry/overlap/scalar", overlap_scalar, 100000000 },
+    { "geometry/overlap/sse2", overlap_sse2, 100000000 },
+    { "geometry/overlap/avx2", overlap_avx2, 100000000 },
+    { "geometry/distance2", distance2, 100000000 },
+    { NULL }
+};
@@ -0,0 +1,214 @@
+/* Cases for the spatial Grid against the brute-force loops it replaces. The
+ * input is a fixed mix of Points and Circles spread over a square that grows
+ * with the number of objects, so the density stays the same. Each operation is
+ * one query, or one object filed for the build. */
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "Grid.h"
+
+#define INPUT   65536   /* objects in the input */
+#define SIDE    8192    /* coordinates are drawn from 0 .. SIDE - 1 */
+#define RADIUS  16      /* circles have radius 1 .. RADIUS */
+
+static void ** make_input(void)
+{
+    void ** objects = malloc(INPUT * sizeof(*objects));
+    /* a private generator, so that every thread and every run sees the same input */
+    unsigned seed = 1;
+
+    initGrid();
+    for (size_t i = 0; i < INPUT; i++)
+    {
+        int values[3];
+        for (int v = 0; v < 3; v++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[v] = (seed >> 8) % SIDE;
+        }
+        objects[i] = i % 2 ? new(Point, values[0], values[1])
+            : new(Circle, values[0], values[1], 1 + values[2] % RADIUS);
+    }
+    return objects;
+}
+
+static void delete_input(void ** objects)
+{
+    for (size_t i = 0; i < INPUT; i++)
+        delete(objects[i]);
+    free(objects);
+}
+
+static int radius_of(const void * object)
+{
+    return is_of(object, Circle) ? radius(object) : 0;
+}
+
+/******************************************************************************
+ * BUILDING
+*******************************************************************************/
+
+static void grid_build_all(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * grid = new(Grid, 0);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += INPUT)
+        grid_build(grid, objects, run->iterations - done < INPUT ? run->iterations - done : INPUT);
+    bench_stop(run);
+    run->sink += grid_count(grid);
+
+    delete(grid);
+    delete_input(objects);
+}
+
+static void grid_insert_each(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * grid = NULL;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        if (i % INPUT == 0)
+        {
+            delete(grid);
+            grid = new(Grid, 32);
+        }
+        grid_insert(grid, objects[i % INPUT]);
+    }
+    bench_stop(run);
+    run->sink += grid_count(grid);
+
+    delete(grid);
+    delete_input(objects);
+}
+
+/******************************************************************************
+ * QUERIES
+ * The linear cases read x(), y() and radius() of every object for every query.
+*******************************************************************************/
+
+static void nearest_linear(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    size_t sum = 0;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        const void * query = objects[i % INPUT];
+        long long best = -1;
+        size_t found = 0;
+        for (size_t j = 0; j < INPUT; j++)
+        {
+            long long dx = x(objects[j]) - x(query), dy = y(objects[j]) - y(query);
+            if (objects[j] != query && (best < 0 || dx * dx + dy * dy < best))
+            {
+                best = dx * dx + dy * dy;
+                found = j;
+            }
+        }
+        sum += found;
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    delete_input(objects);
+}
+
+static void nearest_grid(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * grid = new(Grid, 0);
+    size_t sum = 0;
+
+    grid_build(grid, objects, INPUT);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        const void * query = objects[i % INPUT];
+        sum += (size_t) grid_nearest(grid, x(query), y(query));
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    delete(grid);
+    delete_input(objects);
+}
+
+static void overlap_linear(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    size_t sum = 0;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        const void * query = objects[i % INPUT];
+        for (size_t j = 0; j < INPUT; j++)
+        {
+            long long dx = x(objects[j]) - x(query), dy = y(objects[j]) - y(query);
+            long long reach = radius_of(objects[j]) + radius_of(query);
+            sum += objects[j] != query && dx * dx + dy * dy <= reach * reach;
+        }
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    delete_input(objects);
+}
+
+static void overlap_grid(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * grid = new(Grid, 0);
+    size_t sum = 0;
+
+    grid_build(grid, objects, INPUT);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += grid_overlaps(grid, objects[i % INPUT], NULL, 0);
+    bench_stop(run);
+    run->sink += sum;
+
+    delete(grid);
+    delete_input(objects);
+}
+
+static void overlap_batch(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * grid = new(Grid, 0);
+    size_t * counts = malloc(INPUT * sizeof(*counts));
+    size_t sum = 0;
+
+    grid_build(grid, objects, INPUT);
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += INPUT)
+    {
+        size_t n = run->iterations - done < INPUT ? run->iterations - done : INPUT;
+        grid_overlap_counts(grid, objects, n, counts);
+        sum += counts[n - 1];
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    free(counts);
+    delete(grid);
+    delete_input(objects);
+}
+
+const struct BenchCase grid_cases[] = {
+    { "grid/build", grid_build_all, 1000000 },
+    { "grid/insert", grid_insert_each, 1000000 },
+    { "grid/nearest/linear", nearest_linear, 1000 },
+    { "grid/nearest/grid", nearest_grid, 1000000 },
+    { "grid/overlap/linear", overlap_linear, 1000 },
+    { "grid/overlap/grid", overlap_grid, 1000000 },
+    { "grid/overlap/batch", overlap_batch, 1000000 },
+    { NULL }
+};
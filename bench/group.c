@@ -0,0 +1,97 @@
+/* Cases for Group: what the cached bounding box saves. A tree of GROUPS groups
+ * of LEAVES Circles each is asked for its bounds after one leaf has moved, and
+ * after a leaf in every group has moved. A leaf on the edge of its group's box
+ * that moves in makes the group and the root go over their children again; any
+ * other move only updates the boxes. Each operation is one group_bounds() on the
+ * root.
+ * Moving the whole tree is one move() on the root, against one per leaf. */
+#include "bench.h"
+#include "Group.h"
+#include "Circle.h"
+
+#define GROUPS  64
+#define LEAVES  256
+
+static void * make_tree(void)
+{
+    initGroup();
+
+    void * root = new(Group, 0, 0);
+    for (int g = 0; g < GROUPS; g++)
+    {
+        void * group = new(Group, g * 10, 0);
+        for (int i = 0; i < LEAVES; i++)
+            group_add(group, new(Circle, i, g, 1 + i % 7));
+        group_add(root, group);
+    }
+    return root;
+}
+
+static void bounds(struct BenchRun * run, int groups_moved)
+{
+    void * root = make_tree();
+    struct Bounds box;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        int step = i & 1 ? -1 : 1;
+        for (int g = 0; g < groups_moved; g++)
+            move(group_child(group_child(root, (size_t) g), (size_t) i % LEAVES), step, step);
+        group_bounds(root, &box);
+        run->sink += (size_t) box.x1;
+    }
+    bench_stop(run);
+
+    delete(root);
+}
+
+static void bounds_clean(struct BenchRun * run)
+{
+    bounds(run, 0);
+}
+
+static void bounds_one_moved(struct BenchRun * run)
+{
+    bounds(run, 1);
+}
+
+static void bounds_all_moved(struct BenchRun * run)
+{
+    bounds(run, GROUPS);
+}
+
+static void move_tree(struct BenchRun * run)
+{
+    void * root = make_tree();
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        move(root, 1, 1);
+    bench_stop(run);
+
+    delete(root);
+}
+
+static void move_leaves(struct BenchRun * run)
+{
+    void * root = make_tree();
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        for (size_t g = 0; g < GROUPS; g++)
+            for (size_t j = 0; j < LEAVES; j++)
+                move(group_child(group_child(root, g), j), 1, 1);
+    bench_stop(run);
+
+    delete(root);
+}
+
+const struct BenchCase group_cases[] = {
+    { "group/bounds/clean", bounds_clean, 10000000 },
+    { "group/bounds/one_moved", bounds_one_moved, 1000000 },
+    { "group/bounds/all_moved", bounds_all_moved, 10000 },
+    { "group/move/tree", move_tree, 10000000 },
+    { "group/move/leaves", move_leaves, 1000 },
+    { NULL }
+};
@@ -0,0 +1,131 @@
+/* Cases for the HandleTable: the cost of going through a handle, and what a
+ * compaction buys back for a scan over objects scattered by churn. The churn
+ * deletes and recreates objects in random order, interleaved with other
+ * allocations, so the scattered scan touches memory the way a long-running
+ * program's heap would. Each operation is one object visited. */
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "HandleTable.h"
+
+#define OBJECTS 65536
+
+struct Churned
+{
+    void * table;
+    struct Handle * handles;
+};
+
+static void make_churned(struct Churned * churned)
+{
+    void ** ballast = malloc(OBJECTS * sizeof(*ballast));
+    unsigned seed = 1;
+
+    initCircle();
+    initHandleTable();
+    churned->table = new(HandleTable, (size_t) OBJECTS);
+    churned->handles = malloc(OBJECTS * sizeof(*churned->handles));
+    for (size_t i = 0; i < OBJECTS; i++)
+    {
+        churned->handles[i] = handle_new(churned->table, Point, (int) i, 1);
+        ballast[i] = new(Point, 0, 0);
+    }
+    for (size_t round = 0; round < 4 * OBJECTS; round++)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t i = (seed >> 8) % OBJECTS;
+        handle_delete(churned->table, churned->handles[i]);
+        delete(ballast[i]);
+        ballast[i] = new(Point, 0, 0);
+        churned->handles[i] = handle_new(churned->table, Point, (int) i, 1);
+    }
+    for (size_t i = 0; i < OBJECTS; i++)
+        delete(ballast[i]);
+    free(ballast);
+}
+
+static void delete_churned(struct Churned * churned)
+{
+    delete(churned->table);
+    free(churned->handles);
+}
+
+static void scan(struct BenchRun * run, int compact)
+{
+    struct Churned churned;
+    size_t sum = 0;
+
+    make_churned(&churned);
+    if (compact)
+        handle_compact(churned.table, NULL);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        const void * point = handle_get(churned.table, churned.handles[i % OBJECTS]);
+        sum += x(point) + y(point);
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    delete_churned(&churned);
+}
+
+static void scan_churned(struct BenchRun * run)
+{
+    scan(run, 0);
+}
+
+static void scan_compacted(struct BenchRun * run)
+{
+    scan(run, 1);
+}
+
+static void scan_raw(struct BenchRun * run)
+{
+    struct Churned churned;
+    void ** points = malloc(OBJECTS * sizeof(*points));
+    size_t sum = 0;
+
+    make_churned(&churned);
+    for (size_t i = 0; i < OBJECTS; i++)
+        points[i] = handle_get(churned.table, churned.handles[i]);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        const void * point = points[i % OBJECTS];
+        sum += x(point) + y(point);
+    }
+    bench_stop(run);
+    run->sink += sum;
+
+    free(points);
+    delete_churned(&churned);
+}
+
+static void compact_all(struct BenchRun * run)
+{
+    struct Churned churned;
+
+    make_churned(&churned);
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += OBJECTS)
+    {
+        /* a compacted table has nothing to move; one new object makes it move them all */
+        handle_delete(churned.table, churned.handles[0]);
+        churned.handles[0] = handle_new(churned.table, Point, 0, 1);
+        run->sink += handle_compact(churned.table, Point);
+    }
+    bench_stop(run);
+
+    delete_churned(&churned);
+}
+
+const struct BenchCase handle_cases[] = {
+    { "handle/scan/raw", scan_raw, 10000000 },
+    { "handle/scan/churned", scan_churned, 10000000 },
+    { "handle/scan/compacted", scan_compacted, 10000000 },
+    { "handle/compact", compact_all, 10000000 },
+    { NULL }
+};
@@ -0,0 +1,180 @@
+/* Cases for HashSet and HashMap. The input is a fixed mix of Points and Circles
+ * with many duplicates; removing the duplicates with a linear differ() scan over
+ * the unique objects found so far is the baseline the tables are measured
+ * against, and the HashSet cases are repeated at several maximum load factors. */
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "HashSet.h"
+
+#define INPUT   4096    /* objects in the input, a power of two */
+#define RANGE   64      /* coordinates are drawn from 0 .. RANGE - 1 */
+
+static void ** make_input(void)
+{
+    void ** objects = malloc(INPUT * sizeof(*objects));
+    /* a private generator, so that every thread and every run sees the same input */
+    unsigned seed = 1;
+
+    initCircle();
+    initHashSet();
+    for (size_t i = 0; i < INPUT; i++)
+    {
+        int values[3];
+        for (int v = 0; v < 3; v++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[v] = (seed >> 16) % RANGE;
+        }
+        objects[i] = i % 2 ? new(Point, values[0], values[1])
+            : new(Circle, values[0], values[1], 1 + values[2] % 2);
+    }
+    return objects;
+}
+
+static void delete_input(void ** objects)
+{
+    for (size_t i = 0; i < INPUT; i++)
+        delete(objects[i]);
+    free(objects);
+}
+
+/******************************************************************************
+ * DEDUPLICATION
+ * Each operation takes the next object of the input and keeps it unless it is a
+ * duplicate. After every pass over the input the result is thrown away.
+*******************************************************************************/
+
+static void dedup_linear(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void ** unique = malloc(INPUT * sizeof(*unique));
+    size_t count = 0;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        void * object = objects[i % INPUT];
+        if (i % INPUT == 0)
+            count = 0;
+
+        size_t j = 0;
+        while (j < count && differ(unique[j], object))
+            j++;
+        if (j == count)
+            unique[count++] = object;
+    }
+    bench_stop(run);
+    run->sink += count;
+
+    free(unique);
+    delete_input(objects);
+}
+
+static void dedup_set(struct BenchRun * run, double max_load)
+{
+    void ** objects = make_input();
+    void * set = NULL;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        if (i % INPUT == 0)
+        {
+            delete(set);
+            set = new(HashSet, (size_t) 0);
+            set_load_factor(set, max_load);
+        }
+        set_add(set, objects[i % INPUT]);
+    }
+    bench_stop(run);
+    run->sink += set_count(set);
+
+    delete(set);
+    delete_input(objects);
+}
+
+static void dedup_set_50(struct BenchRun * run)
+{
+    dedup_set(run, 0.5);
+}
+
+static void dedup_set_75(struct BenchRun * run)
+{
+    dedup_set(run, 0.75);
+}
+
+static void dedup_set_90(struct BenchRun * run)
+{
+    dedup_set(run, 0.9);
+}
+
+/******************************************************************************
+ * LOOKUPS
+ * Every object of the input is in the table, so every lookup is a hit.
+*******************************************************************************/
+
+static void set_lookup(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * set = new(HashSet, (size_t) INPUT);
+    size_t sum = 0;
+
+    for (size_t i = 0; i < INPUT; i++)
+        set_add(set, objects[i]);
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += set_find(set, objects[i % INPUT]) != NULL;
+    bench_stop(run);
+    run->sink += sum;
+
+    delete(set);
+    delete_input(objects);
+}
+
+static void map_count(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    void * map = new(HashMap, (size_t) INPUT);
+
+    /* count the occurrences of every distinct object */
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        void * key = objects[i % INPUT];
+        map_put(map, key, (void *) ((uintptr_t) map_get(map, key) + 1));
+    }
+    bench_stop(run);
+    run->sink += set_count(map);
+
+    delete(map);
+    delete_input(objects);
+}
+
+static void hash_selector(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    size_t sum = 0;
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += hash(objects[i % INPUT]);
+    bench_stop(run);
+    run->sink += sum;
+
+    delete_input(objects);
+}
+
+const struct BenchCase hash_cases[] = {
+    { "hash/selector", hash_selector, 10000000 },
+    { "hash/dedup/linear", dedup_linear, 100000 },
+    { "hash/dedup/set_load_0.50", dedup_set_50, 1000000 },
+    { "hash/dedup/set_load_0.75", dedup_set_75, 1000000 },
+    { "hash/dedup/set_load_0.90", dedup_set_90, 1000000 },
+    { "hash/set_find", set_lookup, 10000000 },
+    { "hash/map_put_get", map_count, 1000000 },
+    { NULL }
+};
@@ -0,0 +1,170 @@
+/* Cases for the parallel loops against the plain loops they stand in for. The
+ * input is a fixed mix of Points and Circles; each operation is one object
+ * handed to the loop body, so the serial and parallel cases compare directly. */
+#include <stdlib.h>
+#include <limits.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "Parallel.h"
+
+#define INPUT   65536   /* objects in the input */
+#define SIDE    8192    /* coordinates are drawn from 0 .. SIDE - 1 */
+
+static void ** make_input(void)
+{
+    void ** objects = malloc(INPUT * sizeof(*objects));
+    unsigned seed = 1;
+
+    initCircle();
+    for (size_t i = 0; i < INPUT; i++)
+    {
+        int values[2];
+        for (int v = 0; v < 2; v++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[v] = (seed >> 8) % SIDE;
+        }
+        objects[i] = i % 2 ? new(Point, values[0], values[1])
+            : new(Circle, values[0], values[1], 1 + values[0] % 16);
+    }
+    return objects;
+}
+
+static void delete_input(void ** objects)
+{
+    for (size_t i = 0; i < INPUT; i++)
+        delete(objects[i]);
+    free(objects);
+}
+
+/******************************************************************************
+ * FOR EACH
+*******************************************************************************/
+
+static void step(void * object, void * ctx)
+{
+    move(object, 1, -1);
+}
+
+static void move_serial(struct BenchRun * run)
+{
+    void ** objects = make_input();
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        step(objects[i % INPUT], NULL);
+    bench_stop(run);
+    run->sink += x(objects[0]);
+
+    delete_input(objects);
+}
+
+static void move_parallel(struct BenchRun * run)
+{
+    void ** objects = make_input();
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += INPUT)
+        parallel_for_each(objects, run->iterations - done < INPUT ? run->iterations - done : INPUT,
+            step, NULL);
+    bench_stop(run);
+    run->sink += x(objects[0]);
+
+    delete_input(objects);
+}
+
+/******************************************************************************
+ * REDUCE
+*******************************************************************************/
+
+struct Box
+{
+    int x0, y0, x1, y1;
+};
+
+static void fold_box(void * _box, void * object, void * ctx)
+{
+    struct Box * box = _box;
+    int px = x(object), py = y(object);
+
+    box->x0 = px < box->x0 ? px : box->x0;
+    box->y0 = py < box->y0 ? py : box->y0;
+    box->x1 = px > box->x1 ? px : box->x1;
+    box->y1 = py > box->y1 ? py : box->y1;
+}
+
+static void combine_box(void * _box, const void * _partial, void * ctx)
+{
+    struct Box * box = _box;
+    const struct Box * partial = _partial;
+
+    box->x0 = partial->x0 < box->x0 ? partial->x0 : box->x0;
+    box->y0 = partial->y0 < box->y0 ? partial->y0 : box->y0;
+    box->x1 = partial->x1 > box->x1 ? partial->x1 : box->x1;
+    box->y1 = partial->y1 > box->y1 ? partial->y1 : box->y1;
+}
+
+static void bounds_serial(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    struct Box box = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        fold_box(&box, objects[i % INPUT], NULL);
+    bench_stop(run);
+    run->sink += box.x1 - box.x0;
+
+    delete_input(objects);
+}
+
+static void bounds_parallel(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    struct Box box = { INT_MAX, INT_MAX, INT_MIN, INT_MIN };
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += INPUT)
+        parallel_reduce(objects, run->iterations - done < INPUT ? run->iterations - done : INPUT,
+            &box, sizeof(box), fold_box, combine_box, NULL);
+    bench_stop(run);
+    run->sink += box.x1 - box.x0;
+
+    delete_input(objects);
+}
+
+static void fold_differ(void * _count, void * object, void * other)
+{
+    *(size_t *) _count += differ(object, other) != 0;
+}
+
+static void combine_count(void * _count, const void * partial, void * ctx)
+{
+    *(size_t *) _count += *(const size_t *) partial;
+}
+
+static void differ_parallel(struct BenchRun * run)
+{
+    void ** objects = make_input();
+    size_t count = 0;
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += INPUT)
+        parallel_reduce(objects, run->iterations - done < INPUT ? run->iterations - done : INPUT,
+            &count, sizeof(count), fold_differ, combine_count, objects[0]);
+    bench_stop(run);
+    run->sink += count;
+
+    delete_input(objects);
+}
+
+const struct BenchCase parallel_cases[] = {
+    { "parallel/move/serial", move_serial, 10000000 },
+    { "parallel/move/for_each", move_parallel, 10000000 },
+    { "parallel/bounds/serial", bounds_serial, 10000000 },
+    { "parallel/bounds/reduce", bounds_parallel, 10000000 },
+    { "parallel/differ/reduce", differ_parallel, 10000000 },
+    { NULL }
+};
@@ -0,0 +1,130 @@
+/* Cases for drawing: the text backend into a buffered stream to the null device,
+ * recording into a CommandBuffer, and rasterizing the recorded commands. The
+ * scene is a fixed mix of Points and Circles over a 1024x1024 canvas. Each
+ * operation is one object drawn. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Render.h"
+#include "Canvas.h"
+
+#define SCENE   4096
+#define SIZE    1024
+
+static void ** make_scene(void)
+{
+    void ** objects = malloc(SCENE * sizeof(*objects));
+    /* a private generator, so that every thread and every run sees the same scene */
+    unsigned seed = 1;
+
+    initCircle();
+    initCanvas();
+    for (size_t i = 0; i < SCENE; i++)
+    {
+        int values[3];
+        for (int v = 0; v < 3; v++)
+        {
+            seed = seed * 1103515245u + 12345u;
+            values[v] = (seed >> 8) % SIZE;
+        }
+        objects[i] = i % 4 == 0 ? new(Point, values[0], values[1])
+            : new(Circle, values[0], values[1], 1 + values[2] % 24);
+    }
+    return objects;
+}
+
+static void delete_scene(void ** objects)
+{
+    for (size_t i = 0; i < SCENE; i++)
+        delete(objects[i]);
+    free(objects);
+}
+
+static void render_text_each(struct BenchRun * run)
+{
+    void ** objects = make_scene();
+    FILE * file = fopen(NULL_DEVICE, "w");
+    void * text = new(TextRenderer, file);
+    void * previous = render_target(text);
+
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        draw(objects[i % SCENE]);
+    fflush(file);
+    bench_stop(run);
+
+    render_target(previous);
+    delete(text);
+    fclose(file);
+    delete_scene(objects);
+}
+
+static void render_text_batch(struct BenchRun * run)
+{
+    void ** objects = make_scene();
+    FILE * file = fopen(NULL_DEVICE, "w");
+    void * text = new(TextRenderer, file);
+    void * previous = render_target(text);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += SCENE)
+        draw_all(objects, run->iterations - done < SCENE ? run->iterations - done : SCENE);
+    fflush(file);
+    bench_stop(run);
+
+    render_target(previous);
+    delete(text);
+    fclose(file);
+    delete_scene(objects);
+}
+
+static void render_record(struct BenchRun * run)
+{
+    void ** objects = make_scene();
+    void * commands = new(CommandBuffer, (size_t) SCENE);
+    void * previous = render_target(commands);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += SCENE)
+    {
+        commands_clear(commands);
+        draw_all(objects, run->iterations - done < SCENE ? run->iterations - done : SCENE);
+    }
+    bench_stop(run);
+    run->sink += commands_count(commands);
+
+    render_target(previous);
+    delete(commands);
+    delete_scene(objects);
+}
+
+static void render_raster(struct BenchRun * run)
+{
+    void ** objects = make_scene();
+    void * commands = new(CommandBuffer, (size_t) SCENE);
+    void * canvas = new(Canvas, SIZE, SIZE);
+    void * previous = render_target(commands);
+
+    draw_all(objects, SCENE);
+    render_target(previous);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += SCENE)
+        canvas_rasterize(canvas, commands);
+    bench_stop(run);
+    run->sink += canvas_pixel(canvas, SIZE / 2, SIZE / 2);
+
+    delete(canvas);
+    delete(commands);
+    delete_scene(objects);
+}
+
+const struct BenchCase render_cases[] = {
+    { "render/text/each", render_text_each, 1000000 },
+    { "render/text/batch", render_text_batch, 1000000 },
+    { "render/record", render_record, 10000000 },
+    { "render/raster", render_raster, 1000000 },
+    { NULL }
+};
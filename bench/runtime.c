@@ -0,0 +1,564 @@
+/* Cases for the costs of the object runtime itself: creating and destroying
+ * objects, running ctor chains, building class descriptors, calling selectors
+ * and printing objects. */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "PointArray.h"
+#include "HashSet.h"
+#include "Vector.h"
+#include "Buffer.h"
+
+#define BATCH 1024
+
+/******************************************************************************
+ * NEW AND DELETE
+ * One object at a time, and a batch of objects created before any is deleted,
+ * which is closer to how a program holds on to its objects.
+*******************************************************************************/
+
+static void setup(void)
+{
+    initPointArray();
+    initHashSet();
+    initVector();
+}
+
+#define NEW_DELETE(name, ...) \
+    static void new_delete_##name(struct BenchRun * run) \
+    { \
+        setup(); \
+        bench_start(run); \
+        for (long i = 0; i < run->iterations; i++) \
+            delete(new(__VA_ARGS__)); \
+        bench_stop(run); \
+    }
+
+NEW_DELETE(Object, Object)
+NEW_DELETE(Point, Point, 1, 2)
+NEW_DELETE(Circle, Circle, 1, 2, 3)
+NEW_DELETE(PointArray, PointArray, (size_t) 0)
+NEW_DELETE(HashSet, HashSet, (size_t) 0)
+
+static void new_delete_batch(struct BenchRun * run)
+{
+    void * batch[BATCH];
+
+    setup();
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += BATCH)
+    {
+        long n = run->iterations - done < BATCH ? run->iterations - done : BATCH;
+        for (long i = 0; i < n; i++)
+            batch[i] = new(Point, 1, 2);
+        for (long i = 0; i < n; i++)
+            delete(batch[i]);
+    }
+    bench_stop(run);
+}
+
+/******************************************************************************
+ * CTOR CHAINS
+ * init() runs the same ctor chain as new() without the allocation: one ctor for
+ * Object, two for Point and three for Circle. The typed initializers skip the
+ * chain and the va_list entirely.
+*******************************************************************************/
+
+static void ctor_chain_Object(struct BenchRun * run)
+{
+    struct Object storage;
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += (size_t) class_of(init(&storage, Object));
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void ctor_chain_Point(struct BenchRun * run)
+{
+    struct Point storage;
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += x(init(&storage, Point, (int) i, 2));
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void ctor_chain_Circle(struct BenchRun * run)
+{
+    struct Circle storage;
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += radius(init(&storage, Circle, 1, 2, (int) i));
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void ctor_chain_Point_init(struct BenchRun * run)
+{
+    struct Point storage;
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += x(Point_init(&storage, (int) i, 2));
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void ctor_chain_Circle_init(struct BenchRun * run)
+{
+    struct Circle storage;
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += radius(Circle_init(&storage, 1, 2, (int) i));
+    bench_stop(run);
+    run->sink += sum;
+}
+
+/******************************************************************************
+ * CLASS DESCRIPTORS
+ * Every descriptor built is also entered into the class registry, which keeps a
+ * record of it for good. The registry must never see a dangling descriptor, so
+ * the storage they are built in is deliberately never freed.
+*******************************************************************************/
+
+static int bench_differ(const void * self, const void * other)
+{
+    return self != other;
+}
+
+static void bench_draw(const void * self)
+{
+}
+
+static void class_ctor_Class(struct BenchRun * run)
+{
+    struct Class * storage = malloc(sizeof(*storage));
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += init(storage, Class, "BenchObject", Object, sizeof(struct Object),
+            differ, bench_differ, NULL) != NULL;
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void * bench_message(void * self, va_list * arg_ptr)
+{
+    return self;
+}
+
+/* Selectors for messages: any function will do, as long as each is a different one */
+#define MESSAGE(n) \
+    static void * message_##n(void * self, ...) \
+    { \
+        return self; \
+    }
+
+MESSAGE(0) MESSAGE(1) MESSAGE(2) MESSAGE(3) MESSAGE(4)
+MESSAGE(5) MESSAGE(6) MESSAGE(7) MESSAGE(8) MESSAGE(9)
+
+/* ten messages on top of a slot, as a plugin class might have */
+static void class_ctor_messages(struct BenchRun * run)
+{
+    struct Class * storage = malloc(sizeof(*storage));
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        sum += init(storage, Class, "BenchMessages", Object, sizeof(struct Object),
+            differ, bench_differ,
+            message_0, bench_message, message_1, bench_message, message_2, bench_message,
+            message_3, bench_message, message_4, bench_message, message_5, bench_message,
+            message_6, bench_message, message_7, bench_message, message_8, bench_message,
+            message_9, bench_message, NULL) != NULL;
+        /* the table of messages is the class's own, and this one is built over again */
+        free((void *) storage->methods);
+    }
+    bench_stop(run);
+    run->sink += sum;
+}
+
+static void class_ctor_PointClass(struct BenchRun * run)
+{
+    struct PointClass * storage = malloc(sizeof(*storage));
+    size_t sum = 0;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        sum += init(storage, PointClass, "BenchPoint", Point, sizeof(struct Point),
+            differ, bench_differ, draw, bench_draw, NULL) != NULL;
+    bench_stop(run);
+    run->sink += sum;
+}
+
+/******************************************************************************
+ * DISPATCH
+ * A selector against the same method called through a known class descriptor
+ * (the _as macros), sent as a message and against plain code the compiler can
+ * see. The objects rotate through a small array so that nothing can be hoisted
+ * out of the loop.
+*******************************************************************************/
+
+struct Operands
+{
+    void * objects[8];
+    void * other;
+};
+
+static void make_operands(struct Operands * operands)
+{
+    setup();
+    for (int i = 0; i < 8; i++)
+        operands->objects[i] = new(Point, i, i);
+    operands->other = new(Point, 3, 3);
+}
+
+static void delete_operands(struct Operands * operands)
+{
+    for (int i = 0; i < 8; i++)
+        delete(operands->objects[i]);
+    delete(operands->other);
+}
+
+static int direct_differ(const void * self, const void * other)
+{
+    return x(self) != x(other) || y(self) != y(other);
+}
+
+static void direct_draw(const void * self)
+{
+    printf("\".\" at %d,%d\n", x(self), y(self));
+}
+
+#define DISPATCH(name, call) \
+    static void dispatch_##name(struct BenchRun * run) \
+    { \
+        struct Operands operands; \
+        size_t sum = 0; \
+        make_operands(&operands); \
+        bench_start(run); \
+        for (long i = 0; i < run->iterations; i++) \
+        { \
+            void * self = operands.objects[i & 7]; \
+            call; \
+        } \
+        bench_stop(run); \
+        run->sink += sum; \
+        delete_operands(&operands); \
+    }
+
+DISPATCH(differ_selector, sum += differ(self, operands.other))
+DISPATCH(differ_as, sum += differ_as(Point, self, operands.other))
+DISPATCH(differ_direct, sum += direct_differ(self, operands.other))
+DISPATCH(draw_selector, draw(self))
+DISPATCH(draw_as, draw_as(Point, self))
+DISPATCH(draw_direct, direct_draw(self))
+DISPATCH(puto_selector, sum += puto(self, stdout))
+DISPATCH(puto_as, sum += puto_as(Object, self, stdout))
+DISPATCH(puto_direct, sum += fprintf(stdout, "%s at %p\n", "Point", self))
+
+/* differ() again, as a message sent to a subclass of Point, plainly and through
+the cache of the call site */
+static void * message_differ(void * self, va_list * arg_ptr)
+{
+    const void * other = va_arg(*arg_ptr, const void *);
+
+    return (void *) (size_t) differ_as(Point, self, other);
+}
+
+static const void * Messenger;
+static atomic_int messenger_once;
+
+static void buildMessenger(void)
+{
+    Messenger = new(PointClass, "Messenger", Point, sizeof(struct Point),
+        message_0, message_differ, NULL);
+}
+
+static void dispatch_message(struct BenchRun * run, int cached)
+{
+    static struct SendCache cache;
+    struct Operands operands;
+    size_t sum = 0;
+
+    setup();
+    class_once(&messenger_once, buildMessenger);
+    for (int i = 0; i < 8; i++)
+        operands.objects[i] = new(Messenger, i, i);
+    operands.other = new(Point, 3, 3);
+
+    bench_start(run);
+    if (cached)
+        for (long i = 0; i < run->iterations; i++)
+            sum += (size_t) send_cached(&cache, operands.objects[i & 7], (selector_fn) message_0, operands.other);
+    else
+        for (long i = 0; i < run->iterations; i++)
+            sum += (size_t) message_send(operands.objects[i & 7], (selector_fn) message_0, operands.other);
+    bench_stop(run);
+    run->sink += sum;
+
+    delete_operands(&operands);
+}
+
+static void dispatch_differ_send(struct BenchRun * run)
+{
+    dispatch_message(run, 0);
+}
+
+static void dispatch_differ_cached(struct BenchRun * run)
+{
+    dispatch_message(run, 1);
+}
+
+/* The operands are Points, so the walk up the superclasses goes all the way to Object */
+static int walk_is_of(const void * self, const void * class)
+{
+    for (const void * ancestor = class_of(self); ancestor != Object; ancestor = super(ancestor))
+        if (ancestor == class)
+            return 1;
+    return 0;
+}
+
+DISPATCH(is_a, sum += is_a(self, Circle))
+DISPATCH(is_of, sum += is_of(self, Circle))
+DISPATCH(is_of_walk, sum += walk_is_of(self, Circle))
+
+/******************************************************************************
+ * OUTPUT
+ * puto() into a fully buffered stream to the null device, one object at a time
+ * and as a batch, so the numbers are formatting and stdio rather than the disk.
+ * sputo() into a Buffer, alone and with the buffer written out every BATCH
+ * objects by buffer_flush().
+*******************************************************************************/
+
+#define SINK_BUFFER (1 << 16)
+
+static FILE * open_sink(void)
+{
+    FILE * file = fopen(NULL_DEVICE, "w");
+
+    if (!file)
+    {
+        fprintf(stderr, "bench: cannot open %s\n", NULL_DEVICE);
+        exit(1);
+    }
+    setvbuf(file, NULL, _IOFBF, SINK_BUFFER);
+    return file;
+}
+
+static void make_mixed(void ** objects, size_t n)
+{
+    setup();
+    for (size_t i = 0; i < n; i++)
+        objects[i] = i % 3 ? new(Point, (int) i, -(int) i) : new(Circle, (int) i, 1, 2);
+}
+
+static void puto_each(struct BenchRun * run)
+{
+    void * objects[BATCH];
+    FILE * file = open_sink();
+
+    make_mixed(objects, BATCH);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+        run->bytes += puto(objects[i % BATCH], file);
+    fflush(file);
+    bench_stop(run);
+
+    fclose(file);
+    for (size_t i = 0; i < BATCH; i++)
+        delete(objects[i]);
+}
+
+static void puto_batch(struct BenchRun * run)
+{
+    void * objects[BATCH];
+    FILE * file = open_sink();
+
+    make_mixed(objects, BATCH);
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += BATCH)
+    {
+        long n = run->iterations - done < BATCH ? run->iterations - done : BATCH;
+        run->bytes += puto_all(objects, n, file);
+    }
+    fflush(file);
+    bench_stop(run);
+
+    fclose(file);
+    for (size_t i = 0; i < BATCH; i++)
+        delete(objects[i]);
+}
+
+static void sputo_each(struct BenchRun * run)
+{
+    void * objects[BATCH];
+    struct Buffer text = { 0 };
+
+    make_mixed(objects, BATCH);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        text.length = 0;
+        run->bytes += sputo(objects[i % BATCH], &text);
+    }
+    bench_stop(run);
+
+    buffer_free(&text);
+    for (size_t i = 0; i < BATCH; i++)
+        delete(objects[i]);
+}
+
+static void sputo_flush(struct BenchRun * run)
+{
+    void * objects[BATCH];
+    struct Buffer text = { 0 };
+    FILE * file = open_sink();
+
+    make_mixed(objects, BATCH);
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        run->bytes += sputo(objects[i % BATCH], &text);
+        if (i % BATCH == BATCH - 1 || i == run->iterations - 1)
+            buffer_flush(fileno(file), &text, 1);
+    }
+    bench_stop(run);
+
+    fclose(file);
+    buffer_free(&text);
+    for (size_t i = 0; i < BATCH; i++)
+        delete(objects[i]);
+}
+
+/******************************************************************************
+ * INLINE STORAGE
+ * The same Points made one at a time with new() and stored by value in a
+ * Vector, then scanned in order with the batch selector differ_all().
+*******************************************************************************/
+
+#define SCAN 65536
+
+static void vector_append_Point(struct BenchRun * run)
+{
+    void * vector = NULL;
+
+    setup();
+    bench_start(run);
+    for (long i = 0; i < run->iterations; i++)
+    {
+        if (i % SCAN == 0)
+        {
+            delete(vector);
+            vector = new(Vector, Point, (size_t) 0);
+        }
+        vector_append(vector, (int) i, 2);
+    }
+    bench_stop(run);
+    run->sink += vector_count(vector);
+    delete(vector);
+}
+
+static void scan_heap(struct BenchRun * run)
+{
+    void ** objects = malloc(SCAN * sizeof(*objects));
+    void * other = new(Point, 3, 3);
+
+    setup();
+    for (size_t i = 0; i < SCAN; i++)
+        objects[i] = new(Point, (int) i % 7, 3);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += SCAN)
+        run->sink += differ_all(objects, run->iterations - done < SCAN ? run->iterations - done : SCAN,
+            other, NULL);
+    bench_stop(run);
+
+    for (size_t i = 0; i < SCAN; i++)
+        delete(objects[i]);
+    free(objects);
+    delete(other);
+}
+
+static void scan_vector(struct BenchRun * run)
+{
+    void * vector;
+    void * other = new(Point, 3, 3);
+
+    setup();
+    vector = new(Vector, Point, (size_t) SCAN);
+    for (size_t i = 0; i < SCAN; i++)
+        vector_append(vector, (int) i % 7, 3);
+    void * const * objects = vector_objects(vector);
+
+    bench_start(run);
+    for (long done = 0; done < run->iterations; done += SCAN)
+        run->sink += differ_all(objects, run->iterations - done < SCAN ? run->iterations - done : SCAN,
+            other, NULL);
+    bench_stop(run);
+
+    delete(vector);
+    delete(other);
+}
+
+const struct BenchCase runtime_cases[] = {
+    { "new_delete/Object", new_delete_Object, 10000000 },
+    { "new_delete/Point", new_delete_Point, 10000000 },
+    { "new_delete/Circle", new_delete_Circle, 10000000 },
+    { "new_delete/PointArray", new_delete_PointArray, 1000000 },
+    { "new_delete/HashSet", new_delete_HashSet, 1000000 },
+    { "new_delete/Point_batch", new_delete_batch, 10000000 },
+    { "ctor_chain/Object", ctor_chain_Object, 10000000 },
+    { "ctor_chain/Point", ctor_chain_Point, 10000000 },
+    { "ctor_chain/Circle", ctor_chain_Circle, 10000000 },
+    { "ctor_chain/Point_init", ctor_chain_Point_init, 10000000 },
+    { "ctor_chain/Circle_init", ctor_chain_Circle_init, 10000000 },
+    { "class_ctor/Class", class_ctor_Class, 100000 },
+    { "class_ctor/PointClass", class_ctor_PointClass, 100000 },
+    { "class_ctor/messages", class_ctor_messages, 100000 },
+    { "dispatch/differ/selector", dispatch_differ_selector, 10000000 },
+    { "dispatch/differ/as", dispatch_differ_as, 10000000 },
+    { "dispatch/differ/direct", dispatch_differ_direct, 10000000 },
+    { "dispatch/differ/send", dispatch_differ_send, 10000000 },
+    { "dispatch/differ/send_cached", dispatch_differ_cached, 10000000 },
+    { "dispatch/draw/selector", dispatch_draw_selector, 1000000 },
+    { "dispatch/draw/as", dispatch_draw_as, 1000000 },
+    { "dispatch/draw/direct", dispatch_draw_direct, 1000000 },
+    { "dispatch/puto/selector", dispatch_puto_selector, 1000000 },
+    { "dispatch/puto/as", dispatch_puto_as, 1000000 },
+    { "dispatch/puto/direct", dispatch_puto_direct, 1000000 },
+    { "typecheck/is_a", dispatch_is_a, 10000000 },
+    { "typecheck/is_of", dispatch_is_of, 10000000 },
+    { "typecheck/walk", dispatch_is_of_walk, 10000000 },
+    { "puto/each", puto_each, 1000000 },
+    { "puto/batch", puto_batch, 1000000 },
+    { "sputo/each", sputo_each, 1000000 },
+    { "sputo/flush", sputo_flush, 1000000 },
+    { "vector/append_Point", vector_append_Point, 10000000 },
+    { "vector/scan/heap", scan_heap, 10000000 },
+    { "vector/scan/inline", scan_vector, 10000000 },
+    { NULL }
+};
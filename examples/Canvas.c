@@ -0,0 +1,358 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Canvas.h"
+#include "Canvas_struct.h"
+#include "Render.h"
+#include "Buffer.h"
+#include "Parallel.h"
+
+/******************************************************************************
+ * PIXELS
+*******************************************************************************/
+
+int canvas_width(const void * _self)
+{
+    const struct Canvas * self = _self;
+    assert(self);
+
+    return self->width;
+}
+
+int canvas_height(const void * _self)
+{
+    const struct Canvas * self = _self;
+    assert(self);
+
+    return self->height;
+}
+
+uint32_t canvas_pixel(const void * _self, int x, int y)
+{
+    const struct Canvas * self = _self;
+    assert(self && x >= 0 && x < self->width && y >= 0 && y < self->height);
+
+    const unsigned char * pixel = self->pixels + 3 * ((size_t) y * self->width + x);
+    return (uint32_t) pixel[0] << 16 | (uint32_t) pixel[1] << 8 | pixel[2];
+}
+
+/* Set pixels x0 .. x1 of row y, all of them inside the canvas */
+static void span(struct Canvas * self, long long y, long long x0, long long x1, uint32_t color)
+{
+    unsigned char * pixel = self->pixels + 3 * ((size_t) y * self->width + (size_t) x0);
+    unsigned char r = color >> 16, g = color >> 8, b = color;
+
+    for (long long x = x0; x <= x1; x++, pixel += 3)
+    {
+        pixel[0] = r;
+        pixel[1] = g;
+        pixel[2] = b;
+    }
+}
+
+void canvas_clear(void * _self, uint32_t color)
+{
+    struct Canvas * self = _self;
+    assert(self);
+
+    for (int y = 0; y < self->height; y++)
+        span(self, y, 0, self->width - 1, color);
+}
+
+/******************************************************************************
+ * RASTERIZATION
+ * The commands are first sorted into lists by the tiles their bounding boxes
+ * touch, keeping the order they were recorded in, then the tiles are filled in
+ * parallel, each clipped to its own pixels so no two threads write the same byte.
+*******************************************************************************/
+
+struct Clip
+{
+    long long x0, y0, x1, y1;   /* inclusive */
+};
+
+static int bounds_of(const struct Canvas * self, const struct DrawCommand * command, struct Clip * box)
+{
+    long long r = command->kind == DRAW_CIRCLE && command->radius > 0 ? command->radius : 0;
+
+    box->x0 = command->x - r < 0 ? 0 : command->x - r;
+    box->y0 = command->y - r < 0 ? 0 : command->y - r;
+    box->x1 = command->x + r >= self->width ? self->width - 1 : command->x + r;
+    box->y1 = command->y + r >= self->height ? self->height - 1 : command->y + r;
+    return box->x0 <= box->x1 && box->y0 <= box->y1;
+}
+
+static long long isqrt(long long v)
+{
+    unsigned long long rest = (unsigned long long) v, root = 0;
+
+    for (unsigned long long bit = 1ull << 62; bit; bit >>= 2)
+    {
+        if (rest >= root + bit)
+        {
+            rest -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+    }
+    return (long long) root;
+}
+
+/* Scanline fill: the half width of each row follows from the last one, so only
+ * the first row of the disc inside the clip needs a square root. */
+static void fill_disc(struct Canvas * self, const struct DrawCommand * command, const struct Clip * clip)
+{
+    long long r = command->radius > 0 ? command->radius : 0;
+    long long y0 = command->y - r > clip->y0 ? command->y - r : clip->y0;
+    long long y1 = command->y + r < clip->y1 ? command->y + r : clip->y1;
+    long long half = -1;
+
+    for (long long y = y0; y <= y1; y++)
+    {
+        long long dy = y - command->y;
+        long long rest = r * r - dy * dy;
+
+        if (half < 0)
+            half = isqrt(rest);
+        while ((half + 1) * (half + 1) <= rest)
+            half++;
+        while (half * half > rest)
+            half--;
+
+        long long x0 = command->x - half > clip->x0 ? command->x - half : clip->x0;
+        long long x1 = command->x + half < clip->x1 ? command->x + half : clip->x1;
+        if (x0 <= x1)
+            span(self, y, x0, x1, command->color);
+    }
+}
+
+static void draw_command(struct Canvas * self, const struct DrawCommand * command, const struct Clip * clip)
+{
+    if (command->kind == DRAW_CIRCLE)
+        fill_disc(self, command, clip);
+    else if (command->x >= clip->x0 && command->x <= clip->x1
+        && command->y >= clip->y0 && command->y <= clip->y1)
+        span(self, command->y, command->x, command->x, command->color);
+}
+
+struct Raster
+{
+    struct Canvas * canvas;
+    const struct DrawCommand * commands;
+    int tiles_x;
+    size_t * starts;    /* tile t draws lists[starts[t] .. starts[t + 1] - 1] */
+    size_t * lists;     /* command indices */
+};
+
+static void fill_tiles(size_t begin, size_t end, void * _raster)
+{
+    struct Raster * raster = _raster;
+    struct Canvas * self = raster->canvas;
+
+    for (size_t t = begin; t < end; t++)
+    {
+        struct Clip clip;
+        clip.x0 = (long long) (t % raster->tiles_x) * CANVAS_TILE;
+        clip.y0 = (long long) (t / raster->tiles_x) * CANVAS_TILE;
+        clip.x1 = clip.x0 + CANVAS_TILE > self->width ? self->width - 1 : clip.x0 + CANVAS_TILE - 1;
+        clip.y1 = clip.y0 + CANVAS_TILE > self->height ? self->height - 1 : clip.y0 + CANVAS_TILE - 1;
+
+        for (size_t i = raster->starts[t]; i < raster->starts[t + 1]; i++)
+            draw_command(self, raster->commands + raster->lists[i], &clip);
+    }
+}
+
+/**
+ * @brief Draw the commands recorded in a CommandBuffer onto the canvas, on top
+ *        of what is there already.
+ */
+void canvas_rasterize(void * _self, const void * buffer)
+{
+    struct Canvas * self = _self;
+    assert(self && buffer);
+
+    const struct DrawCommand * commands = commands_data(buffer);
+    size_t n = commands_count(buffer);
+    int tiles_x = (self->width + CANVAS_TILE - 1) / CANVAS_TILE;
+    int tiles_y = (self->height + CANVAS_TILE - 1) / CANVAS_TILE;
+    size_t tiles = (size_t) tiles_x * tiles_y;
+
+    struct Raster raster = { self, commands, tiles_x, calloc(tiles + 1, sizeof(size_t)), NULL };
+    assert(raster.starts);
+
+    /* count the commands per tile, shifted by one so the sums become the starts */
+    struct Clip box;
+    for (size_t i = 0; i < n; i++)
+        if (bounds_of(self, commands + i, &box))
+            for (long long ty = box.y0 / CANVAS_TILE; ty <= box.y1 / CANVAS_TILE; ty++)
+                for (long long tx = box.x0 / CANVAS_TILE; tx <= box.x1 / CANVAS_TILE; tx++)
+                    raster.starts[ty * tiles_x + tx + 1]++;
+    for (size_t t = 0; t < tiles; t++)
+        raster.starts[t + 1] += raster.starts[t];
+
+    size_t * cursor = malloc((tiles ? tiles : 1) * sizeof(*cursor));
+    raster.lists = malloc((raster.starts[tiles] ? raster.starts[tiles] : 1) * sizeof(*raster.lists));
+    assert(cursor && raster.lists);
+    memcpy(cursor, raster.starts, tiles * sizeof(*cursor));
+    for (size_t i = 0; i < n; i++)
+        if (bounds_of(self, commands + i, &box))
+            for (long long ty = box.y0 / CANVAS_TILE; ty <= box.y1 / CANVAS_TILE; ty++)
+                for (long long tx = box.x0 / CANVAS_TILE; tx <= box.x1 / CANVAS_TILE; tx++)
+                    raster.lists[cursor[ty * tiles_x + tx]++] = i;
+    free(cursor);
+
+    parallel_for(tiles, 1, fill_tiles, &raster);
+
+    free(raster.lists);
+    free(raster.starts);
+}
+
+/******************************************************************************
+ * OUTPUT
+*******************************************************************************/
+
+int canvas_write(const void * _self, FILE * file_ptr, enum CanvasFormat format)
+{
+    const struct Canvas * self = _self;
+    assert(self && file_ptr);
+
+    if (format == CANVAS_PPM)
+    {
+        fprintf(file_ptr, "P6\n%d %d\n255\n", self->width, self->height);
+        fwrite(self->pixels, 3, (size_t) self->width * self->height, file_ptr);
+    }
+    else
+    {
+        unsigned char * row = malloc(self->width);
+        assert(row);
+
+        fprintf(file_ptr, "P5\n%d %d\n255\n", self->width, self->height);
+        for (int y = 0; y < self->height; y++)
+        {
+            const unsigned char * pixel = self->pixels + 3 * (size_t) y * self->width;
+            /* ITU-R BT.601 luma */
+            for (int x = 0; x < self->width; x++, pixel += 3)
+                row[x] = (unsigned char) ((299 * pixel[0] + 587 * pixel[1] + 114 * pixel[2] + 500) / 1000);
+            fwrite(row, 1, self->width, file_ptr);
+        }
+        free(row);
+    }
+    return fflush(file_ptr) || ferror(file_ptr) ? -1 : 0;
+}
+
+/******************************************************************************
+ * CANVAS CLASS METHODS
+*******************************************************************************/
+
+static void * Canvas_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct Canvas * self = super_ctor(Canvas, _self, arglist_ptr);
+
+    self->width = va_arg(*arglist_ptr, int);
+    self->height = va_arg(*arglist_ptr, int);
+    assert(self->width > 0 && self->height > 0);
+    self->pixels = calloc((size_t) self->width * self->height, 3);
+    assert(self->pixels);
+
+    return self;
+}
+
+static void * Canvas_dtor(void * _self)
+{
+    struct Canvas * self = _self;
+
+    free(self->pixels);
+
+    return super_dtor(Canvas, self);
+}
+
+static int Canvas_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Canvas * self = _self;
+
+    int n = buffer_print(out, "Canvas ");
+    n += buffer_print_int(out, self->width);
+    n += buffer_print(out, "x");
+    n += buffer_print_int(out, self->height);
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, _self);
+    return n + buffer_print(out, "\n");
+}
+
+static void * Canvas_copy(const void * _self)
+{
+    const struct Canvas * self = _self;
+    struct Canvas * replica = super_copy(Canvas, self);
+    size_t size = 3 * (size_t) self->width * self->height;
+
+    replica->pixels = malloc(size);
+    assert(replica->pixels);
+    memcpy(replica->pixels, self->pixels, size);
+
+    return replica;
+}
+
+static int Canvas_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Canvas * self = _self;
+
+    if (super_serialize(Canvas, self, out))
+        return -1;
+    buffer_put_int(out, self->width);
+    buffer_put_int(out, self->height);
+    buffer_put(out, self->pixels, 3 * (size_t) self->width * self->height);
+
+    return 0;
+}
+
+static void * Canvas_deserialize(void * _self, struct Reader * in)
+{
+    struct Canvas * self = super_deserialize(Canvas, _self, in);
+
+    if (!self || reader_get_int(in, &self->width) || reader_get_int(in, &self->height)
+        || self->width <= 0 || self->height <= 0
+        || (uint64_t) self->width * self->height > (uint64_t) (in->end - in->cursor) / 3)
+        return NULL;
+
+    size_t size = 3 * (size_t) self->width * self->height;
+    self->pixels = malloc(size);
+    assert(self->pixels);
+    if (reader_get(in, self->pixels, size))
+    {
+        Canvas_dtor(self);
+        return NULL;
+    }
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Canvas;
+
+static atomic_int canvas_once;
+
+static void buildCanvas(void)
+{
+    Canvas = new(
+        Class,
+        "Canvas",
+        Object,
+        sizeof(struct Canvas),
+        ctor, Canvas_ctor,
+        dtor, Canvas_dtor,
+        sputo, Canvas_sputo,
+        copy, Canvas_copy,
+        serialize, Canvas_serialize,
+        deserialize, Canvas_deserialize,
+        NULL);
+}
+
+void initCanvas(void)
+{
+    initRender();
+    class_once(&canvas_once, buildCanvas);
+}
@@ -0,0 +1,42 @@
+#ifndef __CANVAS__H__SL
+#define __CANVAS__H__SL
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Object.h"
+
+/******************************************************************************
+ * CANVAS
+ * new(Canvas, width, height) creates an RGB framebuffer, cleared to black, whose
+ * pixel x,y is the point x,y; whatever falls outside is clipped. Commands recorded
+ * by a CommandBuffer (see Render.h) are rasterized in tiles of CANVAS_TILE pixels
+ * on a side. The tiles are independent, so they are filled on several threads;
+ * within a tile the commands are drawn in the order they were recorded, so the
+ * image does not depend on the number of threads.
+*******************************************************************************/
+
+#define CANVAS_TILE 64
+
+enum CanvasFormat
+{
+    CANVAS_PPM,     /* binary RGB, P6 */
+    CANVAS_PGM      /* binary greyscale, P5 */
+};
+
+extern const void * Canvas;
+
+int canvas_width(const void * canvas);
+int canvas_height(const void * canvas);
+uint32_t canvas_pixel(const void * canvas, int x, int y);     /* 0xRRGGBB */
+
+void canvas_clear(void * canvas, uint32_t color);
+void canvas_rasterize(void * canvas, const void * commands);
+
+/* Returns 0, or -1 if the file could not be written */
+int canvas_write(const void * canvas, FILE * file_ptr, enum CanvasFormat format);
+
+/* initCanvas is used to set up the class descriptor for Canvas */
+void initCanvas(void);
+
+#endif  /* !__CANVAS__H__SL */
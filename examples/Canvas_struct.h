@@ -0,0 +1,17 @@
+#ifndef __CANVAS_STRUCT__H__SL
+#define __CANVAS_STRUCT__H__SL
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * Canvas structure
+*******************************************************************************/
+/* Three bytes per pixel, red first, row after row from the top */
+struct Canvas
+{
+    const struct Object _;
+    int width, height;
+    unsigned char * pixels;
+};
+
+#endif  /* !__CANVAS_STRUCT__H__SL */
@@ -1,6 +1,19 @@
 #include <assert.h>
 #include "Circle.h"
 #include "Circle_struct.h"
+#include "Buffer.h"
+#include "Render.h"
+
+/* Typed constructor: fills in a Circle directly instead of going through new(),
+ * ctor() and the va_list. The storage must be at least sizeof(struct Circle). */
+void * Circle_init(void * _self, int x, int y, int radius)
+{
+    struct Circle * self = Point_init(_self, x, y);
+    ((struct Object *) self)->class = Circle;
+    self->radius = radius;
+
+    return self;
+}
 
 /* Circle class methods */
 
@@ -14,28 +27,107 @@ static void * Circle_ctor(void * _self, va_list * arglist_ptr)
 
 }
 
+/* Circles are values too, compared like Points but in one go instead of through
+ * super_differ, which would dispatch again and test the class a second time */
+static int Circle_differ(const void * _self, const void * other)
+{
+    const struct Circle * self = _self;
+
+    if (self == other)
+        return 0;
+    if (class_of(self) != class_of(other))
+        return 1;
+    return ((x(self) ^ x(other)) | (y(self) ^ y(other)) | (self->radius ^ radius(other))) != 0;
+}
+
+static size_t Circle_hash(const void * _self)
+{
+    const struct Circle * self = _self;
+
+    return hash_combine(super_hash(Circle, self), (unsigned) self->radius);
+}
+
+/* Circle at x,y radius r at address */
+static int Circle_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Circle * self = _self;
+
+    int n = buffer_print(out, ((const struct Class *) class_of(self))->name);
+    n += buffer_print(out, " at ");
+    n += buffer_print_int(out, x(self));
+    n += buffer_print(out, ",");
+    n += buffer_print_int(out, y(self));
+    n += buffer_print(out, " radius ");
+    n += buffer_print_int(out, self->radius);
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, self);
+    return n + buffer_print(out, "\n");
+}
+
 static void Circle_draw(const void * _self)
 {
     const struct Circle * self = _self;
+    struct DrawCommand command = { DRAW_CIRCLE, x(self), y(self), radius(self), 0 };
+
+    render_commands(&command, 1);
+}
+
+static void Circle_draw_batch(void * const * objects, size_t n)
+{
+    struct DrawCommand commands[256];
+
+    for (size_t done = 0; done < n; )
+    {
+        size_t count = n - done < 256 ? n - done : 256;
+        for (size_t i = 0; i < count; i++)
+        {
+            const void * circle = objects[done + i];
+            commands[i] = (struct DrawCommand) { DRAW_CIRCLE, x(circle), y(circle), radius(circle), 0 };
+        }
+        render_commands(commands, count);
+        done += count;
+    }
+}
+
+static int Circle_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Circle * self = _self;
+
+    if (super_serialize(Circle, self, out))
+        return -1;
+    buffer_put_int(out, self->radius);
 
-    printf("Circle at %d,%d radius %d\n", x(self), y(self), radius(self));
+    return 0;
 }
 
-const void * Circle;
+static void * Circle_deserialize(void * _self, struct Reader * in)
+{
+    struct Circle * self = super_deserialize(Circle, _self, in);
+
+    if (!self || reader_get_int(in, &self->radius))
+        return NULL;
+
+    return self;
+}
+
+/* Point's methods with Circle's on top; at is where the PointClass part of a descriptor is */
+#define Circle_METHODS(at) \
+    Point_METHODS(at), at._.ctor = Circle_ctor, at._.differ = Circle_differ, \
+    at._.hash = Circle_hash, at._.sputo = Circle_sputo, at._.serialize = Circle_serialize, \
+    at._.deserialize = Circle_deserialize, at.draw = Circle_draw, at.draw_batch = Circle_draw_batch
+
+CLASS_STATIC(Circle, PointClass, Point, CIRCLE_ID,
+    Circle_METHODS());
+
+static atomic_int circle_once;
+
+static void registerCircle(void)
+{
+    class_register(Circle);
+}
 
 void initCircle(void)
 {
     initPoint();
-    if (!Circle)
-    {
-        Circle = new(
-            PointClass,
-            "Circle",
-            Point,
-            sizeof(struct Circle),
-            ctor, Circle_ctor,
-            draw, Circle_draw,
-            NULL
-            );
-    }
-}
\ No newline at end of file
+    class_once(&circle_once, registerCircle);
+}
@@ -4,11 +4,14 @@
 /* Include the structure of the superclass */
 #include "Point.h"
 
-extern const void * Circle;
+extern const void * const Circle;
 
 /* No new methods */
 
-/* initCircle is used to setup class descriptors */
+/* Construct a Circle in place without the variadic ctor chain */
+void * Circle_init(void * circle, int x, int y, int radius);
+
+/* initCircle registers Circle by name; the descriptor itself is static */
 void initCircle(void);
 
 /* No need for CircleClass since it adds no new method */
@@ -10,4 +10,7 @@ struct Circle
 };
 #define radius(p)   (((const struct Circle *)(p))->radius)
 
+extern const struct PointClass Circle_descriptor;
+#define Circle_ANCESTORS    Point_ANCESTORS, CLASS_ANCESTOR(Circle)
+
 #endif  /* !__CIRCLE_STRUCT__H__SL */
\ No newline at end of file
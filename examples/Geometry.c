@@ -0,0 +1,383 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "Geometry.h"
+#include "PointArray_struct.h"
+
+/* The vector kernels are built with the target attribute of GCC and Clang, so
+that they are there whatever the compiler flags, and only called once the
+processor says it has the instructions. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GEOMETRY_X86
+#include <immintrin.h>
+#define SSE2_TARGET     __attribute__((target("sse2")))
+#define AVX2_TARGET     __attribute__((target("avx2")))
+#endif
+
+/* Elements x0[i], y0[i] with radius r0[i] and x1[i], y1[i] with radius r1[i], or
+radius 0 when r1 is NULL. The kernels work on blocks of 64 of them. */
+struct Pairs
+{
+    const int * x0, * y0, * r0;
+    const int * x1, * y1, * r1;
+};
+
+#define BLOCK   64
+
+static size_t count_bits(uint64_t word)
+{
+    word -= word >> 1 & 0x5555555555555555u;
+    word = (word & 0x3333333333333333u) + (word >> 2 & 0x3333333333333333u);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fu;
+
+    return (size_t) (word * 0x0101010101010101u >> 56);
+}
+
+/******************************************************************************
+ * SCALAR KERNELS
+ * The reference for the others, and what runs on the last partial block.
+*******************************************************************************/
+
+static uint64_t distance_of(int a, int b)
+{
+    return a > b ? (uint64_t) ((int64_t) a - b) : (uint64_t) ((int64_t) b - a);
+}
+
+static uint64_t distance2(const struct Pairs * pairs, size_t i)
+{
+    uint64_t dx = distance_of(pairs->x0[i], pairs->x1[i]);
+    uint64_t dy = distance_of(pairs->y0[i], pairs->y1[i]);
+    uint64_t sum = dx * dx + dy * dy;
+
+    return sum < dx * dx ? UINT64_MAX : sum;
+}
+
+static int within(const struct Pairs * pairs, size_t i)
+{
+    uint64_t reach = (uint64_t) (pairs->r0[i] > 0 ? pairs->r0[i] : 0);
+
+    if (pairs->r1 && pairs->r1[i] > 0)
+        reach += (uint64_t) pairs->r1[i];
+    return distance2(pairs, i) <= reach * reach;
+}
+
+static uint64_t test_scalar(const struct Pairs * pairs, size_t i)
+{
+    uint64_t word = 0;
+
+    for (size_t j = 0; j < BLOCK; j++)
+        word |= (uint64_t) within(pairs, i + j) << j;
+    return word;
+}
+
+static void distance_scalar(const struct Pairs * pairs, size_t i, uint64_t * distances)
+{
+    for (size_t j = i; j < i + BLOCK; j++)
+        distances[j] = distance2(pairs, j);
+}
+
+/******************************************************************************
+ * VECTOR KERNELS
+ * The distance between two ints fits 32 unsigned bits as max - min, and its
+ * square is a 32 x 32 -> 64 bit multiply, which both instruction sets do for the
+ * even lanes of a vector; the odd lanes are shifted down for a second one. While
+ * the distances and the reach are below 2^31, the squares add up to less than
+ * 2^63, so the sign of reach^2 - distance^2 tells whether a pair passes, and
+ * neither set needs a 64-bit compare, which SSE2 does not have. The lanes of a
+ * vector that holds anything further apart are done one by one in plain C.
+*******************************************************************************/
+
+#ifdef GEOMETRY_X86
+
+/* spread[bits] puts bit k of bits at bit 2k, to interleave even and odd lanes */
+static const unsigned char spread[16] = {
+    0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15,
+    0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55
+};
+
+static unsigned test_lanes(const struct Pairs * pairs, size_t i, size_t n)
+{
+    unsigned bits = 0;
+
+    for (size_t j = 0; j < n; j++)
+        bits |= (unsigned) within(pairs, i + j) << j;
+    return bits;
+}
+
+SSE2_TARGET static __m128i distance_sse2(const int * a, const int * b)
+{
+    __m128i u = _mm_load_si128((const __m128i *) a), v = _mm_load_si128((const __m128i *) b);
+    __m128i greater = _mm_cmpgt_epi32(u, v);
+
+    return _mm_or_si128(_mm_and_si128(greater, _mm_sub_epi32(u, v)),
+        _mm_andnot_si128(greater, _mm_sub_epi32(v, u)));
+}
+
+/* max(r, 0) clears the lanes whose sign bit is set */
+SSE2_TARGET static __m128i reach_sse2(const int * r)
+{
+    __m128i v = _mm_load_si128((const __m128i *) r);
+
+    return _mm_andnot_si128(_mm_srai_epi32(v, 31), v);
+}
+
+SSE2_TARGET static __m128i square_sum_sse2(__m128i dx, __m128i dy)
+{
+    return _mm_add_epi64(_mm_mul_epu32(dx, dx), _mm_mul_epu32(dy, dy));
+}
+
+/* the lanes where reach^2 - squares is negative */
+SSE2_TARGET static unsigned outside_sse2(__m128i reach, __m128i squares)
+{
+    return (unsigned) _mm_movemask_pd(_mm_castsi128_pd(_mm_sub_epi64(_mm_mul_epu32(reach, reach), squares)));
+}
+
+SSE2_TARGET static uint64_t test_sse2(const struct Pairs * pairs, size_t i)
+{
+    uint64_t word = 0;
+
+    for (size_t j = i; j < i + BLOCK; j += 4)
+    {
+        __m128i dx = distance_sse2(pairs->x0 + j, pairs->x1 + j);
+        __m128i dy = distance_sse2(pairs->y0 + j, pairs->y1 + j);
+        __m128i reach = reach_sse2(pairs->r0 + j);
+        if (pairs->r1)
+            reach = _mm_add_epi32(reach, reach_sse2(pairs->r1 + j));
+
+        unsigned bits;
+        if (_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(dx, dy), reach))))
+            bits = test_lanes(pairs, j, 4);
+        else
+        {
+            unsigned out_even = outside_sse2(reach, square_sum_sse2(dx, dy));
+            unsigned out_odd = outside_sse2(_mm_srli_epi64(reach, 32),
+                square_sum_sse2(_mm_srli_epi64(dx, 32), _mm_srli_epi64(dy, 32)));
+            bits = spread[~out_even & 3] | spread[~out_odd & 3] << 1;
+        }
+        word |= (uint64_t) bits << (j - i);
+    }
+    return word;
+}
+
+SSE2_TARGET static void distance_sse2_block(const struct Pairs * pairs, size_t i, uint64_t * distances)
+{
+    for (size_t j = i; j < i + BLOCK; j += 4)
+    {
+        __m128i dx = distance_sse2(pairs->x0 + j, pairs->x1 + j);
+        __m128i dy = distance_sse2(pairs->y0 + j, pairs->y1 + j);
+
+        if (_mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(dx, dy))))
+        {
+            for (size_t k = j; k < j + 4; k++)
+                distances[k] = distance2(pairs, k);
+            continue;
+        }
+        __m128i even = square_sum_sse2(dx, dy);
+        __m128i odd = square_sum_sse2(_mm_srli_epi64(dx, 32), _mm_srli_epi64(dy, 32));
+        _mm_storeu_si128((__m128i *) (distances + j), _mm_unpacklo_epi64(even, odd));
+        _mm_storeu_si128((__m128i *) (distances + j + 2), _mm_unpackhi_epi64(even, odd));
+    }
+}
+
+AVX2_TARGET static __m256i distance_avx2(const int * a, const int * b)
+{
+    __m256i u = _mm256_load_si256((const __m256i *) a), v = _mm256_load_si256((const __m256i *) b);
+
+    return _mm256_sub_epi32(_mm256_max_epi32(u, v), _mm256_min_epi32(u, v));
+}
+
+AVX2_TARGET static __m256i reach_avx2(const int * r)
+{
+    return _mm256_max_epi32(_mm256_load_si256((const __m256i *) r), _mm256_setzero_si256());
+}
+
+AVX2_TARGET static __m256i square_sum_avx2(__m256i dx, __m256i dy)
+{
+    return _mm256_add_epi64(_mm256_mul_epu32(dx, dx), _mm256_mul_epu32(dy, dy));
+}
+
+AVX2_TARGET static unsigned outside_avx2(__m256i reach, __m256i squares)
+{
+    return (unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(
+        _mm256_sub_epi64(_mm256_mul_epu32(reach, reach), squares)));
+}
+
+AVX2_TARGET static uint64_t test_avx2(const struct Pairs * pairs, size_t i)
+{
+    uint64_t word = 0;
+
+    for (size_t j = i; j < i + BLOCK; j += 8)
+    {
+        __m256i dx = distance_avx2(pairs->x0 + j, pairs->x1 + j);
+        __m256i dy = distance_avx2(pairs->y0 + j, pairs->y1 + j);
+        __m256i reach = reach_avx2(pairs->r0 + j);
+        if (pairs->r1)
+            reach = _mm256_add_epi32(reach, reach_avx2(pairs->r1 + j));
+
+        unsigned bits;
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_or_si256(dx, dy), reach))))
+            bits = test_lanes(pairs, j, 8);
+        else
+        {
+            unsigned out_even = outside_avx2(reach, square_sum_avx2(dx, dy));
+            unsigned out_odd = outside_avx2(_mm256_srli_epi64(reach, 32),
+                square_sum_avx2(_mm256_srli_epi64(dx, 32), _mm256_srli_epi64(dy, 32)));
+            bits = spread[~out_even & 15] | spread[~out_odd & 15] << 1;
+        }
+        word |= (uint64_t) bits << (j - i);
+    }
+    return word;
+}
+
+AVX2_TARGET static void distance_avx2_block(const struct Pairs * pairs, size_t i, uint64_t * distances)
+{
+    for (size_t j = i; j < i + BLOCK; j += 8)
+    {
+        __m256i dx = distance_avx2(pairs->x0 + j, pairs->x1 + j);
+        __m256i dy = distance_avx2(pairs->y0 + j, pairs->y1 + j);
+
+        if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(dx, dy))))
+        {
+            for (size_t k = j; k < j + 8; k++)
+                distances[k] = distance2(pairs, k);
+            continue;
+        }
+        __m256i even = square_sum_avx2(dx, dy);
+        __m256i odd = square_sum_avx2(_mm256_srli_epi64(dx, 32), _mm256_srli_epi64(dy, 32));
+
+        /* unpacking works within 128-bit halves: 0 1 4 5 and 2 3 6 7 */
+        __m256i low = _mm256_unpacklo_epi64(even, odd);
+        __m256i high = _mm256_unpackhi_epi64(even, odd);
+        _mm256_storeu_si256((__m256i *) (distances + j), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256((__m256i *) (distances + j + 4), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+}
+
+#endif  /* GEOMETRY_X86 */
+
+/******************************************************************************
+ * DISPATCH
+*******************************************************************************/
+
+struct Kernels
+{
+    uint64_t (*test)(const struct Pairs * pairs, size_t i);
+    void (*distance)(const struct Pairs * pairs, size_t i, uint64_t * distances);
+};
+
+static const struct Kernels kernels[] = {
+    [GEOMETRY_SCALAR] = { test_scalar, distance_scalar },
+#ifdef GEOMETRY_X86
+    [GEOMETRY_SSE2] = { test_sse2, distance_sse2_block },
+    [GEOMETRY_AVX2] = { test_avx2, distance_avx2_block },
+#endif
+};
+
+static atomic_int level_setting;    /* the level + 1, 0 until it is chosen */
+
+static int best_level(void)
+{
+#ifdef GEOMETRY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return GEOMETRY_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return GEOMETRY_SSE2;
+#endif
+    return GEOMETRY_SCALAR;
+}
+
+int geometry_level(void)
+{
+    int level = atomic_load_explicit(&level_setting, memory_order_relaxed);
+
+    if (!level)
+    {
+        geometry_set_level(GEOMETRY_AVX2);
+        level = atomic_load_explicit(&level_setting, memory_order_relaxed);
+    }
+    return level - 1;
+}
+
+void geometry_set_level(int level)
+{
+    int best = best_level();
+
+    if (level > best)
+        level = best;
+    if (level < GEOMETRY_SCALAR)
+        level = GEOMETRY_SCALAR;
+    atomic_store_explicit(&level_setting, level + 1, memory_order_relaxed);
+}
+
+/******************************************************************************
+ * BATCH GEOMETRY
+ * Whole blocks go to the kernels of the chosen level, which can rely on the
+ * alignment of the arrays; the last partial block is done in plain C.
+*******************************************************************************/
+
+static struct Pairs pairs_of(const struct PointArray * a, const struct PointArray * b)
+{
+    assert(a && b && a->count == b->count);
+
+    return (struct Pairs) { a->x, a->y, a->radius, b->x, b->y, b->radius };
+}
+
+static size_t test_pairs(const struct Pairs * pairs, size_t n, uint64_t * mask)
+{
+    const struct Kernels * use = &kernels[geometry_level()];
+    size_t found = 0, i = 0;
+
+    assert(mask || !n);
+    for (; i + BLOCK <= n; i += BLOCK)
+        found += count_bits(mask[i / BLOCK] = use->test(pairs, i));
+    if (i < n)
+    {
+        uint64_t word = 0;
+        for (size_t j = i; j < n; j++)
+            word |= (uint64_t) within(pairs, j) << (j - i);
+        found += count_bits(mask[i / BLOCK] = word);
+    }
+    return found;
+}
+
+/**
+ * @brief Test circle a[i] against circle b[i] for every i.
+ *
+ * @return size_t the number of pairs that overlap
+ */
+size_t circles_overlap(const void * a, const void * b, uint64_t * mask)
+{
+    struct Pairs pairs = pairs_of(a, b);
+    assert(pairs.r0 && pairs.r1);
+
+    return test_pairs(&pairs, points_count(a), mask);
+}
+
+/**
+ * @brief Test point points[i] against circle circles[i] for every i.
+ *
+ * @return size_t the number of points inside their circle
+ */
+size_t circles_contain(const void * circles, const void * points, uint64_t * mask)
+{
+    struct Pairs pairs = pairs_of(circles, points);
+    assert(pairs.r0);
+
+    pairs.r1 = NULL;
+    return test_pairs(&pairs, points_count(circles), mask);
+}
+
+void points_distance2(const void * a, const void * b, uint64_t * distances)
+{
+    struct Pairs pairs = pairs_of(a, b);
+    const struct Kernels * use = &kernels[geometry_level()];
+    size_t n = points_count(a), i = 0;
+
+    assert(distances || !n);
+    for (; i + BLOCK <= n; i += BLOCK)
+        use->distance(&pairs, i, distances);
+    for (; i < n; i++)
+        distances[i] = distance2(&pairs, i);
+}
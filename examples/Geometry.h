@@ -0,0 +1,51 @@
+#ifndef __GEOMETRY__H__SL
+#define __GEOMETRY__H__SL
+
+#include <stdint.h>
+
+#include "PointArray.h"
+
+/******************************************************************************
+ * BATCH GEOMETRY
+ * Kernels that take two PointArrays or CircleArrays of the same count and
+ * compare them pair by pair: element i of the first with element i of the
+ * second. To test many circles against one, fill the second array with copies.
+ *
+ * The tests set bit i of mask, that is mask[i / 64] >> i % 64 & 1, for the pairs
+ * that pass and clear it for the others, and return the number of bits set. The
+ * mask needs (count + 63) / 64 words. Circles that touch overlap and a point on
+ * a circle is in it. A negative radius counts as 0.
+ *
+ * Distances are computed in 64 bits, so they are exact for any int coordinates.
+ * Only points some 2^32 apart, near opposite ends of the int range, are too far
+ * for their squared distance to fit. It saturates at UINT64_MAX, which is still
+ * more than the square of any two radii added up.
+ *
+ * The kernels run with AVX2 or SSE2 when the processor has them, chosen at the
+ * first call, and in plain C everywhere else.
+*******************************************************************************/
+
+enum GeometryLevel
+{
+    GEOMETRY_SCALAR,
+    GEOMETRY_SSE2,
+    GEOMETRY_AVX2
+};
+
+/* Circles a[i] and b[i] overlap. Both have to be CircleArrays. */
+size_t circles_overlap(const void * a, const void * b, uint64_t * mask);
+
+/* Point points[i] lies in circle circles[i]. A CircleArray passed as points
+counts by its centres. */
+size_t circles_contain(const void * circles, const void * points, uint64_t * mask);
+
+/* distances[i] receives the squared distance between the centres of a[i] and
+b[i]. distances needs room for the count of the arrays. */
+void points_distance2(const void * a, const void * b, uint64_t * distances);
+
+/* The instruction set the kernels use. geometry_set_level() picks a lower one,
+to compare them; asking for more than the processor has gets the best it has. */
+int geometry_level(void);
+void geometry_set_level(int level);
+
+#endif  /* !__GEOMETRY__H__SL */
@@ -0,0 +1,758 @@
+#include <assert.h>
+#include <float.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "Grid.h"
+#include "Grid_struct.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "Parallel.h"
+#include "Buffer.h"
+
+#define GRID_DEFAULT_CELL   32      /* until grid_build() picks one */
+#define GRID_MIN_BUCKETS    16
+#define GRID_BUILD_GRAIN    4096    /* objects per chunk of a parallel build */
+#define GRID_QUERY_GRAIN    256     /* shapes per chunk of a batch query */
+
+/******************************************************************************
+ * CELLS AND BUCKETS
+*******************************************************************************/
+
+/* floor(v / size), also for negative v */
+static long cell_of(long long v, int size)
+{
+    return (long) (v >= 0 ? v / size : -((-(v + 1)) / size) - 1);
+}
+
+static size_t bucket_of(const struct Grid * self, long cx, long cy)
+{
+    uint64_t key = (uint64_t) (uint32_t) cx << 32 | (uint32_t) cy;
+
+    key ^= key >> 29;
+    key *= 0x9E3779B97F4A7C15u;
+    key ^= key >> 32;
+    return (size_t) key & self->mask;
+}
+
+/* A Point is a circle of radius 0 */
+static int radius_of(const void * object)
+{
+    return is_of(object, Circle) ? radius(object) : 0;
+}
+
+static void fill(struct GridEntry * entry, const void * object)
+{
+    entry->object = object;
+    entry->x = x(object);
+    entry->y = y(object);
+    entry->radius = radius_of(object);
+}
+
+static void place(const struct Grid * self, struct GridEntry * entry)
+{
+    entry->cx = (int) cell_of(entry->x, self->cell_size);
+    entry->cy = (int) cell_of(entry->y, self->cell_size);
+}
+
+static void occupy(struct Grid * self, const struct GridEntry * entry)
+{
+    if (entry->cx < self->min_cx)
+        self->min_cx = entry->cx;
+    if (entry->cx > self->max_cx)
+        self->max_cx = entry->cx;
+    if (entry->cy < self->min_cy)
+        self->min_cy = entry->cy;
+    if (entry->cy > self->max_cy)
+        self->max_cy = entry->cy;
+    if (entry->radius > self->max_radius)
+        self->max_radius = entry->radius;
+}
+
+static void vacate(struct Grid * self)
+{
+    self->min_cx = self->min_cy = INT_MAX;
+    self->max_cx = self->max_cy = INT_MIN;
+    self->max_radius = 0;
+}
+
+/* Entries in the block of the last build belong to it, not to their bucket */
+static int borrowed(const struct Grid * self, const struct GridEntry * entries)
+{
+    return self->block && entries >= self->block && entries < self->block + self->block_count;
+}
+
+static void push(struct Grid * self, struct GridBucket * bucket, const struct GridEntry * entry)
+{
+    if (bucket->count == bucket->capacity)
+    {
+        uint32_t capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        struct GridEntry * entries = malloc(capacity * sizeof(*entries));
+        assert(entries);
+        if (bucket->count)
+            memcpy(entries, bucket->entries, bucket->count * sizeof(*entries));
+        if (!borrowed(self, bucket->entries))
+            free(bucket->entries);
+        bucket->entries = entries;
+        bucket->capacity = capacity;
+    }
+    bucket->entries[bucket->count++] = *entry;
+}
+
+static void free_buckets(struct Grid * self)
+{
+    for (size_t b = 0; self->buckets && b <= self->mask; b++)
+        if (!borrowed(self, self->buckets[b].entries))
+            free(self->buckets[b].entries);
+    free(self->buckets);
+    free(self->block);
+    self->buckets = NULL;
+    self->block = NULL;
+    self->block_count = 0;
+}
+
+/* Copy every entry out, in bucket order */
+static struct GridEntry * gather(const struct Grid * self)
+{
+    struct GridEntry * entries = malloc((self->count ? self->count : 1) * sizeof(*entries));
+    size_t n = 0;
+    assert(entries);
+
+    for (size_t b = 0; b <= self->mask; b++)
+    {
+        const struct GridBucket * bucket = self->buckets + b;
+        if (bucket->count)
+            memcpy(entries + n, bucket->entries, bucket->count * sizeof(*entries));
+        n += bucket->count;
+    }
+    assert(n == self->count);
+    return entries;
+}
+
+/******************************************************************************
+ * FILING
+ * Entries are filed in three passes: find every entry's cell and bucket and
+ * count the entries per bucket, lay the buckets out one after the other in a
+ * single block, and copy the entries to their places. The first and last passes
+ * run in parallel.
+*******************************************************************************/
+
+struct Filing
+{
+    struct Grid * grid;
+    struct GridEntry * entries;
+    uint32_t * where;               /* the bucket of each entry */
+    _Atomic uint32_t * cursor;      /* counts, then the next free place per bucket */
+};
+
+static void count_range(size_t begin, size_t end, void * _filing)
+{
+    struct Filing * filing = _filing;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        struct GridEntry * entry = filing->entries + i;
+        place(filing->grid, entry);
+        filing->where[i] = (uint32_t) bucket_of(filing->grid, entry->cx, entry->cy);
+        atomic_fetch_add_explicit(filing->cursor + filing->where[i], 1, memory_order_relaxed);
+    }
+}
+
+static void copy_range(size_t begin, size_t end, void * _filing)
+{
+    struct Filing * filing = _filing;
+    struct GridEntry * block = filing->grid->block;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        uint32_t at = atomic_fetch_add_explicit(filing->cursor + filing->where[i], 1, memory_order_relaxed);
+        block[at] = filing->entries[i];
+    }
+}
+
+/**
+ * @brief Set up the buckets for n entries and file them. The entries must have
+ *        their object, position and radius filled in; the bounds are left alone.
+ */
+static void file_all(struct Grid * self, struct GridEntry * entries, size_t n)
+{
+    size_t buckets = GRID_MIN_BUCKETS;
+    while (buckets < n)
+        buckets *= 2;
+    assert(buckets <= UINT32_MAX);
+
+    self->mask = buckets - 1;
+    self->buckets = calloc(buckets, sizeof(*self->buckets));
+    self->block = malloc((n ? n : 1) * sizeof(*self->block));
+    self->block_count = n;
+    self->count = n;
+
+    struct Filing filing = { self, entries, malloc((n ? n : 1) * sizeof(uint32_t)),
+        calloc(buckets, sizeof(*filing.cursor)) };
+    assert(self->buckets && self->block && filing.where && filing.cursor);
+
+    parallel_for(n, GRID_BUILD_GRAIN, count_range, &filing);
+
+    uint32_t offset = 0;
+    for (size_t b = 0; b < buckets; b++)
+    {
+        uint32_t count = atomic_load_explicit(filing.cursor + b, memory_order_relaxed);
+        self->buckets[b].entries = count ? self->block + offset : NULL;
+        self->buckets[b].count = self->buckets[b].capacity = count;
+        atomic_store_explicit(filing.cursor + b, offset, memory_order_relaxed);
+        offset += count;
+    }
+
+    parallel_for(n, GRID_BUILD_GRAIN, copy_range, &filing);
+
+    free(filing.where);
+    free((void *) filing.cursor);
+}
+
+/******************************************************************************
+ * BUILDING
+*******************************************************************************/
+
+struct Build
+{
+    void * const * objects;
+    struct GridEntry * entries;
+    pthread_mutex_t lock;
+    long long min_x, min_y, max_x, max_y;
+    long long radius_sum;
+    int max_radius;
+};
+
+static void read_range(size_t begin, size_t end, void * _build)
+{
+    struct Build * build = _build;
+    long long min_x = LLONG_MAX, min_y = LLONG_MAX, max_x = LLONG_MIN, max_y = LLONG_MIN;
+    long long radius_sum = 0;
+    int max_radius = 0;
+
+    for (size_t i = begin; i < end; i++)
+    {
+        struct GridEntry * entry = build->entries + i;
+        fill(entry, build->objects[i]);
+        min_x = entry->x < min_x ? entry->x : min_x;
+        max_x = entry->x > max_x ? entry->x : max_x;
+        min_y = entry->y < min_y ? entry->y : min_y;
+        max_y = entry->y > max_y ? entry->y : max_y;
+        radius_sum += entry->radius;
+        max_radius = entry->radius > max_radius ? entry->radius : max_radius;
+    }
+
+    pthread_mutex_lock(&build->lock);
+    build->min_x = min_x < build->min_x ? min_x : build->min_x;
+    build->max_x = max_x > build->max_x ? max_x : build->max_x;
+    build->min_y = min_y < build->min_y ? min_y : build->min_y;
+    build->max_y = max_y > build->max_y ? max_y : build->max_y;
+    build->radius_sum += radius_sum;
+    build->max_radius = max_radius > build->max_radius ? max_radius : build->max_radius;
+    pthread_mutex_unlock(&build->lock);
+}
+
+static unsigned long long isqrt(unsigned long long v)
+{
+    unsigned long long root = 0;
+
+    for (unsigned long long bit = 1ull << 62; bit; bit >>= 2)
+    {
+        if (v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+            root >>= 1;
+    }
+    return root;
+}
+
+/* About one object per cell over the area the objects cover, but no smaller than
+ * the average circle, so that an overlap query looks at a handful of cells. */
+static int pick_cell_size(const struct Build * build, size_t n)
+{
+    unsigned long long width = (unsigned long long) (build->max_x - build->min_x) + 1;
+    unsigned long long height = (unsigned long long) (build->max_y - build->min_y) + 1;
+    unsigned long long area = width > ULLONG_MAX / height ? ULLONG_MAX : width * height;
+    unsigned long long size = isqrt(area / n);
+    unsigned long long diameter = 2 * (unsigned long long) (build->radius_sum / (long long) n);
+
+    if (size < diameter)
+        size = diameter;
+    if (size < 1)
+        size = 1;
+    return size > INT_MAX / 2 ? INT_MAX / 2 : (int) size;
+}
+
+/**
+ * @brief Replace the contents of the grid with the given objects. Reading the
+ *        objects and filing them runs in parallel.
+ */
+void grid_build(void * _self, void * const * objects, size_t n)
+{
+    struct Grid * self = _self;
+    assert(self && (objects || !n));
+
+    free_buckets(self);
+    vacate(self);
+
+    struct Build build = { objects, malloc((n ? n : 1) * sizeof(struct GridEntry)),
+        PTHREAD_MUTEX_INITIALIZER, LLONG_MAX, LLONG_MAX, LLONG_MIN, LLONG_MIN, 0, 0 };
+    assert(build.entries);
+    parallel_for(n, GRID_BUILD_GRAIN, read_range, &build);
+
+    if (n)
+    {
+        if (self->auto_size)
+            self->cell_size = pick_cell_size(&build, n);
+        self->min_cx = (int) cell_of(build.min_x, self->cell_size);
+        self->max_cx = (int) cell_of(build.max_x, self->cell_size);
+        self->min_cy = (int) cell_of(build.min_y, self->cell_size);
+        self->max_cy = (int) cell_of(build.max_y, self->cell_size);
+        self->max_radius = build.max_radius;
+    }
+    file_all(self, build.entries, n);
+
+    free(build.entries);
+    pthread_mutex_destroy(&build.lock);
+}
+
+/******************************************************************************
+ * CHANGES
+*******************************************************************************/
+
+/* The entry for object, which must be where the grid last saw it */
+static struct GridEntry * find(const struct Grid * self, const void * object, struct GridBucket ** bucket_ptr)
+{
+    long cx = cell_of(x(object), self->cell_size);
+    long cy = cell_of(y(object), self->cell_size);
+    struct GridBucket * bucket = self->buckets + bucket_of(self, cx, cy);
+
+    *bucket_ptr = bucket;
+    for (uint32_t i = 0; i < bucket->count; i++)
+        if (bucket->entries[i].object == object)
+            return bucket->entries + i;
+    return NULL;
+}
+
+static void rehash(struct Grid * self)
+{
+    struct GridEntry * entries = gather(self);
+    size_t count = self->count;
+
+    free_buckets(self);
+    file_all(self, entries, count);
+    free(entries);
+}
+
+static void insert_entry(struct Grid * self, struct GridEntry * entry)
+{
+    if (self->count >= 2 * (self->mask + 1))
+        rehash(self);
+
+    place(self, entry);
+    occupy(self, entry);
+    push(self, self->buckets + bucket_of(self, entry->cx, entry->cy), entry);
+    self->count++;
+}
+
+void grid_insert(void * _self, const void * object)
+{
+    struct Grid * self = _self;
+    struct GridEntry entry;
+    assert(self && object);
+
+    fill(&entry, object);
+    insert_entry(self, &entry);
+}
+
+int grid_remove(void * _self, const void * object)
+{
+    struct Grid * self = _self;
+    struct GridBucket * bucket;
+    assert(self && object);
+
+    struct GridEntry * entry = find(self, object, &bucket);
+    if (!entry)
+        return -1;
+
+    *entry = bucket->entries[--bucket->count];
+    if (!--self->count)
+        vacate(self);
+    return 0;
+}
+
+/**
+ * @brief move() an object in the grid and file it under its new cell.
+ */
+void grid_move(void * _self, void * object, int dx, int dy)
+{
+    struct Grid * self = _self;
+    struct GridBucket * bucket;
+    assert(self && object);
+
+    struct GridEntry * entry = find(self, object, &bucket);
+    assert(entry);
+
+    move(object, dx, dy);
+
+    struct GridEntry moved = *entry;
+    moved.x = x(object);
+    moved.y = y(object);
+    place(self, &moved);
+    if (moved.cx == entry->cx && moved.cy == entry->cy)
+        *entry = moved;
+    else
+    {
+        *entry = bucket->entries[--bucket->count];
+        self->count--;
+        insert_entry(self, &moved);
+    }
+}
+
+size_t grid_count(const void * _self)
+{
+    const struct Grid * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+/******************************************************************************
+ * QUERIES
+*******************************************************************************/
+
+typedef void (*visit_fn)(const struct GridEntry * entry, void * ctx);
+
+/**
+ * @brief Call fn for every entry filed under the cells cx0..cx1 by cy0..cy1. A
+ *        block of cells larger than the table is done by one pass over the buckets.
+ */
+static void visit(const struct Grid * self, long cx0, long cy0, long cx1, long cy1,
+    visit_fn fn, void * ctx)
+{
+    if (!self->count)
+        return;
+    cx0 = cx0 < self->min_cx ? self->min_cx : cx0;
+    cy0 = cy0 < self->min_cy ? self->min_cy : cy0;
+    cx1 = cx1 > self->max_cx ? self->max_cx : cx1;
+    cy1 = cy1 > self->max_cy ? self->max_cy : cy1;
+    if (cx0 > cx1 || cy0 > cy1)
+        return;
+
+    if ((unsigned long long) (cx1 - cx0 + 1) * (unsigned long long) (cy1 - cy0 + 1) > self->mask + 1)
+    {
+        for (size_t b = 0; b <= self->mask; b++)
+        {
+            const struct GridBucket * bucket = self->buckets + b;
+            for (uint32_t i = 0; i < bucket->count; i++)
+            {
+                const struct GridEntry * entry = bucket->entries + i;
+                if (entry->cx >= cx0 && entry->cx <= cx1 && entry->cy >= cy0 && entry->cy <= cy1)
+                    fn(entry, ctx);
+            }
+        }
+        return;
+    }
+
+    for (long cy = cy0; cy <= cy1; cy++)
+        for (long cx = cx0; cx <= cx1; cx++)
+        {
+            const struct GridBucket * bucket = self->buckets + bucket_of(self, cx, cy);
+            for (uint32_t i = 0; i < bucket->count; i++)
+            {
+                const struct GridEntry * entry = bucket->entries + i;
+                if (entry->cx == cx && entry->cy == cy)
+                    fn(entry, ctx);
+            }
+        }
+}
+
+struct Search
+{
+    long long x0, y0, x1, y1;   /* a rectangle, or a circle at x0,y0 with radius x1 */
+    const void * skip;
+    const void ** results;
+    size_t max, found;
+};
+
+static void collect(struct Search * search, const void * object)
+{
+    if (search->found < search->max)
+        search->results[search->found] = object;
+    search->found++;
+}
+
+static void in_range(const struct GridEntry * entry, void * _search)
+{
+    struct Search * search = _search;
+    /* the point of the rectangle closest to the centre */
+    long long px = entry->x < search->x0 ? search->x0 : entry->x > search->x1 ? search->x1 : entry->x;
+    long long py = entry->y < search->y0 ? search->y0 : entry->y > search->y1 ? search->y1 : entry->y;
+    double dx = (double) (px - entry->x), dy = (double) (py - entry->y);
+
+    if (dx * dx + dy * dy <= (double) entry->radius * entry->radius)
+        collect(search, entry->object);
+}
+
+/**
+ * @brief Find the objects that reach into the rectangle from x0,y0 to x1,y1,
+ *        edges included.
+ */
+size_t grid_range(const void * _self, int x0, int y0, int x1, int y1,
+    const void ** results, size_t max)
+{
+    const struct Grid * self = _self;
+    assert(self && (results || !max));
+
+    struct Search search = { x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1,
+        x0 < x1 ? x1 : x0, y0 < y1 ? y1 : y0, NULL, results, max, 0 };
+    int size = self->cell_size;
+    long long reach = self->max_radius;
+
+    visit(self, cell_of(search.x0 - reach, size), cell_of(search.y0 - reach, size),
+        cell_of(search.x1 + reach, size), cell_of(search.y1 + reach, size), in_range, &search);
+    return search.found;
+}
+
+static void overlapping(const struct GridEntry * entry, void * _search)
+{
+    struct Search * search = _search;
+    double dx = (double) (entry->x - search->x0), dy = (double) (entry->y - search->y0);
+    double reach = (double) (search->x1 + entry->radius);
+
+    if (entry->object != search->skip && dx * dx + dy * dy <= reach * reach)
+        collect(search, entry->object);
+}
+
+static size_t overlaps(const struct Grid * self, const void * shape, const void ** results, size_t max)
+{
+    struct Search search = { x(shape), y(shape), radius_of(shape), 0, shape, results, max, 0 };
+    int size = self->cell_size;
+    long long reach = search.x1 + self->max_radius;
+
+    visit(self, cell_of(search.x0 - reach, size), cell_of(search.y0 - reach, size),
+        cell_of(search.x0 + reach, size), cell_of(search.y0 + reach, size), overlapping, &search);
+    return search.found;
+}
+
+/**
+ * @brief Find the objects other than shape whose circles overlap or touch the
+ *        circle of shape, a Point or a Circle that need not be in the grid.
+ */
+size_t grid_overlaps(const void * _self, const void * shape, const void ** results, size_t max)
+{
+    const struct Grid * self = _self;
+    assert(self && shape && (results || !max));
+
+    return overlaps(self, shape, results, max);
+}
+
+struct Nearest
+{
+    long long x, y;
+    const void * skip;
+    const void * best;
+    double best_d2;
+};
+
+static void closer(const struct GridEntry * entry, void * _nearest)
+{
+    struct Nearest * nearest = _nearest;
+    double dx = (double) (entry->x - nearest->x), dy = (double) (entry->y - nearest->y);
+    double d2 = dx * dx + dy * dy;
+
+    if (entry->object != nearest->skip && d2 < nearest->best_d2)
+    {
+        nearest->best = entry->object;
+        nearest->best_d2 = d2;
+    }
+}
+
+/* Search rings of cells around x,y, starting with the first ring that reaches
+ * the occupied cells. After ring k, every object not yet seen is at least k
+ * cells away, so the search stops once the best one found is closer than that. */
+static const void * nearest(const struct Grid * self, int x, int y, const void * skip)
+{
+    struct Nearest search = { x, y, skip, NULL, DBL_MAX };
+    double size = self->cell_size;
+    long qx = cell_of(x, self->cell_size);
+    long qy = cell_of(y, self->cell_size);
+
+    if (!self->count)
+        return NULL;
+
+    long k = 0;
+    k = self->min_cx - qx > k ? self->min_cx - qx : k;
+    k = qx - self->max_cx > k ? qx - self->max_cx : k;
+    k = self->min_cy - qy > k ? self->min_cy - qy : k;
+    k = qy - self->max_cy > k ? qy - self->max_cy : k;
+    for (;; k++)
+    {
+        visit(self, qx - k, qy - k, qx + k, qy - k, closer, &search);
+        if (k)
+        {
+            visit(self, qx - k, qy + k, qx + k, qy + k, closer, &search);
+            visit(self, qx - k, qy - k + 1, qx - k, qy + k - 1, closer, &search);
+            visit(self, qx + k, qy - k + 1, qx + k, qy + k - 1, closer, &search);
+        }
+        if (search.best && search.best_d2 <= (k * size) * (k * size))
+            break;
+        if (qx - k <= self->min_cx && qx + k >= self->max_cx
+            && qy - k <= self->min_cy && qy + k >= self->max_cy)
+            break;
+    }
+    return search.best;
+}
+
+const void * grid_nearest(const void * _self, int x, int y)
+{
+    const struct Grid * self = _self;
+    assert(self);
+
+    return nearest(self, x, y, NULL);
+}
+
+struct Batch
+{
+    const struct Grid * grid;
+    void * const * shapes;
+    const void ** nearest;
+    size_t * counts;
+};
+
+static void nearest_range(size_t begin, size_t end, void * _batch)
+{
+    struct Batch * batch = _batch;
+
+    for (size_t i = begin; i < end; i++)
+        batch->nearest[i] = nearest(batch->grid, x(batch->shapes[i]), y(batch->shapes[i]),
+            batch->shapes[i]);
+}
+
+static void count_overlaps_range(size_t begin, size_t end, void * _batch)
+{
+    struct Batch * batch = _batch;
+
+    for (size_t i = begin; i < end; i++)
+        batch->counts[i] = overlaps(batch->grid, batch->shapes[i], NULL, 0);
+}
+
+void grid_nearest_all(const void * _self, void * const * shapes, size_t n, const void ** nearest)
+{
+    struct Batch batch = { _self, shapes, nearest, NULL };
+    assert(_self && ((shapes && nearest) || !n));
+
+    parallel_for(n, GRID_QUERY_GRAIN, nearest_range, &batch);
+}
+
+void grid_overlap_counts(const void * _self, void * const * shapes, size_t n, size_t * counts)
+{
+    struct Batch batch = { _self, shapes, NULL, counts };
+    assert(_self && ((shapes && counts) || !n));
+
+    parallel_for(n, GRID_QUERY_GRAIN, count_overlaps_range, &batch);
+}
+
+/******************************************************************************
+ * GRID CLASS METHODS
+*******************************************************************************/
+
+static void * Grid_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct Grid * self = super_ctor(Grid, _self, arglist_ptr);
+    int cell_size = va_arg(*arglist_ptr, int);
+
+    self->auto_size = cell_size <= 0;
+    self->cell_size = cell_size <= 0 ? GRID_DEFAULT_CELL : cell_size;
+    vacate(self);
+    file_all(self, NULL, 0);
+
+    return self;
+}
+
+static void * Grid_dtor(void * _self)
+{
+    struct Grid * self = _self;
+
+    free_buckets(self);
+
+    return super_dtor(Grid, self);
+}
+
+static int Grid_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Grid * self = _self;
+
+    int n = buffer_print(out, "Grid at ");
+    n += buffer_print_pointer(out, _self);
+    n += buffer_print(out, ": ");
+    n += buffer_print_unsigned(out, self->count);
+    n += buffer_print(out, " objects, cell size ");
+    n += buffer_print_int(out, self->cell_size);
+    n += buffer_print(out, ", ");
+    n += buffer_print_unsigned(out, self->mask + 1);
+    return n + buffer_print(out, " buckets\n");
+}
+
+static void * Grid_copy(const void * _self)
+{
+    const struct Grid * self = _self;
+    struct Grid * replica = super_copy(Grid, self);
+    struct GridEntry * entries = gather(self);
+
+    replica->buckets = NULL;
+    replica->block = NULL;
+    file_all(replica, entries, self->count);
+    free(entries);
+
+    return replica;
+}
+
+/* A grid holds pointers to objects that live elsewhere; save the objects and
+build a new grid over them instead. */
+static int Grid_serialize(const void * _self, struct Buffer * out)
+{
+    fprintf(stderr, "Grid: cannot serialize an index, save its objects instead\n");
+
+    return -1;
+}
+
+static void * Grid_deserialize(void * _self, struct Reader * in)
+{
+    return NULL;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Grid;
+
+static atomic_int grid_once;
+
+static void buildGrid(void)
+{
+    Grid = new(
+        Class,
+        "Grid",
+        Object,
+        sizeof(struct Grid),
+        ctor, Grid_ctor,
+        dtor, Grid_dtor,
+        sputo, Grid_sputo,
+        copy, Grid_copy,
+        serialize, Grid_serialize,
+        deserialize, Grid_deserialize,
+        NULL);
+}
+
+void initGrid(void)
+{
+    initCircle();
+    class_once(&grid_once, buildGrid);
+}
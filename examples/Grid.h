@@ -0,0 +1,51 @@
+#ifndef __GRID__H__SL
+#define __GRID__H__SL
+
+#include "Object.h"
+
+/******************************************************************************
+ * SPATIAL GRID
+ * new(Grid, cell_size) creates an empty index over Points and Circles: a uniform
+ * grid of square cells, cell_size units on a side, that files each object under
+ * the cell holding its centre. Only the occupied cells take memory, so the
+ * objects can be spread out without limit. With a cell_size of 0, grid_build()
+ * picks a size from the objects it is given.
+ *
+ * A Point counts as a circle of radius 0. Range and overlap queries take the
+ * radius into account, nearest-neighbour queries go by the distance between
+ * centres. Queries may run concurrently with each other but not with changes.
+ *
+ * The grid remembers where it filed each object: an object in a grid is moved
+ * with grid_move(), or removed before and inserted again after it is moved in
+ * some other way. The grid does not own the objects.
+*******************************************************************************/
+
+extern const void * Grid;
+
+/* Replace the contents with objects[0 .. n - 1], in parallel */
+void grid_build(void * grid, void * const * objects, size_t n);
+
+void grid_insert(void * grid, const void * object);
+int grid_remove(void * grid, const void * object);     /* 0, or -1 if not there */
+void grid_move(void * grid, void * object, int dx, int dy);
+size_t grid_count(const void * grid);
+
+/* The queries return the number of objects found and store up to max of them in
+results, in no particular order. */
+size_t grid_range(const void * grid, int x0, int y0, int x1, int y1,
+    const void ** results, size_t max);
+size_t grid_overlaps(const void * grid, const void * shape, const void ** results, size_t max);
+
+/* The object whose centre is nearest to x,y, or NULL if the grid is empty */
+const void * grid_nearest(const void * grid, int x, int y);
+
+/* Batch queries, run in parallel over the shapes. nearest[i] receives the object
+nearest to shapes[i] other than shapes[i] itself, counts[i] the number of other
+objects that overlap shapes[i]. */
+void grid_nearest_all(const void * grid, void * const * shapes, size_t n, const void ** nearest);
+void grid_overlap_counts(const void * grid, void * const * shapes, size_t n, size_t * counts);
+
+/* initGrid is used to set up the class descriptor for Grid */
+void initGrid(void);
+
+#endif  /* !__GRID__H__SL */
@@ -0,0 +1,45 @@
+#ifndef __GRID_STRUCT__H__SL
+#define __GRID_STRUCT__H__SL
+
+#include <stdint.h>
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * Grid structure
+ * The cells are hashed into a power-of-two table of buckets, so a bucket can hold
+ * the entries of several cells; every entry records its cell. After grid_build()
+ * the buckets point into one block in cell order and only get storage of their
+ * own once they grow.
+*******************************************************************************/
+
+struct GridEntry
+{
+    const void * object;
+    int x, y, radius;   /* copied from the object when it was filed */
+    int cx, cy;         /* the cell */
+};
+
+struct GridBucket
+{
+    struct GridEntry * entries;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+struct Grid
+{
+    const struct Object _;
+    int cell_size;
+    int auto_size;                  /* created with a cell_size of 0 */
+    int max_radius;                 /* of any object filed since the last build */
+    int min_cx, min_cy;             /* the cells that have been occupied */
+    int max_cx, max_cy;             /* since the last build */
+    size_t count;
+    size_t mask;                    /* the number of buckets - 1 */
+    struct GridBucket * buckets;
+    struct GridEntry * block;       /* shared storage from the last build */
+    size_t block_count;
+};
+
+#endif  /* !__GRID_STRUCT__H__SL */
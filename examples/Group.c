@@ -0,0 +1,410 @@
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Group.h"
+#include "Group_struct.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "Render.h"
+#include "Buffer.h"
+
+#define GROUP_MIN_CAPACITY  4
+
+#define parent(p)   (((const struct Point *) (p))->parent)
+
+/******************************************************************************
+ * BOUNDS
+ * The boxes are added up in long long and only brought back into int range,
+ * saturating, when they are stored, so a far off child cannot wrap around.
+ *
+ * A change to one child is folded into the boxes of the groups above it as it
+ * happens, a level at a time, so that it costs nothing like going over every
+ * child again. Only a child that was on the edge of a box and moved in or
+ * left makes the group dirty, for update() to work out the box afresh.
+*******************************************************************************/
+
+static int saturate(long long value)
+{
+    return value < INT_MIN ? INT_MIN : value > INT_MAX ? INT_MAX : (int) value;
+}
+
+/* The box of a child in the coordinates of its group; -1 for an empty group */
+static int box_of(const void * child, struct Bounds * box)
+{
+    if (is_of(child, Group))
+        return group_bounds(child, box);
+
+    int r = is_of(child, Circle) && radius(child) > 0 ? radius(child) : 0;
+    *box = (struct Bounds) { saturate((long long) x(child) - r), saturate((long long) y(child) - r),
+        saturate((long long) x(child) + r), saturate((long long) y(child) + r) };
+    return 0;
+}
+
+static void update(struct Group * self)
+{
+    long long x0 = LLONG_MAX, y0 = LLONG_MAX, x1 = LLONG_MIN, y1 = LLONG_MIN;
+
+    self->empty = 1;
+    for (size_t i = 0; i < self->count; i++)
+    {
+        struct Bounds box;
+
+        if (box_of(self->children[i], &box))
+            continue;
+        x0 = box.x0 < x0 ? box.x0 : x0;
+        y0 = box.y0 < y0 ? box.y0 : y0;
+        x1 = box.x1 > x1 ? box.x1 : x1;
+        y1 = box.y1 > y1 ? box.y1 : y1;
+        self->empty = 0;
+    }
+    if (!self->empty)
+        self->local = (struct Bounds) { (int) x0, (int) y0, (int) x1, (int) y1 };
+    self->dirty = 0;
+}
+
+int group_bounds(const void * _self, struct Bounds * bounds)
+{
+    /* the cache is not part of the value of the group */
+    struct Group * self = (struct Group *) _self;
+    assert(self && bounds);
+
+    if (self->dirty)
+        update(self);
+    if (self->empty)
+        return -1;
+
+    bounds->x0 = saturate((long long) self->local.x0 + x(self));
+    bounds->y0 = saturate((long long) self->local.y0 + y(self));
+    bounds->x1 = saturate((long long) self->local.x1 + x(self));
+    bounds->y1 = saturate((long long) self->local.y1 + y(self));
+    return 0;
+}
+
+void group_touch(void * _self)
+{
+    for (struct Group * group = _self; group && !group->dirty; group = parent(group))
+        group->dirty = 1;
+}
+
+/* A child of self had the box before, if had, and now has the box after, if has.
+The other children reach every edge of local that before did not touch, so
+local only has to grow to take in after; the box of self in its own group then
+changed from one box to another, and so on up. */
+static void reshape(struct Group * self, int had, struct Bounds before, int has, struct Bounds after)
+{
+    for (; self && !self->dirty; self = parent(self))
+    {
+        const struct Bounds * local = &self->local;
+
+        if (had && (self->empty || before.x0 <= local->x0 || before.y0 <= local->y0
+            || before.x1 >= local->x1 || before.y1 >= local->y1))
+        {
+            group_touch(self);
+            return;
+        }
+        if (!has || (!self->empty && after.x0 >= local->x0 && after.y0 >= local->y0
+            && after.x1 <= local->x1 && after.y1 <= local->y1))
+            return;
+
+        had = !group_bounds(self, &before);
+        if (self->empty)
+            self->local = after;
+        else
+            self->local = (struct Bounds) {
+                after.x0 < local->x0 ? after.x0 : local->x0, after.y0 < local->y0 ? after.y0 : local->y0,
+                after.x1 > local->x1 ? after.x1 : local->x1, after.y1 > local->y1 ? after.y1 : local->y1 };
+        self->empty = 0;
+        has = !group_bounds(self, &after);
+    }
+}
+
+/******************************************************************************
+ * CHILDREN
+ * Every child knows its index in the children of its group, so that taking it
+ * out is a swap with the last one rather than a search.
+*******************************************************************************/
+
+static void append(struct Group * self, void * child)
+{
+    if (self->count == self->capacity)
+    {
+        size_t capacity = self->capacity ? 2 * self->capacity : GROUP_MIN_CAPACITY;
+        void ** children = realloc(self->children, capacity * sizeof(*children));
+        assert(children);
+        self->children = children;
+        self->capacity = capacity;
+    }
+    ((struct Point *) child)->index = self->count;
+    self->children[self->count++] = child;
+    ((struct Point *) child)->parent = self;
+    OBJECT_WRITE(child);
+}
+
+void group_add(void * _self, void * child)
+{
+    struct Group * self = _self;
+    struct Bounds box = { 0 };
+    assert(self && child && is_of(child, Point) && !parent(child));
+
+    /* a group cannot end up inside itself */
+    for (const void * ancestor = self; ancestor; ancestor = parent(ancestor))
+        assert(ancestor != child);
+
+    append(self, child);
+    /* the groups above a dirty group have to be dirty too */
+    if (is_of(child, Group) && ((struct Group *) child)->dirty)
+        group_touch(self);
+    else if (!self->dirty)
+    {
+        int has = !box_of(child, &box);
+        reshape(self, 0, box, has, box);
+    }
+}
+
+void * group_remove(void * _self, void * child)
+{
+    struct Group * self = _self;
+    struct Bounds box;
+    assert(self);
+
+    if (!child || parent(child) != self)
+        return NULL;
+
+    /* a dirty child has a dirty group, where there is nothing to reshape */
+    int had = !self->dirty && !box_of(child, &box);
+    size_t i = ((struct Point *) child)->index;
+    assert(i < self->count && self->children[i] == child);
+
+    self->children[i] = self->children[--self->count];
+    ((struct Point *) self->children[i])->index = i;
+    ((struct Point *) child)->parent = NULL;
+    if (had)
+        reshape(self, 1, box, 0, box);
+    return child;
+}
+
+void group_move(void * _child, int dx, int dy)
+{
+    struct Point * child = _child;
+    struct Group * self = child->parent;
+    struct Bounds before, after;
+    assert(self);
+
+    int had = !self->dirty && !box_of(child, &before);
+    child->x = x(child) + dx;
+    child->y = y(child) + dy;
+    if (had)
+    {
+        int has = !box_of(child, &after);
+        reshape(self, 1, before, has, after);
+    }
+}
+
+size_t group_count(const void * _self)
+{
+    const struct Group * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+void * group_child(const void * _self, size_t i)
+{
+    const struct Group * self = _self;
+    assert(self && i < self->count);
+
+    return self->children[i];
+}
+
+/******************************************************************************
+ * GROUP CLASS METHODS
+*******************************************************************************/
+
+static void * Group_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct Group * self = super_ctor(Group, _self, arglist_ptr);
+
+    self->empty = 1;
+    self->dirty = 1;
+
+    return self;
+}
+
+static void * Group_dtor(void * _self)
+{
+    struct Group * self = _self;
+
+    for (size_t i = 0; i < self->count; i++)
+    {
+        /* out of the group first, so that it does not look itself up to leave */
+        ((struct Point *) self->children[i])->parent = NULL;
+        delete(self->children[i]);
+    }
+    free(self->children);
+
+    return super_dtor(Group, self);
+}
+
+/* The group owns its children and deletes them along with itself */
+static void Group_trace(const void * _self, struct Tracer * tracer)
+{
+    const struct Group * self = _self;
+
+    for (size_t i = 0; i < self->count; i++)
+        tracer->visit(tracer, self->children[i]);
+}
+
+/* Groups are containers: equal only to themselves */
+static int Group_differ(const void * _self, const void * other)
+{
+    return _self != other;
+}
+
+static int Group_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Group * self = _self;
+
+    int n = buffer_print(out, "Group of ");
+    n += buffer_print_unsigned(out, self->count);
+    n += buffer_print(out, " at ");
+    n += buffer_print_int(out, x(self));
+    n += buffer_print(out, ",");
+    n += buffer_print_int(out, y(self));
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, _self);
+    return n + buffer_print(out, "\n");
+}
+
+/* The children are drawn in order, a run of the same class at a time */
+static void Group_draw(const void * _self)
+{
+    const struct Group * self = _self;
+
+    render_translate(x(self), y(self));
+    for (size_t i = 0, j; i < self->count; i = j)
+    {
+        for (j = i + 1; j < self->count && class_of(self->children[j]) == class_of(self->children[i]); j++)
+            ;
+        draw_all(self->children + i, j - i);
+    }
+    render_translate((int) (0u - (unsigned) x(self)), (int) (0u - (unsigned) y(self)));
+}
+
+/* A deep copy: every child is copied into the new group */
+static void * Group_copy(const void * _self)
+{
+    const struct Group * self = _self;
+    struct Group * replica = super_copy(Group, self);
+
+    replica->children = NULL;
+    replica->count = replica->capacity = 0;
+    replica->dirty = 1;
+    for (size_t i = 0; i < self->count; i++)
+    {
+        void * child = copy(self->children[i]);
+        if (!child)
+        {
+            delete(replica);
+            return NULL;
+        }
+        append(replica, child);
+    }
+    return replica;
+}
+
+/* The children are written like the elements of a Vector, each preceded by the
+name of its class since they may be of different ones. */
+static int Group_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Group * self = _self;
+
+    if (super_serialize(Group, self, out))
+        return -1;
+    buffer_put_u64(out, self->count);
+    for (size_t i = 0; i < self->count; i++)
+    {
+        const struct Class * class = class_of(self->children[i]);
+        size_t length = strlen(class->name);
+        assert(length <= UINT16_MAX);
+
+        buffer_put_u16(out, (uint16_t) length);
+        buffer_put(out, class->name, length);
+        if (serialize(self->children[i], out))
+            return -1;
+    }
+
+    return 0;
+}
+
+static void * Group_deserialize(void * _self, struct Reader * in)
+{
+    struct Group * self = super_deserialize(Group, _self, in);
+    uint64_t count;
+
+    if (!self || reader_get_u64(in, &count))
+        return NULL;
+    self->empty = 1;
+    self->dirty = 1;
+
+    /* a child takes at least the two bytes of its class name's length */
+    if (count > (uint64_t) (in->end - in->cursor) / 2 || reader_enter(in))
+        return NULL;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const struct Class * class = class_read(in, "group");
+        if (class && !is_of(class, PointClass))
+        {
+            fprintf(stderr, "%s: not a kind of Point in group\n", class->name);
+            class = NULL;
+        }
+
+        /* a failed deserialize() cleans up after itself, but leaves the memory */
+        void * memory = class ? allocate(class) : NULL;
+        void * child = memory ? deserialize(memory, in) : NULL;
+        if (!child)
+        {
+            deallocate(memory);
+            reader_leave(in);
+            Group_dtor(self);
+            return NULL;
+        }
+        append(self, child);
+    }
+    reader_leave(in);
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * Group;
+
+static atomic_int group_once;
+
+static void buildGroup(void)
+{
+    Group = new(
+        PointClass,
+        "Group",
+        Point,
+        sizeof(struct Group),
+        ctor, Group_ctor,
+        dtor, Group_dtor,
+        differ, Group_differ,
+        sputo, Group_sputo,
+        copy, Group_copy,
+        serialize, Group_serialize,
+        deserialize, Group_deserialize,
+        trace, Group_trace,
+        draw, Group_draw,
+        NULL);
+}
+
+void initGroup(void)
+{
+    initCircle();
+    class_once(&group_once, buildGroup);
+}
@@ -0,0 +1,59 @@
+#ifndef __GROUP__H__SL
+#define __GROUP__H__SL
+
+#include "Point.h"
+
+/******************************************************************************
+ * GROUPS
+ * new(Group, x, y) creates an empty Group, a Point that holds other Points,
+ * Circles and Groups. The children are placed relative to the group: x,y is
+ * the offset added to each of them, so move() on a group moves everything in
+ * it without touching the children. draw() draws the children in the order
+ * they were added, except that group_remove() moves the last child into the
+ * place it frees.
+ *
+ * A group keeps the bounding box of its children. Adding, removing and move()
+ * on a child, at any depth, update the boxes of the groups above it without
+ * going over the other children, unless the child was on the edge of a box
+ * and left it or moved in; the group then works its box out again when it is
+ * next asked for. A child changed in another way needs a group_touch() on its
+ * group.
+ *
+ * A group owns its children: deleting the group deletes them. A child has to
+ * be taken out with group_remove() before it is deleted on its own, as Points
+ * and Circles keep the dtor of Object, which lets an Arena throw them away
+ * without running anything. Children are made by new() and are in at most
+ * one group. A group is not safe to use from several threads at
+ * once, not even for group_bounds().
+*******************************************************************************/
+
+extern const void * Group;
+
+/* Inclusive, in the coordinates the group itself is placed in */
+struct Bounds
+{
+    int x0, y0, x1, y1;
+};
+
+void group_add(void * group, void * child);
+
+/* Take child out of the group and give it back to the caller, or NULL if it
+is not in the group. The last child takes its place. */
+void * group_remove(void * group, void * child);
+
+size_t group_count(const void * group);
+void * group_child(const void * group, size_t i);
+
+/* Returns 0, or -1 when there is no Point or Circle in the group at any depth */
+int group_bounds(const void * group, struct Bounds * bounds);
+
+/* Mark the bounds of group and the groups above it out of date */
+void group_touch(void * group);
+
+/* What move() does for a child that is in a group */
+void group_move(void * child, int dx, int dy);
+
+/* initGroup is used to set up the class descriptor for Group */
+void initGroup(void);
+
+#endif  /* !__GROUP__H__SL */
@@ -0,0 +1,25 @@
+#ifndef __GROUP_STRUCT__H__SL
+#define __GROUP_STRUCT__H__SL
+
+#include "Point_struct.h"
+#include "Group.h"
+
+/******************************************************************************
+ * Group structure
+*******************************************************************************/
+/* local is the bounding box of the children in their own coordinates, before
+the group's offset is added, so moving the group leaves it valid. A dirty
+group's ancestors are all dirty too, which lets group_touch() stop at the first
+one that already is. */
+struct Group
+{
+    const struct Point _;
+    void ** children;
+    size_t count;
+    size_t capacity;
+    struct Bounds local;
+    int empty;          /* nothing to bound: local means nothing */
+    int dirty;          /* local is out of date */
+};
+
+#endif  /* !__GROUP_STRUCT__H__SL */
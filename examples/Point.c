@@ -2,6 +2,16 @@
 
 #include "Point.h"
 #include "Point_struct.h"
+#include "Point_dispatch.h"
+#include "Buffer.h"
+#include "Render.h"
+#include "Group.h"
+
+#ifdef OBJECT_FAST_DISPATCH
+/* emit the external definitions of the inline selectors from Point_dispatch.h */
+extern inline void draw(const void * self);
+extern inline void super_draw(const void * class, const void * self);
+#endif
 
 /******************************************************************************
  * STATIC METHODS
@@ -10,40 +20,60 @@
 void move(void * _point, int dx, int dy)
 {
     struct Point * point = _point;
+
+    /* a group keeps the bounds of its children up to date as they move */
+    if (point->parent)
+    {
+        group_move(point, dx, dy);
+        return;
+    }
     point->x = x(point) + dx;
     point->y = y(point) + dy;
 }
 
-/******************************************************************************
- * GENERIC SELECTORS
-******************************************************************************/
-
-void draw(const void * _self)
+/* Typed constructor: fills in a Point directly instead of going through new(),
+ * ctor() and the va_list. The storage must be at least sizeof(struct Point). */
+void * Point_init(void * _self, int x, int y)
 {
-    const struct PointClass * class = class_of(_self);
+    struct Point * self = _self;
+    ((struct Object *) self)->class = Point;
+    self->x = x;
+    self->y = y;
+    self->parent = NULL;
 
-    assert(class->draw);
-    class->draw(_self);
+    return self;
 }
 
 /******************************************************************************
- * SUPERCLASS SELECTORS
+ * BATCH SELECTORS
 *******************************************************************************/
 
-void super_draw(const void * _class, const void * _self)
+static void draw_run(const void * _class, void * const * run, size_t count,
+    const size_t * positions, void * ctx)
 {
-    const struct PointClass * superclass = super(_class);
+    const struct PointClass * class = _class;
 
-    assert(_self && superclass->draw);
+    OBJECT_COUNT(class, STATS_DRAW, count);
+    if (class->draw_batch)
+        class->draw_batch(run, count);
+    else
+    {
+        assert(class->draw);
+        for (size_t i = 0; i < count; i++)
+            class->draw(run[i]);
+    }
+}
 
-    superclass->draw(_self);
+void draw_all(void * const * objects, size_t n)
+{
+    batch_by_class(objects, n, draw_run, NULL);
 }
 
 /******************************************************************************
  * POINT CLASS METHODS
 *******************************************************************************/
 
-static void * Point_ctor(void * _self, va_list * arglist_ptr)
+void * Point_ctor(void * _self, va_list * arglist_ptr)
 {
     struct Point * self = super_ctor(Point, _self, arglist_ptr);
 
@@ -53,68 +83,145 @@ static void * Point_ctor(void * _self, va_list * arglist_ptr)
     return self;
 }
 
-static void Point_draw(const void * _self)
+/* The copy is in no group */
+void * Point_copy(const void * _self)
+{
+    struct Point * replica = super_copy(Point, _self);
+
+    replica->parent = NULL;
+
+    return replica;
+}
+
+/* Points are values: equal when they are of the same class at the same place.
+ * The coordinates are compared without branches, as the batch kernels do. */
+int Point_differ(const void * _self, const void * other)
 {
     const struct Point * self = _self;
 
-    printf("\".\" at %d,%d\n", self->x, self->y);
+    if (self == other)
+        return 0;
+    if (class_of(self) != class_of(other))
+        return 1;
+    return ((self->x ^ x(other)) | (self->y ^ y(other))) != 0;
+}
+
+size_t Point_hash(const void * _self)
+{
+    const struct Point * self = _self;
+
+    return hash_combine(hash_combine(0, (unsigned) self->x), (unsigned) self->y);
+}
+
+/* Point at x,y at address */
+int Point_sputo(const void * _self, struct Buffer * out)
+{
+    const struct Point * self = _self;
+
+    int n = buffer_print(out, ((const struct Class *) class_of(self))->name);
+    n += buffer_print(out, " at ");
+    n += buffer_print_int(out, self->x);
+    n += buffer_print(out, ",");
+    n += buffer_print_int(out, self->y);
+    n += buffer_print(out, " at ");
+    n += buffer_print_pointer(out, self);
+    return n + buffer_print(out, "\n");
+}
+
+void Point_draw(const void * _self)
+{
+    const struct Point * self = _self;
+    struct DrawCommand command = { DRAW_POINT, self->x, self->y, 0, 0 };
+
+    render_commands(&command, 1);
+}
+
+int Point_serialize(const void * _self, struct Buffer * out)
+{
+    const struct Point * self = _self;
+
+    if (super_serialize(Point, self, out))
+        return -1;
+    buffer_put_int(out, self->x);
+    buffer_put_int(out, self->y);
+
+    return 0;
+}
+
+void * Point_deserialize(void * _self, struct Reader * in)
+{
+    struct Point * self = super_deserialize(Point, _self, in);
+
+    if (!self || reader_get_int(in, &self->x) || reader_get_int(in, &self->y))
+        return NULL;
+
+    return self;
+}
+
+/* Hand the renderer a run of commands at a time instead of one per point */
+void Point_draw_batch(void * const * objects, size_t n)
+{
+    struct DrawCommand commands[256];
+
+    for (size_t done = 0; done < n; )
+    {
+        size_t count = n - done < 256 ? n - done : 256;
+        for (size_t i = 0; i < count; i++)
+        {
+            const void * point = objects[done + i];
+            commands[i] = (struct DrawCommand) { DRAW_POINT, x(point), y(point), 0, 0 };
+        }
+        render_commands(commands, count);
+        done += count;
+    }
 }
 
 /******************************************************************************
  * POINTCLASS METACLASS
 *******************************************************************************/
-/* Call class constructor to create a list of dynamically linked methods of ctor,
- * dtor, differ and puto. Then add the draw function pointer to the draw spot
- * on the PointClass descriptor we're working on. (refer to Point_struct.h for
- * the full PointClass struct. However it is just an extension of the Class struct
- * since it only has one Class struct member and then a pointer for the draw method) */
+/* The class constructor binds all of the methods, draw and draw_all included, since
+ * initPoint declares their slots on the PointClass descriptor. (refer to Point_struct.h
+ * for the full PointClass struct. However it is just an extension of the Class struct
+ * since it only has one Class struct member and then pointers for the draw methods)
+ * What is left is that a draw_batch inherited from the superclass only knows how to
+ * draw the superclass, so it is dropped when a class overrides draw without also
+ * binding draw_all. A static class of PointClass has to see to that itself. */
 
 static void * PointClass_ctor(void * _self, va_list * arglist_ptr)
 {
     struct PointClass * self = super_ctor(PointClass, _self, arglist_ptr);
+    const struct PointClass * super = (const void *) self->_.super;
 
-    typedef void (*funcptr)();
-    funcptr selector;
-
-    va_list cpy_arglist;
-    va_copy(cpy_arglist, *arglist_ptr);
-
-    while ((selector = va_arg(cpy_arglist, funcptr)))
-    {
-        funcptr method = va_arg(cpy_arglist, funcptr);
-        if (selector == (funcptr) draw)
-            *(funcptr*) &self->draw = method;
-    }
-    va_end(cpy_arglist);
+    if (is_of(super, PointClass) && self->draw != super->draw && self->draw_batch == super->draw_batch)
+        self->draw_batch = NULL;
     return self;
 }
 
 /******************************************************************************
  * INITIALIZATION
+ * The descriptors are constants. What is left to do at run time is to declare the
+ * slots of PointClass, for the classes that new() makes of it, and to register the
+ * classes by name.
 *******************************************************************************/
 
-const void * PointClass;
-const void * Point;
+CLASS_STATIC(PointClass, Class, Class, POINTCLASS_ID,
+    Class_METHODS(),
+    .ctor = PointClass_ctor);
+
+CLASS_STATIC(Point, PointClass, Object, POINT_ID,
+    Point_METHODS());
+
+static atomic_int point_once;
+
+static void registerPoint(void)
+{
+    class_slot(PointClass, (selector_fn) draw, offsetof(struct PointClass, draw));
+    class_slot(PointClass, (selector_fn) draw_all, offsetof(struct PointClass, draw_batch));
+    class_register(PointClass);
+    class_register(Point);
+}
 
 void initPoint(void)
 {
-    if (!PointClass)
-    {
-        PointClass = new(
-            Class,
-            "PointClass",
-            Class,
-            sizeof(struct PointClass),
-            ctor, PointClass_ctor, NULL);
-    }
-    if (!Point)
-    {
-        Point = new(
-            PointClass,
-            "Point",
-            Object,
-            sizeof(struct Point),
-            ctor, Point_ctor,
-            draw, Point_draw, NULL);
-    }
-}
\ No newline at end of file
+    class_once(&point_once, registerPoint);
+}
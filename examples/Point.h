@@ -3,17 +3,28 @@
 
 #include "Object.h"
 
-extern const void * Point;
+extern const void * const Point;
 
 /* New methods */
 
+#ifdef OBJECT_FAST_DISPATCH
+#include "Point_struct.h"
+#else
 void draw(const void * self);
+#endif
 void move(void * point, int dx, int dy);
 
-/* initPoint is used to set up the class descriptors for Point class */
+/* draw() every object in the array, grouped by class */
+void draw_all(void * const * objects, size_t n);
+
+/* Construct a Point in place without the variadic ctor chain */
+void * Point_init(void * point, int x, int y);
+
+/* initPoint registers Point and PointClass by name and declares the slots of
+PointClass; the descriptors themselves are static */
 void initPoint(void);
 
-extern const void * PointClass;
+extern const void * const PointClass;
 
 #endif  /* !__POINT__H__SL */
 
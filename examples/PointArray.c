@@ -0,0 +1,464 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "PointArray.h"
+#include "PointArray_struct.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+#include "Buffer.h"
+
+/* a view has to be able to hold the largest element type */
+typedef char view_holds_a_circle[sizeof(struct PointView) >= sizeof(struct Circle) ? 1 : -1];
+
+/******************************************************************************
+ * ALIGNED STORAGE
+ * The pointer returned by malloc() is stashed just in front of the aligned block.
+*******************************************************************************/
+
+static int * aligned_ints(size_t n)
+{
+    char * raw = malloc(n * sizeof(int) + POINTARRAY_ALIGN + sizeof(void *));
+    assert(raw);
+
+    uintptr_t start = (uintptr_t) (raw + sizeof(void *));
+    int * block = (int *) ((start + POINTARRAY_ALIGN - 1) & ~(uintptr_t) (POINTARRAY_ALIGN - 1));
+    ((void **) block)[-1] = raw;
+
+    return block;
+}
+
+static void aligned_free(int * block)
+{
+    if (block)
+        free(((void **) block)[-1]);
+}
+
+/* A new block of capacity ints that starts with the count of block, if any. The
+lanes past count are zeroed, since the kernels go over them too. */
+static int * aligned_copy(const int * block, size_t count, size_t capacity)
+{
+    int * copy = aligned_ints(capacity);
+
+    if (block)
+        memcpy(copy, block, count * sizeof(int));
+    memset(copy + count, 0, (capacity - count) * sizeof(int));
+
+    return copy;
+}
+
+static int * aligned_resize(int * block, size_t count, size_t capacity)
+{
+    int * grown = aligned_copy(block, count, capacity);
+    aligned_free(block);
+
+    return grown;
+}
+
+static void reserve(struct PointArray * self, size_t capacity)
+{
+    if (capacity <= self->capacity)
+        return;
+    capacity = (capacity + POINTARRAY_LANES - 1) / POINTARRAY_LANES * POINTARRAY_LANES;
+
+    self->x = aligned_resize(self->x, self->count, capacity);
+    self->y = aligned_resize(self->y, self->count, capacity);
+    if (self->radius)
+        self->radius = aligned_resize(self->radius, self->count, capacity);
+    self->capacity = capacity;
+}
+
+/******************************************************************************
+ * COPY ON WRITE
+ * copy() gives the copy the same coordinate arrays and counts their owners. The
+ * first change to a shared array makes it take a private copy, so copies that are
+ * only read never copy anything.
+*******************************************************************************/
+
+static int * copy_ints(const int * block, size_t count, size_t capacity)
+{
+    if (!block)
+        return NULL;
+    return aligned_copy(block, count, capacity);
+}
+
+/**
+ * @brief Stop sharing the arrays. Returns 1 if self was their last owner, in which
+ *        case the caller has to free them.
+ */
+static int disown(struct PointArray * self)
+{
+    atomic_size_t * owners = self->owners;
+
+    self->owners = NULL;
+    if (atomic_fetch_sub_explicit(owners, 1, memory_order_acq_rel) != 1)
+        return 0;
+    free(owners);
+    return 1;
+}
+
+/**
+ * @brief Make sure self is the only owner of its arrays. Called before every change.
+ */
+static void own(struct PointArray * self)
+{
+    if (!self->owners)
+        return;
+    if (atomic_load_explicit(self->owners, memory_order_acquire) == 1)
+    {
+        /* the other owners are gone already */
+        free(self->owners);
+        self->owners = NULL;
+        return;
+    }
+
+    int * x = self->x, * y = self->y, * radius = self->radius;
+    self->x = copy_ints(x, self->count, self->capacity);
+    self->y = copy_ints(y, self->count, self->capacity);
+    self->radius = copy_ints(radius, self->count, self->capacity);
+    /* the others may have let go while we were copying */
+    if (disown(self))
+    {
+        aligned_free(x);
+        aligned_free(y);
+        aligned_free(radius);
+    }
+}
+
+/******************************************************************************
+ * KERNELS
+ * Lengths are multiples of POINTARRAY_LANES and the arrays are aligned, so the
+ * vector loops use aligned loads and have no remainder. Arithmetic wraps around
+ * on overflow in every variant, just like the SIMD instructions do.
+*******************************************************************************/
+
+static void add_ints(int * values, size_t n, int delta)
+{
+#if defined(__AVX2__)
+    const __m256i d = _mm256_set1_epi32(delta);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256i * v = (__m256i *) (values + i);
+        _mm256_store_si256(v, _mm256_add_epi32(_mm256_load_si256(v), d));
+    }
+#elif defined(__SSE2__)
+    const __m128i d = _mm_set1_epi32(delta);
+    for (size_t i = 0; i < n; i += 4)
+    {
+        __m128i * v = (__m128i *) (values + i);
+        _mm_store_si128(v, _mm_add_epi32(_mm_load_si128(v), d));
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+        values[i] = (int) ((unsigned) values[i] + (unsigned) delta);
+#endif
+}
+
+#if !defined(__AVX2__) && defined(__SSE2__)
+/* SSE2 has no 32-bit low multiply (that is SSE4.1), so build one from two 32x32->64
+multiplies of the even and the odd lanes */
+static __m128i mullo_epi32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+static void mul_ints(int * values, size_t n, int factor)
+{
+#if defined(__AVX2__)
+    const __m256i f = _mm256_set1_epi32(factor);
+    for (size_t i = 0; i < n; i += 8)
+    {
+        __m256i * v = (__m256i *) (values + i);
+        _mm256_store_si256(v, _mm256_mullo_epi32(_mm256_load_si256(v), f));
+    }
+#elif defined(__SSE2__)
+    const __m128i f = _mm_set1_epi32(factor);
+    for (size_t i = 0; i < n; i += 4)
+    {
+        __m128i * v = (__m128i *) (values + i);
+        _mm_store_si128(v, mullo_epi32(_mm_load_si128(v), f));
+    }
+#else
+    for (size_t i = 0; i < n; i++)
+        values[i] = (int) ((unsigned) values[i] * (unsigned) factor);
+#endif
+}
+
+static size_t padded(const struct PointArray * self)
+{
+    return (self->count + POINTARRAY_LANES - 1) / POINTARRAY_LANES * POINTARRAY_LANES;
+}
+
+/**
+ * @brief Translate every element by dx, dy.
+ */
+void move_all(void * _self, int dx, int dy)
+{
+    struct PointArray * self = _self;
+    assert(self);
+
+    own(self);
+    add_ints(self->x, padded(self), dx);
+    add_ints(self->y, padded(self), dy);
+}
+
+/**
+ * @brief Scale every element about the origin. Radii are scaled by the magnitude
+ *        of factor, which wraps around like the rest for INT_MIN.
+ */
+void scale_all(void * _self, int factor)
+{
+    struct PointArray * self = _self;
+    assert(self);
+
+    own(self);
+    mul_ints(self->x, padded(self), factor);
+    mul_ints(self->y, padded(self), factor);
+    if (self->radius)
+        mul_ints(self->radius, padded(self), (int) (factor < 0 ? 0u - (unsigned) factor : (unsigned) factor));
+}
+
+/******************************************************************************
+ * ELEMENT ACCESS
+*******************************************************************************/
+
+size_t points_count(const void * _self)
+{
+    const struct PointArray * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+/**
+ * @brief Append the coordinates (and for a CircleArray the radius) of a Point or
+ *        Circle. A plain Point appended to a CircleArray gets radius 0.
+ *
+ * @return size_t the index of the new element
+ */
+size_t points_append(void * _self, const void * point)
+{
+    struct PointArray * self = _self;
+    assert(self && point);
+
+    own(self);
+    if (self->count == self->capacity)
+        reserve(self, self->capacity ? 2 * self->capacity : POINTARRAY_LANES);
+
+    size_t i = self->count++;
+    self->x[i] = x(point);
+    self->y[i] = y(point);
+    if (self->radius)
+        self->radius[i] = is_of(point, Circle) ? radius(point) : 0;
+
+    return i;
+}
+
+/**
+ * @brief Build a Point (or a Circle for a CircleArray) for element i in view.
+ *
+ * @return void* the view, ready for draw(), puto() or move()
+ */
+void * points_view(const void * _self, size_t i, struct PointView * view)
+{
+    const struct PointArray * self = _self;
+    assert(self && view && i < self->count);
+
+    if (self->radius)
+        return Circle_init(view, self->x[i], self->y[i], self->radius[i]);
+    return Point_init(view, self->x[i], self->y[i]);
+}
+
+/**
+ * @brief Overwrite element i with the coordinates of point, typically a view that
+ *        has been moved.
+ */
+void points_store(void * _self, size_t i, const void * point)
+{
+    struct PointArray * self = _self;
+    assert(self && point && i < self->count);
+
+    own(self);
+    self->x[i] = x(point);
+    self->y[i] = y(point);
+    if (self->radius && is_of(point, Circle))
+        self->radius[i] = radius(point);
+}
+
+/******************************************************************************
+ * POINTARRAY CLASS METHODS
+*******************************************************************************/
+
+static void * PointArray_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct PointArray * self = super_ctor(PointArray, _self, arglist_ptr);
+
+    reserve(self, va_arg(*arglist_ptr, size_t));
+
+    return self;
+}
+
+static void * PointArray_dtor(void * _self)
+{
+    struct PointArray * self = _self;
+
+    if (!self->owners || disown(self))
+    {
+        aligned_free(self->x);
+        aligned_free(self->y);
+        aligned_free(self->radius);
+    }
+    return super_dtor(PointArray, self);
+}
+
+static void * PointArray_copy(const void * _self)
+{
+    /* the owner count is bookkeeping rather than part of the array's value, so it
+    is set up here even though self is const. Of several threads cloning the same
+    array, the first to publish a count wins and the others count on it. */
+    struct PointArray * self = (struct PointArray *) _self;
+    atomic_size_t * owners = atomic_load_explicit(&self->owners, memory_order_acquire);
+
+    if (!owners)
+    {
+        atomic_size_t * fresh = malloc(sizeof(*fresh));
+        assert(fresh);
+        atomic_init(fresh, 1);
+        if (atomic_compare_exchange_strong_explicit(&self->owners, &owners, fresh,
+            memory_order_acq_rel, memory_order_acquire))
+            owners = fresh;
+        else
+            free(fresh);
+    }
+    atomic_fetch_add_explicit(owners, 1, memory_order_relaxed);
+
+    /* the flat copy shares the arrays and the owner count */
+    struct PointArray * replica = super_copy(PointArray, self);
+    atomic_store_explicit(&replica->owners, owners, memory_order_relaxed);
+
+    return replica;
+}
+
+static void put_ints(struct Buffer * out, const int * values, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        buffer_put_int(out, values[i]);
+}
+
+static int get_ints(struct Reader * in, int * values, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (reader_get_int(in, values + i))
+            return -1;
+    return 0;
+}
+
+/* Written as: u32 1 if there is a radius array, u64 count, then the x, y and
+ * radius arrays one after the other. */
+static int PointArray_serialize(const void * _self, struct Buffer * out)
+{
+    const struct PointArray * self = _self;
+
+    if (super_serialize(PointArray, self, out))
+        return -1;
+    buffer_put_u32(out, self->radius != NULL);
+    buffer_put_u64(out, self->count);
+    put_ints(out, self->x, self->count);
+    put_ints(out, self->y, self->count);
+    if (self->radius)
+        put_ints(out, self->radius, self->count);
+
+    return 0;
+}
+
+static void * PointArray_deserialize(void * _self, struct Reader * in)
+{
+    struct PointArray * self = super_deserialize(PointArray, _self, in);
+    uint32_t has_radius;
+    uint64_t count;
+
+    if (!self || reader_get_u32(in, &has_radius) || reader_get_u64(in, &count))
+        return NULL;
+    /* refuse counts the input cannot possibly hold before allocating for them */
+    size_t arrays = has_radius ? 3 : 2;
+    if (count > (uint64_t) (in->end - in->cursor) / (4 * arrays))
+        return NULL;
+
+    reserve(self, count ? count : POINTARRAY_LANES);
+    if (has_radius)
+        self->radius = aligned_copy(NULL, 0, self->capacity);
+    self->count = count;
+
+    if (get_ints(in, self->x, count) || get_ints(in, self->y, count)
+        || (has_radius && get_ints(in, self->radius, count)))
+    {
+        PointArray_dtor(self);
+        return NULL;
+    }
+    return self;
+}
+
+/******************************************************************************
+ * CIRCLEARRAY CLASS METHODS
+*******************************************************************************/
+
+static void * CircleArray_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct PointArray * self = super_ctor(CircleArray, _self, arglist_ptr);
+
+    /* from here on reserve() grows the radius array along with x and y */
+    if (!self->capacity)
+        reserve(self, POINTARRAY_LANES);
+    self->radius = aligned_copy(NULL, 0, self->capacity);
+
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * PointArray;
+const void * CircleArray;
+
+static atomic_int point_array_once;
+
+static void buildPointArray(void)
+{
+    PointArray = new(
+        Class,
+        "PointArray",
+        Object,
+        sizeof(struct PointArray),
+        ctor, PointArray_ctor,
+        dtor, PointArray_dtor,
+        serialize, PointArray_serialize,
+        deserialize, PointArray_deserialize,
+        copy, PointArray_copy,
+        NULL);
+    CircleArray = new(
+        Class,
+        "CircleArray",
+        PointArray,
+        sizeof(struct PointArray),
+        ctor, CircleArray_ctor,
+        NULL);
+}
+
+void initPointArray(void)
+{
+    initCircle();
+    class_once(&point_array_once, buildPointArray);
+}
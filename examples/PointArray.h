@@ -0,0 +1,37 @@
+#ifndef __POINTARRAY__H__SL
+#define __POINTARRAY__H__SL
+
+#include "Object.h"
+
+/* new(PointArray, (size_t) capacity) and new(CircleArray, (size_t) capacity)
+create empty arrays that grow as points are appended. copy() is cheap: the
+copy shares the coordinates until either array is changed. */
+extern const void * PointArray;
+extern const void * CircleArray;
+
+/* Storage for the Point or Circle that points_view() builds */
+struct PointView
+{
+    const void * class;
+    int x, y;
+    void * parent;
+    size_t index;
+    int radius;
+};
+
+size_t points_count(const void * array);
+size_t points_append(void * array, const void * point);
+
+/* A view is a stand-alone copy of element i that works with draw(), puto() and
+the other selectors. Write it back with points_store() after changing it. */
+void * points_view(const void * array, size_t i, struct PointView * view);
+void points_store(void * array, size_t i, const void * point);
+
+/* Vectorised kernels over every element */
+void move_all(void * array, int dx, int dy);
+void scale_all(void * array, int factor);
+
+/* initPointArray is used to set up the class descriptors for both arrays */
+void initPointArray(void);
+
+#endif  /* !__POINTARRAY__H__SL */
@@ -0,0 +1,31 @@
+#ifndef __POINTARRAY_STRUCT__H__SL
+#define __POINTARRAY_STRUCT__H__SL
+
+#include "Object_struct.h"
+
+/******************************************************************************
+ * PointArray structure
+*******************************************************************************/
+/* Coordinates are kept as separate arrays (structure of arrays) so that a kernel
+over all points streams through memory instead of chasing one pointer per
+point. The arrays are POINTARRAY_ALIGN-byte aligned and their capacity is a
+multiple of POINTARRAY_LANES, so the vector kernels never need a scalar tail.
+radius is only allocated for CircleArray. After copy() the arrays are shared
+and owners counts the arrays sharing them; it is NULL while they are not. It is
+atomic because copy() sets it up on a const array, which several threads may
+copy at once. */
+#define POINTARRAY_ALIGN    32
+#define POINTARRAY_LANES    8
+
+struct PointArray
+{
+    const struct Object _;
+    size_t count;
+    size_t capacity;
+    int * x;
+    int * y;
+    int * radius;
+    _Atomic(atomic_size_t *) owners;
+};
+
+#endif  /* !__POINTARRAY_STRUCT__H__SL */
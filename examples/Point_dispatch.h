@@ -0,0 +1,35 @@
+#ifndef __POINT_DISPATCH__H__SL
+#define __POINT_DISPATCH__H__SL
+
+/* Selectors added by PointClass. Like Object_dispatch.h, this file is included by
+Point.c in the checked build and by Point_struct.h with OBJECT_FAST_DISPATCH. */
+
+#include "Point_struct.h"
+
+/******************************************************************************
+ * GENERIC SELECTORS
+******************************************************************************/
+
+OBJECT_SELECTOR void draw(const void * _self)
+{
+    const struct PointClass * class = class_of(_self);
+
+    OBJECT_CHECK(class->draw);
+    OBJECT_COUNT(class, STATS_DRAW, 1);
+    class->draw(_self);
+}
+
+/******************************************************************************
+ * SUPERCLASS SELECTORS
+*******************************************************************************/
+
+OBJECT_SELECTOR void super_draw(const void * _class, const void * _self)
+{
+    const struct PointClass * superclass = super(_class);
+
+    OBJECT_CHECK(_self && superclass->draw);
+
+    superclass->draw(_self);
+}
+
+#endif  /* !__POINT_DISPATCH__H__SL */
@@ -11,6 +11,8 @@ struct Point
 {
     const struct Object _;
     int x, y;
+    void * parent;      /* the Group the point is in, if any */
+    size_t index;       /* its place among the children of parent */
 };
 
 #define  x(p)  (((const struct Point *) (p))->x)
@@ -25,10 +27,53 @@ struct PointClass
 {
     const struct Class _;
     void (*draw) (const void * self);
+    /* optional: draw a run of objects of this class at once, bound with draw_all */
+    void (*draw_batch) (void * const * objects, size_t n);
 };
 
 /* Make the super_draw method visible so that subclass of this class can call it */
+#ifdef OBJECT_FAST_DISPATCH
+#include "Point_dispatch.h"
+#else
 void super_draw(const void * class, const void * self);
+#endif
+
+#define draw_as(class, self)  (((const struct PointClass *) (class))->draw(self))
+
+/******************************************************************************
+ * Static descriptors
+*******************************************************************************/
+/* PointClass, Point and Circle are defined with CLASS_STATIC (see Object_struct.h),
+so that classes derived from them at compile time can start from their methods. */
+enum
+{
+    POINTCLASS_ID = 2,
+    POINT_ID,
+    CIRCLE_ID
+};
+
+extern const struct Class PointClass_descriptor;
+extern const struct PointClass Point_descriptor;
+
+void * Point_ctor(void * self, va_list * arg_ptr);
+int Point_differ(const void * self, const void * other);
+size_t Point_hash(const void * self);
+int Point_sputo(const void * self, struct Buffer * out);
+void * Point_copy(const void * self);
+int Point_serialize(const void * self, struct Buffer * out);
+void * Point_deserialize(void * self, struct Reader * in);
+void Point_draw(const void * self);
+void Point_draw_batch(void * const * objects, size_t n);
+
+#define PointClass_ANCESTORS    Class_ANCESTORS, CLASS_ANCESTOR(PointClass)
+#define PointClass_BASE         ._
+
+#define Point_ANCESTORS         Object_ANCESTORS, CLASS_ANCESTOR(Point)
+#define Point_METHODS(at) \
+    Object_METHODS(at._), at._.ctor = Point_ctor, at._.differ = Point_differ, \
+    at._.hash = Point_hash, at._.sputo = Point_sputo, at._.copy = Point_copy, \
+    at._.serialize = Point_serialize, at._.deserialize = Point_deserialize, \
+    at.draw = Point_draw, at.draw_batch = Point_draw_batch
 
 #endif  /* !__POINT_STRUCT__H__SL */
 
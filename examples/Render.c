@@ -0,0 +1,345 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Render.h"
+#include "Render_struct.h"
+#include "Buffer.h"
+
+#define COMMANDS_MIN_CAPACITY   64
+
+/* draw() sends its commands here; NULL means text on stdout */
+static _Thread_local void * target;
+/* and moves them by this much first */
+static _Thread_local int offset_x, offset_y;
+
+/******************************************************************************
+ * STATIC METHODS
+*******************************************************************************/
+
+void render(void * _self, const struct DrawCommand * commands, size_t n)
+{
+    const struct RendererClass * class = class_of(_self);
+    assert(class->render && (commands || !n));
+
+    class->render(_self, commands, n);
+}
+
+void * render_target(void * renderer)
+{
+    void * previous = target;
+
+    target = renderer;
+    return previous;
+}
+
+/******************************************************************************
+ * TEXT
+ * The lines are formatted into a local buffer so that a batch costs one fwrite()
+ * per few hundred commands instead of one printf() each.
+*******************************************************************************/
+
+static void render_text(FILE * file_ptr, const struct DrawCommand * commands, size_t n)
+{
+    char buffer[4096];
+    size_t used = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        const struct DrawCommand * command = commands + i;
+
+        /* the longest line, for a circle with every number at INT_MIN, is 53 characters */
+        if (sizeof(buffer) - used < 64)
+        {
+            fwrite(buffer, 1, used, file_ptr);
+            used = 0;
+        }
+        if (command->kind == DRAW_CIRCLE)
+            used += snprintf(buffer + used, sizeof(buffer) - used, "Circle at %d,%d radius %d\n",
+                command->x, command->y, command->radius);
+        else
+            used += snprintf(buffer + used, sizeof(buffer) - used, "\".\" at %d,%d\n",
+                command->x, command->y);
+    }
+    fwrite(buffer, 1, used, file_ptr);
+}
+
+static void deliver(const struct DrawCommand * commands, size_t n)
+{
+    if (target)
+        render(target, commands, n);
+    else
+        render_text(stdout, commands, n);
+}
+
+static int wrap_add(int a, int b)
+{
+    return (int) ((unsigned) a + (unsigned) b);
+}
+
+void render_translate(int dx, int dy)
+{
+    offset_x = wrap_add(offset_x, dx);
+    offset_y = wrap_add(offset_y, dy);
+}
+
+void render_commands(const struct DrawCommand * commands, size_t n)
+{
+    if (!offset_x && !offset_y)
+    {
+        deliver(commands, n);
+        return;
+    }
+
+    struct DrawCommand moved[256];
+    for (size_t done = 0; done < n; )
+    {
+        size_t count = n - done < 256 ? n - done : 256;
+        for (size_t i = 0; i < count; i++)
+        {
+            moved[i] = commands[done + i];
+            moved[i].x = wrap_add(moved[i].x, offset_x);
+            moved[i].y = wrap_add(moved[i].y, offset_y);
+        }
+        deliver(moved, count);
+        done += count;
+    }
+}
+
+/******************************************************************************
+ * COMMAND BUFFERS
+*******************************************************************************/
+
+static void reserve(struct CommandBuffer * self, size_t capacity)
+{
+    if (capacity <= self->capacity)
+        return;
+
+    struct DrawCommand * commands = realloc(self->commands, capacity * sizeof(*commands));
+    assert(commands);
+    self->commands = commands;
+    self->capacity = capacity;
+}
+
+size_t commands_count(const void * _self)
+{
+    const struct CommandBuffer * self = _self;
+    assert(self);
+
+    return self->count;
+}
+
+const struct DrawCommand * commands_data(const void * _self)
+{
+    const struct CommandBuffer * self = _self;
+    assert(self);
+
+    return self->commands;
+}
+
+void commands_clear(void * _self)
+{
+    struct CommandBuffer * self = _self;
+    assert(self);
+
+    self->count = 0;
+}
+
+void commands_ink(void * _self, uint32_t color)
+{
+    struct CommandBuffer * self = _self;
+    assert(self);
+
+    self->ink = color & 0xFFFFFF;
+}
+
+/******************************************************************************
+ * TEXTRENDERER CLASS METHODS
+*******************************************************************************/
+
+static void * TextRenderer_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct TextRenderer * self = super_ctor(TextRenderer, _self, arglist_ptr);
+
+    self->file_ptr = va_arg(*arglist_ptr, FILE *);
+    assert(self->file_ptr);
+
+    return self;
+}
+
+static void TextRenderer_render(void * _self, const struct DrawCommand * commands, size_t n)
+{
+    struct TextRenderer * self = _self;
+
+    render_text(self->file_ptr, commands, n);
+}
+
+/* A stream cannot be written to a buffer; make a new TextRenderer instead */
+static int TextRenderer_serialize(const void * _self, struct Buffer * out)
+{
+    fprintf(stderr, "TextRenderer: cannot serialize a stream\n");
+
+    return -1;
+}
+
+static void * TextRenderer_deserialize(void * _self, struct Reader * in)
+{
+    return NULL;
+}
+
+/******************************************************************************
+ * COMMANDBUFFER CLASS METHODS
+*******************************************************************************/
+
+static void * CommandBuffer_ctor(void * _self, va_list * arglist_ptr)
+{
+    struct CommandBuffer * self = super_ctor(CommandBuffer, _self, arglist_ptr);
+    size_t capacity = va_arg(*arglist_ptr, size_t);
+
+    self->ink = 0xFFFFFF;
+    reserve(self, capacity ? capacity : COMMANDS_MIN_CAPACITY);
+
+    return self;
+}
+
+static void * CommandBuffer_dtor(void * _self)
+{
+    struct CommandBuffer * self = _self;
+
+    free(self->commands);
+
+    return super_dtor(CommandBuffer, self);
+}
+
+static void CommandBuffer_render(void * _self, const struct DrawCommand * commands, size_t n)
+{
+    struct CommandBuffer * self = _self;
+
+    if (self->count + n > self->capacity)
+    {
+        size_t capacity = self->capacity;
+        while (capacity < self->count + n)
+            capacity *= 2;
+        reserve(self, capacity);
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        struct DrawCommand * command = self->commands + self->count++;
+        *command = commands[i];
+        command->color = self->ink;
+    }
+}
+
+static void * CommandBuffer_copy(const void * _self)
+{
+    const struct CommandBuffer * self = _self;
+    struct CommandBuffer * replica = super_copy(CommandBuffer, self);
+
+    replica->commands = malloc(self->capacity * sizeof(*replica->commands));
+    assert(replica->commands);
+    memcpy(replica->commands, self->commands, self->count * sizeof(*replica->commands));
+
+    return replica;
+}
+
+static int CommandBuffer_serialize(const void * _self, struct Buffer * out)
+{
+    const struct CommandBuffer * self = _self;
+
+    if (super_serialize(CommandBuffer, self, out))
+        return -1;
+    buffer_put_u32(out, self->ink);
+    buffer_put_u64(out, self->count);
+    for (size_t i = 0; i < self->count; i++)
+    {
+        const struct DrawCommand * command = self->commands + i;
+        buffer_put_int(out, command->kind);
+        buffer_put_int(out, command->x);
+        buffer_put_int(out, command->y);
+        buffer_put_int(out, command->radius);
+        buffer_put_u32(out, command->color);
+    }
+
+    return 0;
+}
+
+static void * CommandBuffer_deserialize(void * _self, struct Reader * in)
+{
+    struct CommandBuffer * self = super_deserialize(CommandBuffer, _self, in);
+    uint64_t count;
+
+    /* a command takes 20 bytes; refuse counts the input cannot hold */
+    if (!self || reader_get_u32(in, &self->ink) || reader_get_u64(in, &count)
+        || count > (uint64_t) (in->end - in->cursor) / 20)
+        return NULL;
+
+    reserve(self, count ? count : COMMANDS_MIN_CAPACITY);
+    for (self->count = 0; self->count < count; self->count++)
+    {
+        struct DrawCommand * command = self->commands + self->count;
+        if (reader_get_int(in, &command->kind) || reader_get_int(in, &command->x)
+            || reader_get_int(in, &command->y) || reader_get_int(in, &command->radius)
+            || reader_get_u32(in, &command->color))
+        {
+            CommandBuffer_dtor(self);
+            return NULL;
+        }
+    }
+    return self;
+}
+
+/******************************************************************************
+ * INITIALIZATION
+*******************************************************************************/
+
+const void * RendererClass;
+const void * Renderer;
+const void * TextRenderer;
+const void * CommandBuffer;
+
+static atomic_int render_once;
+
+static void buildRender(void)
+{
+    RendererClass = new(
+        Class,
+        "RendererClass",
+        Class,
+        sizeof(struct RendererClass),
+        NULL);
+    class_slot(RendererClass, (selector_fn) render, offsetof(struct RendererClass, render));
+    /* abstract: renders nothing itself */
+    Renderer = new(
+        RendererClass,
+        "Renderer",
+        Object,
+        sizeof(struct Object),
+        NULL);
+    TextRenderer = new(
+        RendererClass,
+        "TextRenderer",
+        Renderer,
+        sizeof(struct TextRenderer),
+        ctor, TextRenderer_ctor,
+        serialize, TextRenderer_serialize,
+        deserialize, TextRenderer_deserialize,
+        render, TextRenderer_render,
+        NULL);
+    CommandBuffer = new(
+        RendererClass,
+        "CommandBuffer",
+        Renderer,
+        sizeof(struct CommandBuffer),
+        ctor, CommandBuffer_ctor,
+        dtor, CommandBuffer_dtor,
+        copy, CommandBuffer_copy,
+        serialize, CommandBuffer_serialize,
+        deserialize, CommandBuffer_deserialize,
+        render, CommandBuffer_render,
+        NULL);
+}
+
+void initRender(void)
+{
+    class_once(&render_once, buildRender);
+}
@@ -0,0 +1,69 @@
+#ifndef __RENDER__H__SL
+#define __RENDER__H__SL
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "Object.h"
+
+/******************************************************************************
+ * RENDERING
+ * draw() does not print by itself: the draw methods describe what they draw as
+ * commands and hand them to the renderer that is current on the calling thread.
+ * Renderers are objects of a RendererClass, which adds the render selector:
+ *
+ *   TextRenderer   new(TextRenderer, file) prints a line per command, the output
+ *                  draw() has always had. With no renderer set, draw() prints to
+ *                  stdout this way.
+ *   CommandBuffer  new(CommandBuffer, (size_t) capacity) records the commands,
+ *                  for canvas_rasterize() (see Canvas.h) to turn into pixels.
+ *
+ *   void * commands = new(CommandBuffer, (size_t) 0);
+ *   void * previous = render_target(commands);
+ *   draw_all(objects, n);
+ *   render_target(previous);
+*******************************************************************************/
+
+enum DrawKind
+{
+    DRAW_POINT,     /* a single pixel at x,y */
+    DRAW_CIRCLE     /* a filled disc around x,y */
+};
+
+struct DrawCommand
+{
+    int kind;
+    int x, y, radius;
+    uint32_t color;     /* 0xRRGGBB, set by the command buffer from its ink */
+};
+
+extern const void * RendererClass;
+extern const void * Renderer;
+extern const void * TextRenderer;
+extern const void * CommandBuffer;
+
+/* Selector: take n commands, in drawing order */
+void render(void * renderer, const struct DrawCommand * commands, size_t n);
+
+/* Make renderer the one draw() uses on this thread; NULL restores the text
+output to stdout. Returns the renderer that was current before. */
+void * render_target(void * renderer);
+
+/* Send commands to the current renderer; this is what the draw methods call */
+void render_commands(const struct DrawCommand * commands, size_t n);
+
+/* Move everything drawn on this thread from now on by dx,dy, on top of the
+translation already in effect. A Group draws its children through this, and
+undoes it with render_translate(-dx, -dy) when done. Coordinates wrap around. */
+void render_translate(int dx, int dy);
+
+/* The commands recorded so far; the color of those recorded from now on */
+size_t commands_count(const void * buffer);
+const struct DrawCommand * commands_data(const void * buffer);
+void commands_clear(void * buffer);
+void commands_ink(void * buffer, uint32_t color);
+
+/* initRender is used to set up the class descriptors for the renderers */
+void initRender(void);
+
+#endif  /* !__RENDER__H__SL */
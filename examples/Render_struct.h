@@ -0,0 +1,36 @@
+#ifndef __RENDER_STRUCT__H__SL
+#define __RENDER_STRUCT__H__SL
+
+#include "Object_struct.h"
+#include "Render.h"
+
+/******************************************************************************
+ * RendererClass metaclass
+*******************************************************************************/
+
+struct RendererClass
+{
+    const struct Class _;
+    void (*render) (void * self, const struct DrawCommand * commands, size_t n);
+};
+
+/******************************************************************************
+ * Renderer structures
+*******************************************************************************/
+
+struct TextRenderer
+{
+    const struct Object _;
+    FILE * file_ptr;
+};
+
+struct CommandBuffer
+{
+    const struct Object _;
+    struct DrawCommand * commands;
+    size_t count;
+    size_t capacity;
+    uint32_t ink;
+};
+
+#endif  /* !__RENDER_STRUCT__H__SL */
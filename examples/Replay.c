@@ -0,0 +1,572 @@
+#include <assert.h>     /* for assert() */
+#include <errno.h>      /* for errno */
+#include <string.h>     /* for memchr(), memcmp(), memmove() */
+#include <stdlib.h>     /* for malloc(), realloc(), free() */
+#include <stdint.h>     /* for uint32_t */
+#include <limits.h>     /* for INT_MIN, INT_MAX */
+#include <pthread.h>    /* for pthread_create() */
+#include <fcntl.h>      /* for open() */
+
+#ifndef _WIN32
+#include <unistd.h>     /* for read(), close() */
+#include <sys/mman.h>   /* for mmap() */
+#include <sys/stat.h>   /* for fstat() */
+#else
+#include <io.h>         /* for read(), close() */
+#endif
+
+#include "Replay.h"
+#include "Circle.h"
+#include "Buffer.h"
+#include "Object_struct.h"
+
+#define REPLAY_BATCH    4096    /* commands handed over at a time */
+#define REPLAY_BATCHES  4       /* parsed ahead of the executing thread */
+#define REPLAY_WINDOW   65536   /* bytes read from a descriptor at a time */
+
+struct Command
+{
+    unsigned char op;   /* 0 for a line with no command on it */
+    uint32_t id;
+    int args[3];
+};
+
+/* The numbers a command takes after the id, or -1 for no command */
+static int arity(unsigned char op)
+{
+    switch (op)
+    {
+    case 'p': case 'm':
+        return 2;
+    case 'c':
+        return 3;
+    case 'd': case 'x':
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/******************************************************************************
+ * INPUT
+ * A mapped file is all there at once. A descriptor is read into a window that
+ * the parser consumes from the front; what is left of it moves to the start of
+ * the window before the next read.
+*******************************************************************************/
+
+struct Source
+{
+    const unsigned char * data;
+    size_t length;      /* bytes in data */
+    size_t offset;      /* bytes consumed */
+    size_t before;      /* bytes consumed before data, for messages */
+    int fd;             /* -1 once there is nothing more to read */
+    unsigned char * window;
+};
+
+/* Read more. Returns 0 at the end of the input. */
+static int refill(struct Source * source)
+{
+    if (source->fd < 0)
+        return 0;
+
+    memmove(source->window, source->data + source->offset, source->length - source->offset);
+    source->before += source->offset;
+    source->length -= source->offset;
+    source->offset = 0;
+
+    long got;
+    do
+        got = read(source->fd, source->window + source->length, REPLAY_WINDOW - source->length);
+    while (got < 0 && errno == EINTR);
+    if (got <= 0)
+    {
+        source->fd = -1;
+        return 0;
+    }
+    source->length += got;
+    return 1;
+}
+
+/******************************************************************************
+ * PARSING
+ * The parsers take the bytes from p to end and return how many of them make up
+ * the next command, 0 if that needs bytes that are still to be read, or -1 if
+ * the command is malformed. final says that no more bytes will come.
+*******************************************************************************/
+
+static const unsigned char * skip_blanks(const unsigned char * p, const unsigned char * end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static const unsigned char * parse_number(const unsigned char * p, const unsigned char * end,
+    long long min, long long max, long long * value)
+{
+    int negative = 0;
+
+    p = skip_blanks(p, end);
+    if (p < end && *p == '-')
+    {
+        negative = 1;
+        p++;
+    }
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+
+    long long magnitude = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        magnitude = 10 * magnitude + (*p - '0');
+        if (magnitude > max - min)
+            return NULL;
+    }
+    *value = negative ? -magnitude : magnitude;
+    return *value >= min && *value <= max && (p == end || *p == ' ' || *p == '\t' || *p == '\r'
+        || *p == '#') ? p : NULL;
+}
+
+static long parse_text(const unsigned char * p, const unsigned char * end, int final,
+    struct Command * command)
+{
+    const unsigned char * eol = memchr(p, '\n', end - p);
+
+    if (!eol)
+    {
+        if (!final)
+            return 0;
+        eol = end;
+    }
+
+    long length = (long) (eol - p) + (eol < end);
+    const unsigned char * cursor = skip_blanks(p, eol);
+    command->op = 0;
+    if (cursor == eol || *cursor == '#')
+        return length;
+
+    command->op = *cursor++;
+    int n = arity(command->op);
+    long long value;
+    if (n < 0 || !(cursor = parse_number(cursor, eol, 0, REPLAY_MAX_ID - 1, &value)))
+        return -1;
+    command->id = (uint32_t) value;
+    for (int i = 0; i < n; i++)
+    {
+        if (!(cursor = parse_number(cursor, eol, INT_MIN, INT_MAX, &value)))
+            return -1;
+        command->args[i] = (int) value;
+    }
+    cursor = skip_blanks(cursor, eol);
+    return cursor == eol || *cursor == '#' ? length : -1;
+}
+
+static long parse_binary(const unsigned char * p, const unsigned char * end, int final,
+    struct Command * command)
+{
+    int n = arity(*p);
+
+    if (n < 0)
+        return -1;
+    if (end - p < 5 + 4 * n)
+        return final ? -1 : 0;
+
+    struct Reader in = { p + 1, end, 0 };
+    command->op = *p;
+    reader_get_u32(&in, &command->id);
+    for (int i = 0; i < n; i++)
+        reader_get_int(&in, command->args + i);
+    return command->id < REPLAY_MAX_ID ? 5 + 4 * n : -1;
+}
+
+/******************************************************************************
+ * PIPELINE
+ * The parsing thread fills batches in a ring and the executing thread empties
+ * them, each waiting only when the ring is full or empty.
+*******************************************************************************/
+
+struct Batch
+{
+    size_t count;
+    struct Command commands[REPLAY_BATCH];
+};
+
+struct Pipe
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    size_t parsed;      /* batches filled */
+    size_t executed;    /* batches emptied */
+    int finished;       /* the parser has filled its last batch */
+    int failed;         /* because of a malformed command */
+    int stopped;        /* the executor wants no more */
+    struct Source source;
+    int binary;
+    size_t lines;       /* of text consumed */
+    struct Batch batches[REPLAY_BATCHES];
+};
+
+/* Returns 1 with the batch full, 0 at the end of the input, -1 on an error */
+static int fill(struct Pipe * pipe, struct Batch * batch)
+{
+    struct Source * source = &pipe->source;
+
+    batch->count = 0;
+    while (batch->count < REPLAY_BATCH)
+    {
+        if (source->offset == source->length && !refill(source))
+            return 0;
+
+        struct Command * command = batch->commands + batch->count;
+        const unsigned char * p = source->data + source->offset, * end = source->data + source->length;
+        long length = pipe->binary ? parse_binary(p, end, source->fd < 0, command)
+            : parse_text(p, end, source->fd < 0, command);
+
+        if (length == 0)
+        {
+            if (source->offset == 0 && source->length == REPLAY_WINDOW)
+                length = -1;    /* a line longer than the window */
+            else
+            {
+                refill(source);
+                continue;
+            }
+        }
+        if (length < 0)
+        {
+            if (pipe->binary)
+                fprintf(stderr, "replay: byte %zu: malformed record\n", source->before + source->offset);
+            else
+                fprintf(stderr, "replay: line %zu: malformed command\n", pipe->lines + 1);
+            return -1;
+        }
+        source->offset += length;
+        pipe->lines++;
+        if (command->op)
+            batch->count++;
+    }
+    return 1;
+}
+
+static void * parse_all(void * _pipe)
+{
+    struct Pipe * pipe = _pipe;
+    struct Source * source = &pipe->source;
+
+    while (source->length - source->offset < 4 && refill(source))
+        ;
+    pipe->binary = source->length - source->offset >= 4
+        && !memcmp(source->data + source->offset, REPLAY_MAGIC, 4);
+    if (pipe->binary)
+        source->offset += 4;
+
+    for (int status = 1; status > 0; )
+    {
+        pthread_mutex_lock(&pipe->lock);
+        while (pipe->parsed - pipe->executed == REPLAY_BATCHES && !pipe->stopped)
+            pthread_cond_wait(&pipe->changed, &pipe->lock);
+        int stopped = pipe->stopped;
+        pthread_mutex_unlock(&pipe->lock);
+        if (stopped)
+            break;
+
+        status = fill(pipe, pipe->batches + pipe->parsed % REPLAY_BATCHES);
+
+        pthread_mutex_lock(&pipe->lock);
+        pipe->parsed++;
+        pipe->finished = status <= 0;
+        pipe->failed = status < 0;
+        pthread_cond_broadcast(&pipe->changed);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ * EXECUTION
+ * Objects are found by id in a table that grows to the highest id used. Deleted
+ * objects are torn down with dtor() and their memory kept, one list per class,
+ * for Point_init() and Circle_init() to build the next one in.
+*******************************************************************************/
+
+struct World
+{
+    void ** objects;
+    size_t capacity;
+    void ** spares[2];  /* Points and Circles */
+    size_t spare_count[2];
+    size_t spare_capacity[2];
+    struct ReplayStats * stats;
+};
+
+static void * make(struct World * world, const struct Command * command)
+{
+    int circle = command->op == 'c';
+    void * memory = world->spare_count[circle] ? world->spares[circle][--world->spare_count[circle]] : NULL;
+
+    if (memory)
+        world->stats->reused++;
+    else
+        world->stats->created++;
+    if (circle)
+        return memory ? Circle_init(memory, command->args[0], command->args[1], command->args[2])
+            : new(Circle, command->args[0], command->args[1], command->args[2]);
+    return memory ? Point_init(memory, command->args[0], command->args[1])
+        : new(Point, command->args[0], command->args[1]);
+}
+
+static void spare(struct World * world, void * object)
+{
+    int circle = is_a(object, Circle);
+
+    dtor(object);
+    if (world->spare_count[circle] == world->spare_capacity[circle])
+    {
+        size_t capacity = world->spare_capacity[circle] ? 2 * world->spare_capacity[circle] : 64;
+        void ** spares = realloc(world->spares[circle], capacity * sizeof(*spares));
+        assert(spares);
+        world->spares[circle] = spares;
+        world->spare_capacity[circle] = capacity;
+    }
+    world->spares[circle][world->spare_count[circle]++] = object;
+}
+
+static int execute(struct World * world, const struct Command * command)
+{
+    void * object = command->id < world->capacity ? world->objects[command->id] : NULL;
+    size_t number = world->stats->commands + 1;
+
+    if (command->op == 'p' || command->op == 'c')
+    {
+        if (object)
+        {
+            fprintf(stderr, "replay: command %zu: object %u exists\n", number, command->id);
+            return -1;
+        }
+        if (command->id >= world->capacity)
+        {
+            size_t capacity = world->capacity ? world->capacity : 1024;
+            while (capacity <= command->id)
+                capacity *= 2;
+            void ** objects = realloc(world->objects, capacity * sizeof(*objects));
+            assert(objects);
+            memset(objects + world->capacity, 0, (capacity - world->capacity) * sizeof(*objects));
+            world->objects = objects;
+            world->capacity = capacity;
+        }
+        world->objects[command->id] = make(world, command);
+    }
+    else if (!object)
+    {
+        fprintf(stderr, "replay: command %zu: no object %u\n", number, command->id);
+        return -1;
+    }
+    else if (command->op == 'm')
+        move(object, command->args[0], command->args[1]);
+    else if (command->op == 'd')
+        draw(object);
+    else
+    {
+        spare(world, object);
+        world->objects[command->id] = NULL;
+    }
+
+    world->stats->commands++;
+    return 0;
+}
+
+static int run(struct Source * source, struct ReplayStats * stats)
+{
+    struct ReplayStats ignored;
+    struct World world = { NULL, 0, { NULL, NULL }, { 0, 0 }, { 0, 0 }, stats ? stats : &ignored };
+    struct Pipe * pipe = calloc(1, sizeof(*pipe));
+    pthread_t parser;
+    int result = 0;
+
+    assert(pipe);
+    *world.stats = (struct ReplayStats) { 0 };
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->changed, NULL);
+    pipe->source = *source;
+    if (pthread_create(&parser, NULL, parse_all, pipe))
+    {
+        fprintf(stderr, "replay: cannot start the parser\n");
+        free(pipe);
+        return -1;
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pipe->lock);
+        while (pipe->executed == pipe->parsed && !pipe->finished)
+            pthread_cond_wait(&pipe->changed, &pipe->lock);
+        int empty = pipe->executed == pipe->parsed;
+        pthread_mutex_unlock(&pipe->lock);
+        if (empty)
+            break;
+
+        const struct Batch * batch = pipe->batches + pipe->executed % REPLAY_BATCHES;
+        for (size_t i = 0; i < batch->count && !result; i++)
+            result = execute(&world, batch->commands + i);
+
+        pthread_mutex_lock(&pipe->lock);
+        pipe->executed++;
+        pipe->stopped = result < 0;
+        pthread_cond_broadcast(&pipe->changed);
+        pthread_mutex_unlock(&pipe->lock);
+        if (result)
+            break;
+    }
+    pthread_join(parser, NULL);
+    if (pipe->failed)
+        result = -1;
+
+    for (size_t i = 0; i < world.capacity; i++)
+        delete(world.objects[i]);
+    for (int k = 0; k < 2; k++)
+    {
+        for (size_t i = 0; i < world.spare_count[k]; i++)
+            deallocate(world.spares[k][i]);
+        free(world.spares[k]);
+    }
+    free(world.objects);
+    pthread_cond_destroy(&pipe->changed);
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe);
+
+    return result;
+}
+
+int replay_fd(int fd, struct ReplayStats * stats)
+{
+    unsigned char * window = malloc(REPLAY_WINDOW);
+    struct Source source = { window, 0, 0, 0, fd, window };
+    assert(window);
+
+    int result = run(&source, stats);
+    free(window);
+    return result;
+}
+
+int replay_file(const char * path, struct ReplayStats * stats)
+{
+    int fd = open(path, O_RDONLY);
+    int result;
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "replay: cannot open %s\n", path);
+        return -1;
+    }
+#ifndef _WIN32
+    struct stat status;
+    void * data;
+    if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0
+        && (data = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED)
+    {
+#ifdef MADV_SEQUENTIAL
+        madvise(data, status.st_size, MADV_SEQUENTIAL);
+#endif
+        struct Source source = { data, status.st_size, 0, 0, -1, NULL };
+        result = run(&source, stats);
+        munmap(data, status.st_size);
+    }
+    else
+#endif
+        /* no mapping: stream it like a pipe */
+        result = replay_fd(fd, stats);
+    close(fd);
+
+    return result;
+}
+
+/******************************************************************************
+ * GENERATION
+ * Creates make up a fifth of the commands, moves two fifths, draws three tenths
+ * and deletes the rest, always on objects that exist. The ids of deleted
+ * objects are used again, so the ids stay dense.
+*******************************************************************************/
+
+static unsigned next_random(unsigned * seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+int replay_generate(FILE * file_ptr, size_t count, unsigned seed, int binary)
+{
+    uint32_t * live = NULL, * free_ids = NULL;
+    size_t live_count = 0, free_count = 0, capacity = 0;
+    uint32_t next_id = 0;
+    struct Buffer out = { 0 };
+
+    assert(file_ptr);
+    if (binary)
+        buffer_put(&out, REPLAY_MAGIC, 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        unsigned roll = next_random(&seed) % 10;
+        struct Command command;
+        size_t which = 0;
+
+        if (!live_count || (roll < 2 && (free_count || next_id < REPLAY_MAX_ID)))
+        {
+            if (live_count == capacity)
+            {
+                capacity = capacity ? 2 * capacity : 1024;
+                live = realloc(live, capacity * sizeof(*live));
+                free_ids = realloc(free_ids, capacity * sizeof(*free_ids));
+                assert(live && free_ids);
+            }
+            command.op = next_random(&seed) % 2 ? 'p' : 'c';
+            command.id = free_count ? free_ids[--free_count] : next_id++;
+            live[live_count++] = command.id;
+            for (int a = 0; a < 3; a++)
+                command.args[a] = (int) (next_random(&seed) % 2001) - 1000;
+            command.args[2] = 1 + (command.args[2] + 1000) % 50;
+        }
+        else
+        {
+            which = next_random(&seed) % live_count;
+            command.op = roll < 6 ? 'm' : roll < 9 ? 'd' : 'x';
+            command.id = live[which];
+            command.args[0] = (int) (next_random(&seed) % 21) - 10;
+            command.args[1] = (int) (next_random(&seed) % 21) - 10;
+            if (command.op == 'x')
+            {
+                free_ids[free_count++] = command.id;
+                live[which] = live[--live_count];
+            }
+        }
+
+        int n = arity(command.op);
+        if (binary)
+        {
+            buffer_put(&out, &command.op, 1);
+            buffer_put_u32(&out, command.id);
+            for (int a = 0; a < n; a++)
+                buffer_put_int(&out, command.args[a]);
+        }
+        else
+        {
+            unsigned char * line = buffer_reserve(&out, 48);
+            int length = sprintf((char *) line, "%c %u", command.op, (unsigned) command.id);
+            for (int a = 0; a < n; a++)
+                length += sprintf((char *) line + length, " %d", command.args[a]);
+            line[length++] = '\n';
+            out.length += length;
+        }
+        if (out.length >= REPLAY_WINDOW)
+        {
+            fwrite(out.data, 1, out.length, file_ptr);
+            out.length = 0;
+        }
+    }
+    fwrite(out.data, 1, out.length, file_ptr);
+
+    buffer_free(&out);
+    free(live);
+    free(free_ids);
+    return fflush(file_ptr) || ferror(file_ptr) ? -1 : 0;
+}
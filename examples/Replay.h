@@ -0,0 +1,52 @@
+#ifndef __REPLAY__H__SL
+#define __REPLAY__H__SL
+
+#include <stdio.h>
+#include <stddef.h>
+
+/******************************************************************************
+ * COMMAND STREAMS
+ * A stream of commands on Points and Circles, named by numbers the stream picks
+ * (ids below REPLAY_MAX_ID), for replaying a recorded workload or generating
+ * load. In text, one command per line, with # starting a comment:
+ *
+ *   p id x y        create a Point
+ *   c id x y r      create a Circle
+ *   m id dx dy      move()
+ *   d id            draw()
+ *   x id            delete
+ *
+ * The binary form starts with the four bytes REPLAY_MAGIC, followed by records
+ * of the command letter as one byte and its numbers as 32-bit little-endian
+ * integers, in the order above.
+ *
+ * One thread parses the stream into batches while the calling thread executes
+ * the batches already parsed. The memory of deleted objects is kept and reused
+ * by the next object of the same class, so a long replay allocates no more than
+ * the most objects it has alive at a time. Objects still alive at the end of the
+ * stream are deleted.
+*******************************************************************************/
+
+#define REPLAY_MAGIC    "OOCB"
+#define REPLAY_MAX_ID   (1u << 24)
+
+struct ReplayStats
+{
+    size_t commands;    /* executed */
+    size_t created;     /* objects made with new() */
+    size_t reused;      /* objects built in the memory of a deleted one */
+};
+
+/* Replay the stream read from a file descriptor, such as 0 for stdin */
+int replay_fd(int fd, struct ReplayStats * stats);
+
+/* Replay a file, mapped into memory when the system allows it */
+int replay_file(const char * path, struct ReplayStats * stats);
+
+/* Both return 0, or -1 after a message on stderr when the stream is malformed or
+names an object that does not exist; the commands before it have been run. */
+
+/* Write a valid stream of count random commands, the same for the same seed */
+int replay_generate(FILE * file_ptr, size_t count, unsigned seed, int binary);
+
+#endif  /* !__REPLAY__H__SL */
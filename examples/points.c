@@ -1,6 +1,41 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "Point.h"
 #include "Circle.h"
+#include "Replay.h"
+
+/* usage: points [p | c]...                        draw a Point or Circle per argument
+ *        points --replay [FILE]                   run a command stream, see Replay.h,
+ *                                                 from FILE or, without one or with -,
+ *                                                 from stdin
+ *        points --generate N [SEED] [--binary]    write a stream of N random commands */
+static int stream(char ** argv)
+{
+    if (!strcmp(argv[0], "--replay"))
+    {
+        struct ReplayStats stats = { 0 };
+        int result = argv[1] && strcmp(argv[1], "-") ? replay_file(argv[1], &stats) : replay_fd(0, &stats);
+
+        fflush(stdout);
+        fprintf(stderr, "%zu commands, %zu objects created, %zu reused\n",
+            stats.commands, stats.created, stats.reused);
+        return result ? 1 : 0;
+    }
+    if (!strcmp(argv[0], "--generate") && argv[1])
+    {
+        int binary = 0;
+        unsigned seed = 1;
+        for (char ** arg = argv + 2; *arg; arg++)
+            if (!strcmp(*arg, "--binary"))
+                binary = 1;
+            else
+                seed = (unsigned) strtoul(*arg, NULL, 10);
+        return replay_generate(stdout, strtoull(argv[1], NULL, 10), seed, binary) ? 1 : 0;
+    }
+    fprintf(stderr, "points: unknown option %s\n", argv[0]);
+    return 2;
+}
 
 int main(int argc, char ** argv)
 {
@@ -9,6 +44,9 @@ int main(int argc, char ** argv)
     initPoint();
     initCircle();
 
+    if (argc > 1 && !strncmp(argv[1], "--", 2))
+        return stream(argv + 1);
+
     while (*++argv)
     {
         switch (**argv)
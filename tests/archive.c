@@ -0,0 +1,143 @@
+/* Objects written to an archive and read back, including containers nested in
+ * one another, and input that is cut short, nested too deeply or altered, which
+ * has to come back as NULL rather than crash. */
+#include <string.h>
+
+#include "test.h"
+#include "Archive.h"
+#include "Buffer.h"
+#include "Vector.h"
+#include "Group.h"
+#include "Circle.h"
+#include "PointArray.h"
+#include "Circle_struct.h"
+
+static void ** load(const struct Buffer * archive, size_t length, size_t * count)
+{
+    return read_archive(archive->data, length, count);
+}
+
+static unsigned char * find(const struct Buffer * archive, const char * text)
+{
+    size_t length = strlen(text);
+
+    for (size_t i = 0; i + length <= archive->length; i++)
+        if (memcmp(archive->data + i, text, length) == 0)
+            return archive->data + i;
+    return NULL;
+}
+
+static void free_all(void ** objects, size_t count)
+{
+    while (count)
+        delete(objects[--count]);
+    free(objects);
+}
+
+/* An archive of one container nested depth deep: a Group of Groups, or a
+Vector of Vectors, with a Point at the bottom */
+static void nested(struct Buffer * out, const void * class, int depth)
+{
+    void * outer, * inner;
+
+    if (class == Group)
+    {
+        outer = inner = new(Group, 0, 0);
+        for (int i = 1; i < depth; i++)
+        {
+            void * group = new(Group, 1, 1);
+            group_add(inner, group);
+            inner = group;
+        }
+        group_add(inner, new(Point, 3, 4));
+    }
+    else
+    {
+        outer = inner = new(Vector, Vector, (size_t) 1);
+        for (int i = 1; i < depth; i++)
+            inner = vector_append(inner, i + 1 < depth ? Vector : Point, (size_t) 1);
+    }
+    CHECK(write_archive(out, &outer, 1) == 0);
+    delete(outer);
+}
+
+static int loads(const void * class, int depth)
+{
+    struct Buffer out = { 0 };
+    size_t count;
+
+    nested(&out, class, depth);
+    void ** objects = load(&out, out.length, &count);
+    if (objects)
+        free_all(objects, count);
+    buffer_free(&out);
+    return objects != NULL;
+}
+
+int main(void)
+{
+    initGroup();
+    initVector();
+    initPointArray();
+
+    /* a round trip */
+    void * group = new(Group, 10, 20);
+    group_add(group, new(Point, 1, 2));
+    group_add(group, new(Circle, -3, 4, 5));
+    void * vector = new(Vector, Circle, (size_t) 0);
+    vector_append(vector, 7, 8, 9);
+    vector_append(vector, -7, -8, 1);
+    void * array = new(CircleArray, (size_t) 0);
+    struct PointView view;
+    for (int i = 0; i < 20; i++)
+        points_append(array, Circle_init(&view, i, -i, i % 3));
+    void * objects[] = { new(Point, 5, 6), new(Circle, 1, 1, 1), group, vector, array };
+    size_t n = sizeof(objects) / sizeof(objects[0]);
+
+    struct Buffer out = { 0 };
+    CHECK(write_archive(&out, objects, n) == 0);
+    size_t count;
+    void ** back = load(&out, out.length, &count);
+    CHECK(back && count == n);
+    CHECK(!differ(back[0], objects[0]) && !differ(back[1], objects[1]));
+    struct Bounds before, after;
+    CHECK(group_count(back[2]) == 2 && group_bounds(group, &before) == 0 && group_bounds(back[2], &after) == 0);
+    CHECK(memcmp(&before, &after, sizeof(before)) == 0);
+    CHECK(vector_count(back[3]) == 2 && !differ(vector_at(back[3], 1), vector_at(vector, 1)));
+    CHECK(points_count(back[4]) == 20 && radius(points_view(back[4], 14, &view)) == 2);
+    free_all(back, count);
+
+    /* every truncation fails */
+    for (size_t length = 0; length < out.length; length++)
+        CHECK(!load(&out, length, &count));
+
+    /* a class of classes is not an object to load */
+    unsigned char * name = find(&out, "Point");
+    CHECK(name && name[-2] == 5);
+    memcpy(name, "Class", 5);
+    CHECK(!load(&out, out.length, &count));
+    buffer_free(&out);
+
+    /* containers nest as deep as READER_MAX_DEPTH and no deeper */
+    CHECK(loads(Group, 200) && loads(Group, READER_MAX_DEPTH));
+    CHECK(!loads(Group, READER_MAX_DEPTH + 1) && !loads(Group, 5000));
+    CHECK(loads(Vector, READER_MAX_DEPTH) && !loads(Vector, READER_MAX_DEPTH + 1));
+
+    /* a count the input cannot hold, for elements that write nothing */
+    void * empty = new(Vector, Object, (size_t) 0);
+    for (int i = 0; i < 5; i++)
+        vector_append(empty);
+    CHECK(write_archive(&out, &empty, 1) == 0);
+    back = load(&out, out.length, &count);
+    CHECK(back && vector_count(back[0]) == 5);
+    free_all(back, count);
+    uint64_t huge = (uint64_t) 1 << 40;
+    memcpy(out.data + out.length - 5 - sizeof(huge), &huge, sizeof(huge));
+    CHECK(!load(&out, out.length, &count));
+    buffer_free(&out);
+
+    delete(empty);
+    for (size_t i = 0; i < n; i++)
+        delete(objects[i]);
+    return 0;
+}
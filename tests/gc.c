@@ -0,0 +1,75 @@
+/* A collection in small steps while the program keeps changing the scene: what
+ * the roots reach survives, including what is made while a cycle runs, and the
+ * rest is reclaimed once the cycle that found it completes. */
+#include "test.h"
+#include "Collector.h"
+#include "Group.h"
+#include "Circle.h"
+
+#define GROUPS  20
+#define LEAVES  50
+
+int main(void)
+{
+#ifndef OBJECT_GC
+    return TEST_SKIP;
+#else
+    initGroup();
+
+    static void * scene;
+    gc_root(&scene);
+    scene = new(Group, 0, 0);
+    for (int g = 0; g < GROUPS; g++)
+    {
+        void * group = new(Group, g, 0);
+        for (int i = 0; i < LEAVES; i++)
+            group_add(group, new(Circle, i, g, 1));
+        group_add(scene, group);
+    }
+
+    /* garbage: nothing refers to it */
+    for (int i = 0; i < 1000; i++)
+        new(Point, i, i);
+
+    struct GcStats stats;
+    gc_stats(&stats);
+    size_t reclaimed = stats.reclaimed;
+
+    /* step through a cycle, adding to the scene between the steps */
+    int steps = 0, done = 0;
+    while (!done)
+    {
+        done = gc_step(64);
+        void * group = group_child(scene, (size_t) steps % GROUPS);
+        group_add(group, new(Point, steps, steps));
+        steps++;
+        CHECK(steps < 100000);
+    }
+    CHECK(steps > 1);
+
+    /* a second cycle sees everything the first one left */
+    gc_collect();
+    gc_stats(&stats);
+    CHECK(stats.reclaimed - reclaimed >= 1000);
+    CHECK(!stats.collecting);
+
+    size_t leaves = 0;
+    for (int g = 0; g < GROUPS; g++)
+    {
+        const void * group = group_child(scene, (size_t) g);
+        CHECK(is_a(group, Group));
+        leaves += group_count(group);
+    }
+    CHECK(leaves == (size_t) (GROUPS * LEAVES + steps));
+
+    /* dropping the root gives the whole scene back */
+    scene = NULL;
+    size_t objects = stats.objects;
+    CHECK(gc_collect() >= leaves + GROUPS + 1);
+    gc_stats(&stats);
+    CHECK(stats.objects <= objects - leaves - GROUPS - 1);
+    gc_unroot(&scene);
+
+    return 0;
+#endif
+}
@@ -0,0 +1,100 @@
+/* The bounds a Group keeps up to date as children are added, removed and moved
+ * against the ones worked out from scratch, which a copy does since it starts
+ * out dirty. The changes are random, over a small tree of nested groups. */
+#include "test.h"
+#include "Group.h"
+#include "Point.h"
+#include "Circle.h"
+#include "Point_struct.h"
+
+#define GROUPS      8
+#define LEAVES      400
+#define STEPS       200000
+
+static unsigned long long state = 1;
+
+static int random_below(int n)
+{
+    state = state * 6364136223846793005u + 1442695040888963407u;
+    return (int) ((state >> 33) % (unsigned) n);
+}
+
+static void check_bounds(const void * group)
+{
+    void * fresh = copy(group);
+    struct Bounds kept, worked_out;
+
+    int empty = group_bounds(group, &kept);
+    CHECK(group_bounds(fresh, &worked_out) == empty);
+    CHECK(empty || (kept.x0 == worked_out.x0 && kept.y0 == worked_out.y0
+        && kept.x1 == worked_out.x1 && kept.y1 == worked_out.y1));
+    delete(fresh);
+}
+
+int main(void)
+{
+    initGroup();
+
+    void * root = new(Group, 0, 0);
+    void * groups[GROUPS];
+    for (int g = 0; g < GROUPS; g++)
+    {
+        groups[g] = new(Group, random_below(50), random_below(50));
+        group_add(g ? groups[random_below(g)] : root, groups[g]);
+    }
+
+    void * leaves[LEAVES];
+    int count = 0;
+    for (int step = 0; step < STEPS; step++)
+    {
+        switch (random_below(4))
+        {
+        case 0:
+            if (count < LEAVES)
+            {
+                int x = random_below(1000) - 500, y = random_below(1000) - 500;
+                void * leaf = random_below(2) ? new(Point, x, y) : new(Circle, x, y, random_below(30));
+                group_add(groups[random_below(GROUPS)], leaf);
+                leaves[count++] = leaf;
+            }
+            break;
+        case 1:
+            if (count)
+            {
+                int i = random_below(count);
+                void * leaf = leaves[i];
+                CHECK(group_remove(((struct Point *) leaf)->parent, leaf) == leaf);
+                delete(leaf);
+                leaves[i] = leaves[--count];
+            }
+            break;
+        case 2:
+            if (count)
+                move(leaves[random_below(count)], random_below(41) - 20, random_below(41) - 20);
+            break;
+        default:
+            move(groups[random_below(GROUPS)], random_below(21) - 10, random_below(21) - 10);
+        }
+        if (step % 7 == 0)
+        {
+            check_bounds(root);
+            check_bounds(groups[random_below(GROUPS)]);
+        }
+    }
+
+    /* children are taken out by swapping in the last one */
+    void * big = new(Group, 0, 0);
+    for (int i = 0; i < LEAVES; i++)
+        group_add(big, leaves[i] = new(Point, i, i));
+    for (int i = 0; i < LEAVES; i++)
+    {
+        CHECK(group_remove(big, leaves[i]) == leaves[i]);
+        CHECK(group_remove(big, leaves[i]) == NULL);
+        delete(leaves[i]);
+        CHECK(group_count(big) == (size_t) (LEAVES - i - 1));
+    }
+    delete(big);
+    delete(root);
+
+    return 0;
+}
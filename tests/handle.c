@@ -0,0 +1,79 @@
+/* Handles going stale when their object is deleted, slots being reused under a
+ * new generation, and compaction moving the objects without changing what the
+ * handles name. */
+#include "test.h"
+#include "HandleTable.h"
+#include "Circle.h"
+#include "Circle_struct.h"
+
+#define OBJECTS 1000
+
+int main(void)
+{
+    initHandleTable();
+    initCircle();
+
+    void * table = new(HandleTable, (size_t) 0);
+    struct Handle handles[OBJECTS];
+    for (int i = 0; i < OBJECTS; i++)
+        handles[i] = i % 2 ? handle_new(table, Circle, i, -i, i % 10) : handle_adopt(table, new(Point, i, -i));
+    CHECK(handle_count(table) == OBJECTS);
+    CHECK(!handle_get(table, HANDLE_NONE));
+
+    /* every third one goes, and its handle with it */
+    for (int i = 0; i < OBJECTS; i += 3)
+    {
+        CHECK(handle_delete(table, handles[i]) == 0);
+        CHECK(handle_delete(table, handles[i]) == -1);
+        CHECK(!handle_get(table, handles[i]));
+    }
+
+    /* a reused slot does not answer to the old handle */
+    struct Handle reused = handle_new(table, Point, 1, 1);
+    int found = 0;
+    CHECK(handle_get(table, reused));
+    for (int i = 0; i < OBJECTS; i += 3)
+    {
+        CHECK(!handle_get(table, handles[i]));
+        if (handles[i].index == reused.index)
+            found = handles[i].generation != reused.generation;
+    }
+    CHECK(found);
+    CHECK(handle_delete(table, reused) == 0);
+
+    void * before[OBJECTS];
+    for (int i = 0; i < OBJECTS; i++)
+        before[i] = handle_get(table, handles[i]);
+
+    CHECK(handle_compact(table, Circle) > 0);
+    CHECK(handle_compact(table, NULL) > 0);
+
+    /* the same objects, wherever they are now, and the stale handles stay stale */
+    size_t live = 0;
+    for (int i = 0; i < OBJECTS; i++)
+    {
+        const void * object = handle_get(table, handles[i]);
+        if (i % 3 == 0)
+        {
+            CHECK(!object && !before[i]);
+            continue;
+        }
+        live++;
+        CHECK(object && x(object) == i && y(object) == -i);
+        CHECK(is_a(object, i % 2 ? Circle : Point));
+        CHECK(i % 2 == 0 || radius(object) == i % 10);
+    }
+    CHECK(handle_count(table) == live);
+
+    size_t cursor = 0, visited = 0;
+    struct Handle handle;
+    while (handle_next(table, &cursor, &handle))
+    {
+        CHECK(handle_get(table, handle));
+        visited++;
+    }
+    CHECK(visited == live);
+
+    delete(table);
+    return 0;
+}
@@ -0,0 +1,66 @@
+/* Loops on the pool with fewer threads than it has started: the workers left
+ * out of a loop must not touch it, even when they only wake up after it is
+ * over. Every index has to be done exactly once whatever the thread count. */
+#include <stdatomic.h>
+
+#include "test.h"
+#include "Parallel.h"
+#include "Point.h"
+#include "Point_struct.h"
+
+#define ROUNDS  2000
+
+static void count(size_t begin, size_t end, void * ctx)
+{
+    atomic_size_t * done = ctx;
+
+    atomic_fetch_add_explicit(done, end - begin, memory_order_relaxed);
+}
+
+static void add_x(void * partial, void * object, void * ctx)
+{
+    *(long long *) partial += x(object);
+}
+
+static void add_sums(void * result, const void * partial, void * ctx)
+{
+    *(long long *) result += *(const long long *) partial;
+}
+
+int main(void)
+{
+    initPoint();
+
+    atomic_size_t done = 0;
+    parallel_set_threads(8);
+    parallel_for(1000, 1, count, &done);
+    CHECK(atomic_load(&done) == 1000);
+
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        atomic_store(&done, 0);
+        parallel_for(2, 1, count, &done);
+        CHECK(atomic_load(&done) == 2);
+    }
+
+    void * points[100];
+    for (int i = 0; i < 100; i++)
+        points[i] = new(Point, i, 0);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        int threads = 8 - round % 8;
+        long long sum = 0;
+
+        parallel_set_threads(threads);
+        parallel_set_grain((size_t) (round % 3));
+        parallel_reduce(points, 100, &sum, sizeof(sum), add_x, add_sums, NULL);
+        CHECK(sum == 4950);
+        atomic_store(&done, 0);
+        parallel_for((size_t) round % 17, 1, count, &done);
+        CHECK(atomic_load(&done) == (size_t) round % 17);
+    }
+    for (int i = 0; i < 100; i++)
+        delete(points[i]);
+
+    return 0;
+}
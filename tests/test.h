@@ -0,0 +1,26 @@
+#ifndef __TEST__H__SL
+#define __TEST__H__SL
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/******************************************************************************
+ * TESTS
+ * Each file in tests/ is a program that ctest runs. CHECK() stops it at the
+ * first condition that does not hold; a test that does not apply to the build
+ * returns TEST_SKIP.
+*******************************************************************************/
+
+#define TEST_SKIP   77
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            exit(EXIT_FAILURE); \
+        } \
+    } while (0)
+
+#endif  /* !__TEST__H__SL */